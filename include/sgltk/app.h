@@ -34,10 +34,15 @@
 
 #include <string>
 #include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <thread>
+#include <mutex>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <memory>
 #include <list>
 #include <vector>
@@ -54,6 +59,7 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -123,6 +129,12 @@ struct SYS_INFO {
 	 * @brief The maximum supported tessellation level
 	 */
 	int max_tess_level;
+	/**
+	 * @brief True if the context supports direct state access
+	 * 	(OpenGL 4.5 or ARB_direct_state_access together with
+	 * 	separate program uniforms)
+	 */
+	bool direct_state_access;
 };
 
 
@@ -132,6 +144,8 @@ struct SYS_INFO {
  */
 class App {
 	static bool initialized;
+	static bool direct_state_access_enabled;
+	static std::mutex error_mutex;
 
 	EXPORT App();
 	EXPORT ~App();
@@ -141,14 +155,28 @@ public:
 	 * @brief True if set_gl_version was called, false otherwise
 	 */
 	EXPORT static bool gl_version_manual;
+	/**
+	 * @brief True if objects are edited using direct state access
+	 * 	instead of binding them first, false otherwise
+	 * @see enable_direct_state_access
+	 */
+	EXPORT static bool direct_state_access;
 	/**
 	 * @brief System information
 	 */
 	EXPORT static struct SYS_INFO sys_info;
 	/**
 	 * @brief A list of all error strings.
+	 * @note Only push_error may append to the list while other threads
+	 * 	are running. Read or clear the list once they have finished.
 	 */
 	EXPORT static std::vector<std::string> error_string;
+	/**
+	 * @brief Appends an error string to the error list
+	 * @param error The error string
+	 * @note This function is thread-safe
+	 */
+	EXPORT static void push_error(const std::string& error);
 	/**
 	 * @brief Initializes SGLTK
 	 * @return Returns true on success, false otherwise
@@ -224,6 +252,18 @@ public:
 	* @return	Returns false if VSync is not supported, true otherwise
 	*/
 	EXPORT static bool enable_vsync(bool on);
+	/**
+	 * @brief Enables or disables the use of direct state access
+	 * @param enable True to use direct state access if the context
+	 * 	supports it, false to always use bind-to-edit
+	 * @return Returns true if direct state access is in use,
+	 * 	false otherwise
+	 * @note Support is detected when GLEW is initialized. Objects
+	 * 	that were created while direct state access was disabled
+	 * 	might not be editable using direct state access, so this
+	 * 	function should be called before any objects are created.
+	 */
+	EXPORT static bool enable_direct_state_access(bool enable);
 	/**
 	 * @brief Changes the current working directory to the directory
 	 * 	containing the executable
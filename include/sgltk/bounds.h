@@ -0,0 +1,211 @@
+#ifndef __BOUNDS_H__
+#define __BOUNDS_H__
+
+#include "app.h"
+
+namespace sgltk {
+
+/**
+ * @struct AABB
+ * @brief An axis aligned bounding box
+ */
+struct AABB {
+	/**
+	 * @brief The corner with the smallest coordinates
+	 */
+	glm::vec3 min;
+	/**
+	 * @brief The corner with the largest coordinates
+	 */
+	glm::vec3 max;
+
+	/**
+	 * @brief Returns a corner of the box
+	 * @param i 0 for the minimum, 1 for the maximum
+	 */
+	glm::vec3& operator[](unsigned int i) {
+		return i ? max : min;
+	}
+
+	/**
+	 * @brief Returns a corner of the box
+	 * @param i 0 for the minimum, 1 for the maximum
+	 */
+	const glm::vec3& operator[](unsigned int i) const {
+		return i ? max : min;
+	}
+
+	/**
+	 * @brief Returns the center of the box
+	 */
+	glm::vec3 get_center() const {
+		return 0.5f * (min + max);
+	}
+
+	/**
+	 * @brief Returns half the size of the box along every axis
+	 */
+	glm::vec3 get_extent() const {
+		return 0.5f * (max - min);
+	}
+};
+
+/**
+ * @struct Sphere
+ * @brief A bounding sphere
+ */
+struct Sphere {
+	/**
+	 * @brief The center of the sphere
+	 */
+	glm::vec3 center;
+	/**
+	 * @brief The radius of the sphere
+	 */
+	float radius;
+};
+
+/**
+ * @class Frustum
+ * @brief The six planes of a view frustum
+ *
+ * The planes are stored in a structure of arrays layout to test four
+ * bounding spheres at once with SSE.
+ */
+class Frustum {
+	float plane_x[6];
+	float plane_y[6];
+	float plane_z[6];
+	float plane_w[6];
+public:
+	/**
+	 * @brief The planes in the order left, right, bottom, top, near and
+	 * 	far. The normals point into the frustum and are normalized.
+	 */
+	glm::vec4 planes[6];
+
+	/**
+	 * @brief Creates a frustum that contains everything
+	 */
+	EXPORT Frustum();
+	/**
+	 * @param matrix The matrix that transforms into clip space
+	 * @see update
+	 */
+	EXPORT Frustum(const glm::mat4& matrix);
+
+	/**
+	 * @brief Extracts the planes from a matrix
+	 * @param matrix The matrix that transforms into clip space. The
+	 * 	planes are in the coordinate system the matrix transforms
+	 * 	from, e.g. world space for a view-projection matrix.
+	 */
+	EXPORT void update(const glm::mat4& matrix);
+	/**
+	 * @brief Tests whether a sphere is at least partially inside
+	 * 	the frustum
+	 * @param sphere The sphere
+	 * @return Returns false if the sphere is completely outside of the
+	 * 	frustum, true otherwise
+	 */
+	EXPORT bool intersects(const Sphere& sphere) const;
+	/**
+	 * @brief Tests whether a bounding box is at least partially inside
+	 * 	the frustum
+	 * @param box The bounding box
+	 * @return Returns false if the box is completely outside of the
+	 * 	frustum, true otherwise
+	 * @note Boxes that are outside of the frustum but not entirely
+	 * 	behind a single plane are reported as visible.
+	 */
+	EXPORT bool intersects(const AABB& box) const;
+	/**
+	 * @brief Tests many spheres against the frustum
+	 * @param spheres A pointer to the first sphere
+	 * @param num_spheres The number of spheres
+	 * @param visible A pointer to an array of num_spheres elements that
+	 * 	is set to 1 for every sphere that intersects the frustum and
+	 * 	to 0 otherwise
+	 * @return The number of visible spheres
+	 */
+	EXPORT size_t intersects(const Sphere *spheres, size_t num_spheres,
+				 unsigned char *visible) const;
+};
+
+/**
+ * @class Bounds
+ * @brief Computes and transforms bounding volumes
+ *
+ * The bounding box of a vertex array is computed with SSE, or with AVX if
+ * the library is compiled with AVX enabled, and falls back to scalar code
+ * on other architectures.
+ */
+class Bounds {
+public:
+	/**
+	 * @brief Computes the bounding box of a set of positions
+	 * @param data A pointer to the first vertex
+	 * @param num_vertices The number of vertices
+	 * @param stride The distance between two consecutive vertices in
+	 * 	bytes
+	 * @param offset The offset of the position within a vertex in bytes
+	 * @return The bounding box or an empty box at the origin if there are
+	 * 	no vertices
+	 * @note Every position consists of three consecutive floats. Only
+	 * 	the memory of the positions themselves is read.
+	 */
+	EXPORT static AABB compute_aabb(const void *data,
+					size_t num_vertices,
+					size_t stride,
+					size_t offset = 0);
+	/**
+	 * @brief Computes a bounding sphere of a set of positions using
+	 * 	Ritter's algorithm
+	 * @param data A pointer to the first vertex
+	 * @param num_vertices The number of vertices
+	 * @param stride The distance between two consecutive vertices in
+	 * 	bytes
+	 * @param offset The offset of the position within a vertex in bytes
+	 * @return The bounding sphere
+	 * @note The sphere is usually a few percent larger than the
+	 * 	smallest enclosing sphere.
+	 */
+	EXPORT static Sphere compute_sphere(const void *data,
+					    size_t num_vertices,
+					    size_t stride,
+					    size_t offset = 0);
+	/**
+	 * @brief Computes the bounding box of a transformed bounding box
+	 * @param box The bounding box
+	 * @param matrix The transformation
+	 * @return The axis aligned bounding box of the transformed box
+	 */
+	EXPORT static AABB transform(const AABB& box, const glm::mat4& matrix);
+	/**
+	 * @brief Computes a bounding sphere of a transformed sphere
+	 * @param sphere The bounding sphere
+	 * @param matrix The transformation
+	 * @return The transformed sphere. Non-uniform scaling enlarges the
+	 * 	sphere by the largest scaling factor.
+	 */
+	EXPORT static Sphere transform(const Sphere& sphere,
+				       const glm::mat4& matrix);
+	/**
+	 * @brief Computes the bounding box of two bounding boxes
+	 * @param a The first bounding box
+	 * @param b The second bounding box
+	 * @return The bounding box containing both boxes
+	 */
+	EXPORT static AABB merge(const AABB& a, const AABB& b);
+	/**
+	 * @brief Computes the smallest sphere containing two spheres
+	 * @param a The first sphere
+	 * @param b The second sphere
+	 * @return The sphere containing both spheres
+	 */
+	EXPORT static Sphere merge(const Sphere& a, const Sphere& b);
+};
+
+}
+
+#endif //__BOUNDS_H__
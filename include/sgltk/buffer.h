@@ -2,16 +2,129 @@
 #define __BUFFER_H_
 
 #include "app.h"
+#include "state.h"
+#include "gpu_memory.h"
 
 namespace sgltk {
 
+class Buffer_Readback;
+
+/**
+ * @brief Strategies for overwriting the data of a buffer object
+ * @see Buffer::set_update_mode
+ */
+enum class BUFFER_UPDATE {
+	/**
+	 * @brief Writes the data with glBufferSubData. The driver may have
+	 * 	to wait until the GPU has stopped reading the buffer.
+	 */
+	SUB_DATA,
+	/**
+	 * @brief Reallocates the storage with glBufferData before writing
+	 * 	so that the driver can hand out new memory while the GPU
+	 * 	still reads the old one. Only whole buffer updates can be
+	 * 	orphaned, partial updates use MAP_INVALIDATE instead.
+	 */
+	ORPHAN,
+	/**
+	 * @brief Maps the range with glMapBufferRange, invalidates its
+	 * 	previous contents and flushes the written data explicitly
+	 */
+	MAP_INVALIDATE,
+	/**
+	 * @brief Like MAP_INVALIDATE, but the driver does not wait for
+	 * 	pending operations on the buffer
+	 * @note The application has to make sure that the GPU does not read
+	 * 	the range anymore, e.g. by writing to ranges that no pending
+	 * 	draw call uses or by waiting for a fence.
+	 */
+	MAP_UNSYNCHRONIZED
+};
+
 /**
  * @class Buffer
  * @brief Manages buffer objects
  */
 class Buffer {
+protected:
 	GLenum usage;
 	GLenum target;
+	BUFFER_UPDATE update_mode;
+
+	/**
+	 * @brief Binds the buffer for data transfers. GL_COPY_WRITE_BUFFER
+	 * 	is used so that the bindings of the other targets, including
+	 * 	the index buffer of the bound vertex array, stay untouched.
+	 */
+	void bind_data() {
+		State_Cache::get().bind_buffer(GL_COPY_WRITE_BUFFER, buffer);
+	}
+
+	/**
+	 * @brief Releases the binding made by bind_data
+	 */
+	void release_data() {
+		State_Cache::get().release_buffer(GL_COPY_WRITE_BUFFER);
+	}
+
+	/**
+	 * @brief Updates the size of the buffer in the memory registry
+	 */
+	void track_memory() {
+		Memory_Registry::track(this, Memory_Registry::get_buffer_kind(target),
+				       usage, size);
+	}
+
+	/**
+	 * @brief Overwrites a range of the buffer using the update mode
+	 * @param offset The offset of the range in bytes
+	 * @param size The size of the range in bytes
+	 * @param data The data to be written into the range
+	 */
+	void write_range(unsigned int offset, unsigned int size, const void *data) {
+		bool whole = (offset == 0 && size == this->size);
+		if(update_mode == BUFFER_UPDATE::ORPHAN && whole) {
+			//let the driver hand out new storage
+			if(App::direct_state_access) {
+				glNamedBufferData(buffer, size, nullptr, usage);
+				glNamedBufferSubData(buffer, 0, size, data);
+				return;
+			}
+			bind_data();
+			glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, usage);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, 0, size, data);
+			release_data();
+			return;
+		}
+
+		if(update_mode != BUFFER_UPDATE::SUB_DATA) {
+			GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT;
+			if(whole)
+				access |= GL_MAP_INVALIDATE_BUFFER_BIT;
+			else
+				access |= GL_MAP_INVALIDATE_RANGE_BIT;
+			if(update_mode == BUFFER_UPDATE::MAP_UNSYNCHRONIZED)
+				access |= GL_MAP_UNSYNCHRONIZED_BIT;
+
+			void *ptr = map_range(offset, size, access);
+			if(ptr) {
+				std::memcpy(ptr, data, size);
+				flush_range(0, size);
+				if(unmap())
+					return;
+			}
+			//the mapping failed or the data store was lost,
+			//fall back to glBufferSubData
+		}
+
+		if(App::direct_state_access) {
+			glNamedBufferSubData(buffer, offset, size, data);
+			return;
+		}
+		bind_data();
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+		release_data();
+	}
 public:
 	/**
 	 * @brief The name of the buffer object
@@ -33,11 +146,19 @@ public:
 	 */
 	Buffer(GLenum target = GL_ARRAY_BUFFER) {
 		this->target = target;
-		glGenBuffers(1, &buffer);
+		usage = GL_STATIC_DRAW;
+		update_mode = BUFFER_UPDATE::SUB_DATA;
+		size = 0;
+		num_elements = 0;
+		if(App::direct_state_access)
+			glCreateBuffers(1, &buffer);
+		else
+			glGenBuffers(1, &buffer);
 	}
 
-	~Buffer() {
-		glDeleteBuffers(1, &buffer);
+	virtual ~Buffer() {
+		Memory_Registry::untrack(this);
+		State_Cache::get().delete_buffer(buffer);
 	}
 
 	/**
@@ -46,7 +167,7 @@ public:
 	 * 	  to a target before
 	 */
 	void bind() {
-		glBindBuffer(target, buffer);
+		State_Cache::get().bind_buffer(target, buffer);
 	}
 
 	/**
@@ -55,7 +176,7 @@ public:
 	 */
 	void bind(GLenum target) {
 		this->target = target;
-		glBindBuffer(target, buffer);
+		State_Cache::get().bind_buffer(target, buffer);
 	}
 
 	/**
@@ -74,14 +195,33 @@ public:
 			case GL_TRANSFORM_FEEDBACK_BUFFER:
 			case GL_UNIFORM_BUFFER:
 			case GL_SHADER_STORAGE_BUFFER:
-				glBindBufferBase(target, index, buffer);
+				State_Cache::get().bind_buffer_base(target, index,
+								    buffer);
 				break;
 			default:
-				glBindBuffer(target, buffer);
+				State_Cache::get().bind_buffer(target, buffer);
 				break;
 		}
 	}
 
+	/**
+	 * @brief Binds a range of the buffer object to an indexed buffer target.
+	 * @param target The target to bind the buffer to. Must be
+	 * 	GL_ATOMIC_COUNTER_BUFFER, GL_TRANSFORM_FEEDBACK_BUFFER,
+	 * 	GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER.
+	 * @param index The index of the binding point within the array
+	 * 		specified by target.
+	 * @param offset The starting offset in bytes into the buffer
+	 * @param size The amount of data in bytes that can be read from
+	 * 	the buffer when used by the indexed binding
+	 */
+	void bind(GLenum target, unsigned int index,
+		  unsigned int offset, unsigned int size) {
+		this->target = target;
+		State_Cache::get().bind_buffer_range(target, index, buffer,
+						     offset, size);
+	}
+
 	/**
 	 * @brief Unbinds the buffer object from the target it was bound to
 	 * @note Exercise caution when unbinding a buffer! If you bind two buffers
@@ -89,7 +229,7 @@ public:
 	 *
 	 */
 	void unbind() {
-		glBindBuffer(target, 0);
+		State_Cache::get().bind_buffer(target, 0);
 	}
 
 	/**
@@ -102,9 +242,14 @@ public:
 	void create_empty(unsigned int num_elements, GLenum usage) {
 		this->usage = usage;
 		this->size = num_elements * sizeof(T);
-		bind();
-		glBufferData(target, size, nullptr, usage);
-		unbind();
+		track_memory();
+		if(App::direct_state_access) {
+			glNamedBufferData(buffer, size, nullptr, usage);
+			return;
+		}
+		bind_data();
+		glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, usage);
+		release_data();
 	}
 
 	/**
@@ -115,13 +260,7 @@ public:
 	 */
 	template <typename T>
 	void load(const std::vector<T> &data, GLenum usage) {
-		this->usage = usage;
-		bind();
-		size = data.size() * sizeof(T);
-		num_elements = data.size();
-
-		glBufferData(target, size, data.data(), usage);
-		unbind();
+		load(data.size(), data.data(), usage);
 	}
 
 	/**
@@ -134,11 +273,17 @@ public:
 	template <typename T>
 	void load(unsigned int num_elements, const T *data, GLenum usage) {
 		this->usage = usage;
-		bind();
 		size = num_elements * sizeof(T);
+		this->num_elements = num_elements;
+		track_memory();
 
-		glBufferData(target, size, data, usage);
-		unbind();
+		if(App::direct_state_access) {
+			glNamedBufferData(buffer, size, data, usage);
+			return;
+		}
+		bind_data();
+		glBufferData(GL_COPY_WRITE_BUFFER, size, data, usage);
+		release_data();
 	}
 
 	/**
@@ -155,19 +300,37 @@ public:
 		if(offset >= this->size)
 			return false;
 
-		if(size < this->size - offset)
+		if(size > this->size - offset)
 			return false;
 
 		if(!storage)
 			return false;
 
-		bind(GL_COPY_READ_BUFFER);
-		glGetBufferSubData(GL_COPY_READ_BUFFER, offset, size, storage);
-		unbind();
+		if(App::direct_state_access) {
+			glGetNamedBufferSubData(buffer, offset, size, storage);
+			return true;
+		}
+		bind_data();
+		glGetBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, storage);
+		release_data();
 
 		return true;
 	 }
 
+	/**
+	 * @brief Starts an asynchronous read of the contents of the buffer
+	 * 	object. The data is copied into the staging buffer of the
+	 * 	readback object on the GPU and can be retrieved once the
+	 * 	copy has finished without stalling the pipeline.
+	 * @param offset The offset in bytes into the buffer object
+	 * @param size The number of bytes to read
+	 * @param readback The readback object that receives the data
+	 * @return Returns true on success, false otherwise
+	 * @see Buffer_Readback
+	 */
+	bool store_async(unsigned int offset, unsigned int size,
+			 Buffer_Readback& readback);
+
 	/**
 	 * @brief Copies data from another buffer object
 	 * @param source The source of the data to copy
@@ -180,19 +343,26 @@ public:
 		  unsigned int write_offset, unsigned int size) {
 
 		if(read_offset >= source.size ||
-			read_offset + size >= source.size)
+			read_offset + size > source.size)
 				return false;
 
 		if(write_offset >= this->size ||
-			write_offset + size >= this->size)
+			write_offset + size > this->size)
 				return false;
 
-		source.bind(GL_COPY_READ_BUFFER);
-		bind(GL_COPY_WRITE_BUFFER);
+		if(App::direct_state_access) {
+			glCopyNamedBufferSubData(source.buffer, buffer, read_offset,
+						 write_offset, size);
+			return true;
+		}
+
+		State_Cache& state = State_Cache::get();
+		state.bind_buffer(GL_COPY_READ_BUFFER, source.buffer);
+		bind_data();
 		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
 						read_offset, write_offset, size);
-		source.unbind();
-		unbind();
+		state.release_buffer(GL_COPY_READ_BUFFER);
+		release_data();
 
 		return true;
 	}
@@ -211,19 +381,26 @@ public:
 			return false;
 
 		if(read_offset >= source->size ||
-			read_offset + size >= source->size)
+			read_offset + size > source->size)
 				return false;
 
 		if(write_offset >= this->size ||
-			write_offset + size >= this->size)
+			write_offset + size > this->size)
 				return false;
 
-		source->bind(GL_COPY_READ_BUFFER);
-		bind(GL_COPY_WRITE_BUFFER);
+		if(App::direct_state_access) {
+			glCopyNamedBufferSubData(source->buffer, buffer, read_offset,
+						 write_offset, size);
+			return true;
+		}
+
+		State_Cache& state = State_Cache::get();
+		state.bind_buffer(GL_COPY_READ_BUFFER, source->buffer);
+		bind_data();
 		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
 						read_offset, write_offset, size);
-		source->unbind();
-		unbind();
+		state.release_buffer(GL_COPY_READ_BUFFER);
+		release_data();
 
 		return true;
 	}
@@ -237,41 +414,121 @@ public:
 	 * 	all pending operations on that buffer object have completed
 	 */
 	void *map(GLenum access) {
-		bind(GL_ARRAY_BUFFER);
-		void *ptr = glMapBuffer(target, access);
-		unbind();
+		if(App::direct_state_access)
+			return glMapNamedBuffer(buffer, access);
+
+		bind_data();
+		void *ptr = glMapBuffer(GL_COPY_WRITE_BUFFER, access);
+		release_data();
 		return ptr;
 	 }
 
+	/**
+	 * @brief Maps a range of a buffer object's data into the client's
+	 * 	address space
+	 * @param offset The offset of the range in bytes
+	 * @param size The size of the range in bytes
+	 * @param access A combination of GL_MAP_READ_BIT, GL_MAP_WRITE_BIT,
+	 * 	GL_MAP_INVALIDATE_RANGE_BIT, GL_MAP_INVALIDATE_BUFFER_BIT,
+	 * 	GL_MAP_FLUSH_EXPLICIT_BIT and GL_MAP_UNSYNCHRONIZED_BIT
+	 * @return Returns a pointer to the beginning of the mapped range or
+	 * 	nullptr if the range could not be mapped
+	 * @see Mapped_Range
+	 */
+	void *map_range(unsigned int offset, unsigned int size,
+			GLbitfield access) {
+
+		if(size == 0 || offset > this->size || size > this->size - offset)
+			return nullptr;
+
+		if(App::direct_state_access)
+			return glMapNamedBufferRange(buffer, offset, size, access);
+
+		bind_data();
+		void *ptr = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset,
+					     size, access);
+		release_data();
+		return ptr;
+	}
+
+	/**
+	 * @brief Makes the writes to a subrange of a range that was mapped
+	 * 	with GL_MAP_FLUSH_EXPLICIT_BIT visible to the GPU
+	 * @param offset The offset in bytes from the start of the mapped range
+	 * @param size The size of the subrange in bytes
+	 */
+	void flush_range(unsigned int offset, unsigned int size) {
+		if(App::direct_state_access) {
+			glFlushMappedNamedBufferRange(buffer, offset, size);
+			return;
+		}
+		bind_data();
+		glFlushMappedBufferRange(GL_COPY_WRITE_BUFFER, offset, size);
+		release_data();
+	}
+
 	/**
 	  * @brief Releases the mapping of a buffer object's data store into
 	  * 	the client's address space
+	  * @return Returns false if the data store was corrupted while it was
+	  * 	mapped, e.g. after a display mode change, true otherwise
 	  */
-	void unmap() {
-		bind(GL_ARRAY_BUFFER);
-		glUnmapBuffer(target);
-		unbind();
+	bool unmap() {
+		if(App::direct_state_access)
+			return glUnmapNamedBuffer(buffer) == GL_TRUE;
+
+		bind_data();
+		bool ret = glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_TRUE;
+		release_data();
+		return ret;
 	 }
 
+	/**
+	 * @brief Sets the strategy used by replace_data and
+	 * 	replace_partial_data to overwrite the data of the buffer
+	 * @param mode The update mode
+	 * @see benchmark_update_modes
+	 */
+	void set_update_mode(BUFFER_UPDATE mode) {
+		update_mode = mode;
+	}
+
+	/**
+	 * @brief Returns the strategy used to overwrite the data of the buffer
+	 * @return The update mode
+	 */
+	BUFFER_UPDATE get_update_mode() {
+		return update_mode;
+	}
+
+	/**
+	 * @brief Measures how long every update mode takes to overwrite a
+	 * 	buffer that the GPU reads from after every update
+	 * @param size The size of the buffer in bytes
+	 * @param iterations The number of updates per mode
+	 * @param allow_unsynchronized True to consider
+	 * 	BUFFER_UPDATE::MAP_UNSYNCHRONIZED as a result. Only set this if
+	 * 	the application synchronizes its updates itself.
+	 * @param times If not nullptr, this vector is set to the time in
+	 * 	milliseconds of every mode in the order of the BUFFER_UPDATE
+	 * 	enumerators
+	 * @return The fastest update mode on the current driver
+	 * @note The results depend on the driver and on the size of the
+	 * 	updates. The benchmark should be run once with the size of
+	 * 	the buffers the application updates.
+	 */
+	EXPORT static BUFFER_UPDATE benchmark_update_modes(unsigned int size,
+							   unsigned int iterations = 100,
+							   bool allow_unsynchronized = false,
+							   std::vector<double> *times = nullptr);
+
 	/**
 	 * @brief Overwrites all data in a vertex buffer
 	 * @param data The data to be loaded into the buffer
 	 */
 	template <typename T>
 	void replace_data(const std::vector<T> &data) {
-		bind();
-
-		unsigned int new_size = data.size() * sizeof(T);
-
-		if(size == new_size) {
-			//replace the buffer data without reallocation
-			glBufferSubData(target, 0, size, data.data());
-		} else {
-			//replace the buffer data with reallocation
-			size = new_size;
-			glBufferData(target, new_size, data.data(), usage);
-		}
-		unbind();
+		replace_data(data.data(), data.size());
 	}
 
 	/**
@@ -281,19 +538,27 @@ public:
 	 */
 	template <typename T>
 	void replace_data(const T *data, unsigned int number_elements) {
-		bind();
-
 		unsigned int new_size = number_elements * sizeof(T);
+		bool reallocate = (size != new_size);
+		if(reallocate) {
+			size = new_size;
+			track_memory();
+		}
 
-		if(size == new_size) {
+		if(!reallocate) {
 			//replace the buffer data without reallocation
-			glBufferSubData(target, 0, size, data);
-		} else {
-			//replace the buffer data with reallocation
-			size = new_size;
-			glBufferData(target, new_size, data, usage);
+			write_range(0, size, data);
+			return;
 		}
-		unbind();
+
+		//replace the buffer data with reallocation
+		if(App::direct_state_access) {
+			glNamedBufferData(buffer, size, data, usage);
+			return;
+		}
+		bind_data();
+		glBufferData(GL_COPY_WRITE_BUFFER, size, data, usage);
+		release_data();
 	}
 
 	/**
@@ -303,17 +568,7 @@ public:
 	 */
 	template <typename T>
 	bool replace_partial_data(unsigned int offset, const std::vector<T>& data) {
-
-		unsigned int data_size = data.size() * sizeof(T);
-
-		if(offset + data_size > size) {
-			return false;
-		}
-
-		bind();
-		glBufferSubData(target, offset, data_size, data.data());
-		unbind();
-		return true;
+		return replace_partial_data(offset, data.data(), data.size());
 	}
 
 	/**
@@ -333,12 +588,437 @@ public:
 			return false;
 		}
 
-		bind();
-		glBufferSubData(target, offset, data_size, data);
-		unbind();
+		if(data_size > 0)
+			write_range(offset, data_size, data);
 		return true;
 	}
+};
 
+/**
+ * @class Buffer_Readback
+ * @brief Reads the contents of buffer objects back to the CPU without
+ * 	stalling the pipeline
+ *
+ * The data is copied into a staging buffer on the GPU and a fence is
+ * inserted into the command stream. Once the fence has been signaled the
+ * data can be read from the staging buffer without waiting for any
+ * other pending commands. Using several readback objects in turn allows
+ * the results of a frame to be read a few frames later.
+ */
+class Buffer_Readback {
+	GLuint staging;
+	unsigned int capacity;
+	unsigned int size;
+	GLsync fence;
+	bool pending;
+public:
+	EXPORT Buffer_Readback();
+	EXPORT ~Buffer_Readback();
+	Buffer_Readback(const Buffer_Readback&) = delete;
+	Buffer_Readback& operator=(const Buffer_Readback&) = delete;
+
+	/**
+	 * @brief Starts copying a range of a buffer object into the
+	 * 	staging buffer
+	 * @param source The buffer to read from
+	 * @param offset The offset in bytes into the source buffer
+	 * @param size The number of bytes to read
+	 * @return Returns true on success, false otherwise
+	 * @note A readback that has not been read yet is discarded.
+	 */
+	EXPORT bool start(Buffer& source, unsigned int offset, unsigned int size);
+	/**
+	 * @brief Checks whether a readback has been started and not been
+	 * 	read yet
+	 * @return Returns true if a readback is pending, false otherwise
+	 */
+	EXPORT bool is_pending();
+	/**
+	 * @brief Checks whether the copy has finished without blocking
+	 * @return Returns true if the data can be read without stalling,
+	 * 	false otherwise
+	 */
+	EXPORT bool is_ready();
+	/**
+	 * @brief Waits for the copy to finish
+	 * @param timeout The maximum time to wait in nanoseconds
+	 * @return Returns true if the copy has finished, false if the
+	 * 	timeout expired or no readback is pending
+	 */
+	EXPORT bool wait(GLuint64 timeout);
+	/**
+	 * @brief Returns the number of bytes of the pending readback
+	 * @return The size of the readback in bytes
+	 */
+	EXPORT unsigned int get_size();
+	/**
+	 * @brief Writes the data of the readback into the storage
+	 * @param storage The storage to write the data to. It has to be
+	 * 	able to hold get_size() bytes.
+	 * @return Returns true on success, false otherwise
+	 * @note If the copy has not finished yet, this function blocks
+	 * 	until it does.
+	 */
+	EXPORT bool read(void *storage);
+	/**
+	 * @brief Writes the data of the readback into the storage
+	 * @param storage The storage to write the data to. It is resized to
+	 * 	fit the data.
+	 * @return Returns true on success, false otherwise
+	 * @note If the copy has not finished yet, this function blocks
+	 * 	until it does.
+	 */
+	template <typename T>
+	bool read(std::vector<T>& storage) {
+		storage.resize(size / sizeof(T));
+		return read(storage.data());
+	}
+};
+
+inline bool Buffer::store_async(unsigned int offset, unsigned int size,
+				Buffer_Readback& readback) {
+
+	return readback.start(*this, offset, size);
+}
+
+/**
+ * @class Mapped_Range
+ * @brief Maps a range of a buffer object into the client's address space
+ * 	for the lifetime of the object
+ *
+ * The range is unmapped when the object is destroyed. Ranges that were
+ * mapped with GL_MAP_FLUSH_EXPLICIT_BIT have to be flushed before that.
+ * @note A buffer object can only have one mapping at a time and has to
+ * 	outlive the mapping.
+ */
+class Mapped_Range {
+	Buffer *buffer;
+	void *pointer;
+	unsigned int offset;
+	unsigned int size;
+public:
+	/**
+	 * @param buffer The buffer to map
+	 * @param offset The offset of the range in bytes
+	 * @param size The size of the range in bytes
+	 * @param access The access flags that are passed to
+	 * 	Buffer::map_range
+	 */
+	EXPORT Mapped_Range(Buffer& buffer, unsigned int offset,
+			    unsigned int size, GLbitfield access);
+	EXPORT Mapped_Range(Mapped_Range&& other);
+	EXPORT Mapped_Range& operator=(Mapped_Range&& other);
+	Mapped_Range(const Mapped_Range&) = delete;
+	Mapped_Range& operator=(const Mapped_Range&) = delete;
+	EXPORT ~Mapped_Range();
+
+	/**
+	 * @brief Checks whether the range is mapped
+	 * @return Returns true if the range is mapped, false if the mapping
+	 * 	failed or the range was unmapped
+	 */
+	EXPORT bool is_mapped();
+	/**
+	 * @brief Returns a pointer to the beginning of the mapped range or
+	 * 	nullptr if the range is not mapped
+	 */
+	EXPORT void *get_pointer();
+	/**
+	 * @brief Returns a pointer to the beginning of the mapped range or
+	 * 	nullptr if the range is not mapped
+	 */
+	template <typename T>
+	T *get_data() {
+		return static_cast<T *>(get_pointer());
+	}
+	/**
+	 * @brief Returns the offset of the range in bytes from the start of
+	 * 	the buffer object
+	 */
+	EXPORT unsigned int get_offset();
+	/**
+	 * @brief Returns the size of the range in bytes
+	 */
+	EXPORT unsigned int get_size();
+	/**
+	 * @brief Makes the writes to a subrange visible to the GPU
+	 * @param offset The offset in bytes from the start of the range
+	 * @param size The size of the subrange in bytes
+	 * @return Returns true on success, false if the subrange exceeds the
+	 * 	range or the range is not mapped
+	 * @note The range has to be mapped with GL_MAP_FLUSH_EXPLICIT_BIT.
+	 */
+	EXPORT bool flush(unsigned int offset, unsigned int size);
+	/**
+	 * @brief Makes the writes to the whole range visible to the GPU
+	 * @return Returns true on success, false if the range is not mapped
+	 * @note The range has to be mapped with GL_MAP_FLUSH_EXPLICIT_BIT.
+	 */
+	EXPORT bool flush();
+	/**
+	 * @brief Unmaps the range before the object is destroyed
+	 * @return Returns false if the data store was corrupted while it was
+	 * 	mapped or the range was not mapped, true otherwise
+	 */
+	EXPORT bool unmap();
+};
+
+/**
+ * @struct Stream_Range
+ * @brief A range of a stream buffer that was handed out by
+ * 	Stream_Buffer::allocate
+ */
+struct Stream_Range {
+	/**
+	 * @brief A pointer to the mapped memory of the range or nullptr
+	 * 	if the allocation failed
+	 */
+	void *pointer;
+	/**
+	 * @brief The offset of the range in bytes from the start of the
+	 * 	buffer object
+	 */
+	unsigned int offset;
+	/**
+	 * @brief The size of the range in bytes
+	 */
+	unsigned int size;
+};
+
+/**
+ * @class Stream_Buffer
+ * @brief Manages persistently mapped buffers for data that is
+ * 	updated every frame
+ *
+ * The storage of the buffer is divided into several regions that are
+ * filled one after another. Once the application moves on to the next
+ * region a fence is inserted into the command stream so that a region
+ * is only written to again after the GPU has finished reading from it.
+ * @note Requires OpenGL 4.4 or the ARB_buffer_storage extension.
+ * 	The storage of a stream buffer is immutable, the load,
+ * 	create_empty and replace_data functions can not be used.
+ */
+class Stream_Buffer : public Buffer {
+	unsigned int region_size;
+	unsigned int num_regions;
+	unsigned int region;
+	unsigned int region_offset;
+	unsigned int alignment;
+	char *mapped_data;
+	std::vector<GLsync> fences;
+
+	void wait_for_region(unsigned int index);
+public:
+	/**
+	 * @param region_size The size of a single region in bytes
+	 * @param target The target to bind the buffer to
+	 * @param num_regions The number of regions. Three regions allow the
+	 * 	CPU to write one frame while the GPU reads the two
+	 * 	previous ones.
+	 */
+	EXPORT Stream_Buffer(unsigned int region_size,
+			     GLenum target = GL_ARRAY_BUFFER,
+			     unsigned int num_regions = 3);
+	EXPORT ~Stream_Buffer();
+
+	/**
+	 * @brief Checks whether persistently mapped buffers are supported
+	 * 	by the current context
+	 * @return Returns true if stream buffers can be created,
+	 * 	false otherwise
+	 */
+	EXPORT static bool is_supported();
+	/**
+	 * @brief Returns the size of a single region
+	 * @return The size of a region in bytes
+	 */
+	EXPORT unsigned int get_region_size();
+	/**
+	 * @brief Returns the index of the region that is currently written
+	 * @return The index of the current region
+	 */
+	EXPORT unsigned int get_region();
+	/**
+	 * @brief Reserves a range in the current region. If the current
+	 * 	region is full the buffer moves on to the next one.
+	 * @param size The size of the range in bytes
+	 * @param alignment The alignment of the offset of the range from the
+	 * 	start of the buffer in bytes. Uniform and shader storage
+	 * 	buffers always use at least the alignment required by the
+	 * 	implementation.
+	 * @return Returns the reserved range. If the aligned range does not
+	 * 	fit into a region, the pointer of the returned range is nullptr.
+	 * @note The returned offset can be passed as the pointer argument of
+	 * 	Mesh::set_buffer_vertex_attribute or together with the size to
+	 * 	Buffer::bind(target, index, offset, size).
+	 */
+	EXPORT Stream_Range allocate(unsigned int size,
+				     unsigned int alignment = 4);
+	/**
+	 * @brief Reserves a range in the current region and copies data into it
+	 * @param data The data to copy into the buffer
+	 * @param number_elements Number of elements
+	 * @return Returns the range the data was written to
+	 */
+	template <typename T>
+	Stream_Range write(const T *data, unsigned int number_elements) {
+		Stream_Range range = allocate(number_elements * sizeof(T),
+					      alignof(T));
+		if(range.pointer) {
+			std::copy(data, data + number_elements,
+				  static_cast<T *>(range.pointer));
+		}
+		return range;
+	}
+	/**
+	 * @brief Reserves a range in the current region and copies data into it
+	 * @param data The data to copy into the buffer
+	 * @return Returns the range the data was written to
+	 */
+	template <typename T>
+	Stream_Range write(const std::vector<T>& data) {
+		return write(data.data(), data.size());
+	}
+	/**
+	 * @brief Marks the end of the use of the current region and moves on
+	 * 	to the next one. This function should be called once per frame
+	 * 	after the draw calls that read from the buffer were issued.
+	 * @note If the GPU is still reading from the next region, this
+	 * 	function blocks until it has finished.
+	 */
+	EXPORT void next_region();
+};
+
+/**
+ * @struct Buffer_Range
+ * @brief A range of a buffer object that was handed out by a Buffer_Heap
+ */
+struct Buffer_Range {
+	/**
+	 * @brief The buffer containing the range
+	 */
+	Buffer *buffer;
+	/**
+	 * @brief The offset of the range in bytes from the start of the buffer
+	 * @note The offset changes when the heap is compacted.
+	 */
+	unsigned int offset;
+	/**
+	 * @brief The size of the range in bytes
+	 */
+	unsigned int size;
+};
+
+/**
+ * @class Buffer_Heap
+ * @brief Sub-allocates ranges from a small number of large buffer objects
+ *
+ * Every page of the heap is a buffer object of a fixed size. Ranges are
+ * handed out from the free blocks of the pages using first fit and freed
+ * blocks are merged with their neighbors.
+ * @note The heap owns all ranges it hands out. The pointers stay valid
+ * 	until the range is freed or the heap is destroyed.
+ */
+class Buffer_Heap {
+	struct Page {
+		std::unique_ptr<Buffer> buffer;
+		unsigned int size;
+		std::map<unsigned int, unsigned int> free_blocks;
+		std::list<std::unique_ptr<Buffer_Range> > ranges;
+	};
+
+	GLenum target;
+	GLenum usage;
+	unsigned int page_size;
+	unsigned int alignment;
+	std::vector<std::unique_ptr<Page> > pages;
+
+	Page *create_page(unsigned int size);
+	Buffer_Range *allocate_from_page(Page& page, unsigned int size);
+	bool compact_page(Page& page);
+public:
+	/**
+	 * @param page_size The size of a page in bytes
+	 * @param target The target the buffers of the heap are bound to.
+	 * 	Use separate heaps for vertex and index data.
+	 * @param usage A hint as to how the buffers will be accessed.
+	 *      Valid values are GL_{STREAM,STATIC,DYNAMIC}_{DRAW,READ,COPY}.
+	 * @param alignment The alignment of the offsets of the ranges in bytes
+	 */
+	EXPORT Buffer_Heap(unsigned int page_size = 1 << 24,
+			   GLenum target = GL_ARRAY_BUFFER,
+			   GLenum usage = GL_STATIC_DRAW,
+			   unsigned int alignment = 16);
+	EXPORT ~Buffer_Heap();
+
+	/**
+	 * @brief Reserves a range of the heap
+	 * @param size The size of the range in bytes
+	 * @return Returns the range or nullptr on failure
+	 * @note Requests bigger than the page size get a page of their own.
+	 */
+	EXPORT Buffer_Range *allocate(unsigned int size);
+	/**
+	 * @brief Reserves a range of the heap and loads data into it
+	 * @param data The data to be loaded into the range
+	 * @param number_elements Number of elements
+	 * @return Returns the range or nullptr on failure
+	 */
+	template <typename T>
+	Buffer_Range *upload(const T *data, unsigned int number_elements) {
+		Buffer_Range *range = allocate(number_elements * sizeof(T));
+		if(range) {
+			range->buffer->replace_partial_data(range->offset,
+							    data,
+							    number_elements);
+		}
+		return range;
+	}
+	/**
+	 * @brief Reserves a range of the heap and loads data into it
+	 * @param data The data to be loaded into the range
+	 * @return Returns the range or nullptr on failure
+	 */
+	template <typename T>
+	Buffer_Range *upload(const std::vector<T>& data) {
+		return upload(data.data(), data.size());
+	}
+	/**
+	 * @brief Returns a range to the heap
+	 * @param range The range to free
+	 * @return Returns true on success, false if the range does not
+	 * 	belong to this heap
+	 */
+	EXPORT bool free(Buffer_Range *range);
+	/**
+	 * @brief Moves all ranges of every page to the start of the page
+	 * 	so that the free space of a page forms a single block
+	 * @return Returns true if any range was moved, false otherwise
+	 * @note The offsets of moved ranges are updated in place. Meshes
+	 * 	that use the ranges pick up the new offsets automatically
+	 * 	before the next draw call.
+	 */
+	EXPORT bool compact();
+	/**
+	 * @brief Returns the number of pages
+	 * @return The number of buffer objects used by the heap
+	 */
+	EXPORT unsigned int get_num_pages();
+	/**
+	 * @brief Returns the total size of all pages
+	 * @return The capacity of the heap in bytes
+	 */
+	EXPORT unsigned int get_capacity();
+	/**
+	 * @brief Returns the amount of free memory
+	 * @return The number of free bytes over all pages
+	 */
+	EXPORT unsigned int get_free_size();
+	/**
+	 * @brief Returns the size of the largest free block
+	 * @return The size of the largest free block in bytes
+	 */
+	EXPORT unsigned int get_largest_free_block();
 };
 
 };
@@ -0,0 +1,297 @@
+#ifndef __BVH_H__
+#define __BVH_H__
+
+#include "app.h"
+#include "bounds.h"
+
+namespace sgltk {
+
+/**
+ * @struct BVH_Node
+ * @brief A node of a bounding volume hierarchy
+ */
+struct BVH_Node {
+	/**
+	 * @brief The bounding box of all primitives below the node
+	 */
+	AABB bounds;
+	/**
+	 * @brief The index of the first primitive of a leaf or the index of
+	 * 	the left child of an inner node. The right child directly
+	 * 	follows the left child.
+	 */
+	unsigned int first;
+	/**
+	 * @brief The number of primitives of a leaf, 0 for inner nodes
+	 */
+	unsigned int count;
+};
+
+/**
+ * @struct Ray_Hit
+ * @brief The intersection of a ray with a triangle
+ */
+struct Ray_Hit {
+	/**
+	 * @brief The index of the mesh in the model
+	 */
+	unsigned int mesh;
+	/**
+	 * @brief The index of the triangle in the index buffer of the mesh,
+	 * 	i.e. the index of its first index divided by 3
+	 */
+	unsigned int triangle;
+	/**
+	 * @brief The barycentric coordinates of the intersection relative
+	 * 	to the second and third vertex of the triangle
+	 */
+	glm::vec2 barycentrics;
+	/**
+	 * @brief The distance between the origin of the ray and the
+	 * 	intersection in units of the length of the direction
+	 */
+	float distance;
+};
+
+/**
+ * @struct Mesh_Triangle
+ * @brief Identifies a triangle of a model
+ */
+struct Mesh_Triangle {
+	/**
+	 * @brief The index of the mesh in the model
+	 */
+	unsigned int mesh;
+	/**
+	 * @brief The index of the triangle in the index buffer of the mesh
+	 */
+	unsigned int triangle;
+};
+
+/**
+ * @class BVH
+ * @brief A bounding volume hierarchy over arbitrary primitives
+ *
+ * The hierarchy is built top down with the binned surface area heuristic.
+ * Large subtrees are built in parallel on separate threads.
+ */
+class BVH {
+public:
+	/**
+	 * @brief The nodes, the root is the first node. Children are
+	 * 	always stored after their parents.
+	 */
+	std::vector<BVH_Node> nodes;
+	/**
+	 * @brief The indices of the primitives in the order they are
+	 * 	referenced by the leaves
+	 */
+	std::vector<unsigned int> primitives;
+
+	/**
+	 * @brief Builds the hierarchy
+	 * @param bounds The bounding box of every primitive
+	 * @param max_leaf_size The number of primitives below which a node
+	 * 	is not split any further
+	 * @param num_threads The largest number of threads to use,
+	 * 	0 to use one thread per hardware thread
+	 */
+	EXPORT void build(const std::vector<AABB>& bounds,
+			  unsigned int max_leaf_size = 4,
+			  unsigned int num_threads = 0);
+	/**
+	 * @brief Updates the bounding boxes of the nodes without changing
+	 * 	the structure of the hierarchy
+	 * @param bounds The new bounding box of every primitive
+	 * @note The queries stay correct after a refit, but they get slower
+	 * 	the more the primitives move relative to each other.
+	 */
+	EXPORT void refit(const std::vector<AABB>& bounds);
+	/**
+	 * @brief Returns true if the hierarchy contains no primitives
+	 */
+	bool empty() const {
+		return nodes.empty();
+	}
+	/**
+	 * @brief Intersects a ray with a bounding box using the slab test
+	 * @param box The bounding box
+	 * @param origin The origin of the ray
+	 * @param inverse_direction The reciprocal of every component of the
+	 * 	direction of the ray
+	 * @param max_distance The largest distance to search in units of the
+	 * 	length of the direction
+	 * @param distance Is set to the distance at which the ray enters the
+	 * 	box or 0 if the origin is inside of the box
+	 * @return Returns true if the ray hits the box before max_distance,
+	 * 	false otherwise
+	 */
+	EXPORT static bool intersect_ray(const AABB& box,
+					 const glm::vec3& origin,
+					 const glm::vec3& inverse_direction,
+					 float max_distance,
+					 float& distance);
+
+	/**
+	 * @brief Visits the primitives of all leaves whose nodes pass a test
+	 * @param node_test A function that is called with the bounding box of
+	 * 	a node and returns false to skip the node and its children
+	 * @param visit A function that is called with the index of every
+	 * 	primitive of the leaves that pass the test. Returning false
+	 * 	stops the traversal.
+	 */
+	template <typename Node_Test, typename Visit>
+	void traverse(Node_Test node_test, Visit visit) const {
+		if(nodes.empty())
+			return;
+
+		unsigned int stack[128];
+		unsigned int stack_size = 0;
+		stack[stack_size++] = 0;
+		while(stack_size > 0) {
+			const BVH_Node& node = nodes[stack[--stack_size]];
+			if(!node_test(node.bounds))
+				continue;
+			if(node.count > 0) {
+				for(unsigned int i = 0; i < node.count; i++) {
+					if(!visit(primitives[node.first + i]))
+						return;
+				}
+			} else {
+				stack[stack_size++] = node.first + 1;
+				stack[stack_size++] = node.first;
+			}
+		}
+	}
+};
+
+/**
+ * @class Triangle_BVH
+ * @brief Keeps a copy of the geometry of a mesh and a bounding volume
+ * 	hierarchy over its triangles for spatial queries
+ *
+ * All queries are made in the coordinate system of the mesh. Ray casts test
+ * the triangles of a leaf in packets of four with SSE, or eight with AVX if
+ * the library is compiled with AVX enabled.
+ */
+class Triangle_BVH {
+	std::vector<float> packets;
+	std::vector<unsigned int> node_packets;
+
+	bool cast(const glm::vec3& origin,
+		  const glm::vec3& direction,
+		  float max_distance,
+		  bool any_hit,
+		  Ray_Hit& hit) const;
+public:
+	/**
+	 * @brief The hierarchy over the triangles
+	 */
+	BVH bvh;
+	/**
+	 * @brief The vertex positions
+	 */
+	std::vector<glm::vec3> positions;
+	/**
+	 * @brief The indices of the triangle list
+	 */
+	std::vector<unsigned int> indices;
+
+	/**
+	 * @brief Copies the geometry and builds the hierarchy
+	 * @param indices The indices of the triangle list
+	 * @param positions A pointer to the position of the first vertex
+	 * @param stride The distance between the positions of two
+	 * 	consecutive vertices in bytes
+	 * @param num_vertices The number of vertices
+	 * @param num_threads The largest number of threads to use,
+	 * 	0 to use one thread per hardware thread
+	 * @return Returns true on success, false otherwise
+	 * @note This function can be called from any thread
+	 */
+	EXPORT bool build(const std::vector<unsigned int>& indices,
+			  const glm::vec3 *positions,
+			  unsigned int stride,
+			  unsigned int num_vertices,
+			  unsigned int num_threads = 0);
+	/**
+	 * @brief Returns the number of triangles
+	 */
+	EXPORT unsigned int get_num_triangles() const;
+	/**
+	 * @brief Returns the bounding box of all triangles
+	 */
+	EXPORT AABB get_bounds() const;
+	/**
+	 * @brief Finds the closest intersection of a ray with the triangles
+	 * @param origin The origin of the ray
+	 * @param direction The direction of the ray
+	 * @param max_distance The largest distance to search in units of
+	 * 	the length of the direction
+	 * @param hit Is set to the closest intersection. The mesh member is
+	 * 	not changed.
+	 * @return Returns true if the ray hits a triangle, false otherwise
+	 * @note Triangles are hit from both sides.
+	 */
+	EXPORT bool raycast(const glm::vec3& origin,
+			    const glm::vec3& direction,
+			    float max_distance,
+			    Ray_Hit& hit) const;
+	/**
+	 * @brief Tests whether a line segment intersects any triangle
+	 * @param start The start of the segment
+	 * @param end The end of the segment
+	 * @return Returns true if the segment intersects a triangle, false
+	 * 	otherwise
+	 */
+	EXPORT bool intersects_segment(const glm::vec3& start,
+				       const glm::vec3& end) const;
+	/**
+	 * @brief Finds all triangles that overlap a sphere
+	 * @param sphere The sphere
+	 * @param triangles The indices of the triangles are appended to
+	 * 	this list
+	 */
+	EXPORT void overlap_sphere(const Sphere& sphere,
+				   std::vector<unsigned int>& triangles) const;
+	/**
+	 * @brief Finds all triangles that are not completely outside of
+	 * 	a frustum
+	 * @param frustum The frustum
+	 * @param triangles The indices of the triangles are appended to
+	 * 	this list
+	 * @note Triangles near the edges of the frustum may be reported
+	 * 	even though they are outside of it.
+	 */
+	EXPORT void overlap_frustum(const Frustum& frustum,
+				    std::vector<unsigned int>& triangles) const;
+	/**
+	 * @brief Finds the point on the triangles closest to a point
+	 * @param point The point
+	 * @param max_distance The largest distance to search
+	 * @param closest Is set to the closest point on the triangles
+	 * @param triangle Is set to the index of the closest triangle
+	 * @return Returns true if a triangle closer than max_distance
+	 * 	exists, false otherwise
+	 */
+	EXPORT bool nearest_point(const glm::vec3& point,
+				  float max_distance,
+				  glm::vec3& closest,
+				  unsigned int& triangle) const;
+	/**
+	 * @brief Returns the point on a triangle closest to a point
+	 * @param point The point
+	 * @param a The first vertex of the triangle
+	 * @param b The second vertex of the triangle
+	 * @param c The third vertex of the triangle
+	 * @return The closest point
+	 */
+	EXPORT static glm::vec3 closest_point_on_triangle(const glm::vec3& point,
+							  const glm::vec3& a,
+							  const glm::vec3& b,
+							  const glm::vec3& c);
+};
+
+}
+
+#endif //__BVH_H__
@@ -2,6 +2,7 @@
 #define __CAMERA_H__
 
 #include "app.h"
+#include "bounds.h"
 
 namespace sgltk {
 
@@ -55,6 +56,12 @@ public:
 	 * @brief The right vector of the camera
 	 */
 	glm::vec3 right;
+	/**
+	 * @brief The view frustum in world space
+	 * @note The frustum is updated by update_view_matrix and
+	 * 	update_projection_matrix.
+	 */
+	Frustum frustum;
 
 	/**
 	 * @param position The camera position
@@ -75,6 +82,11 @@ public:
 	 * @brief Recalculates the projection matrix
 	 */
 	EXPORT virtual void update_projection_matrix() = 0;
+	/**
+	 * @brief Extracts the planes of the view frustum from the view and
+	 * 	projection matrices
+	 */
+	EXPORT void update_frustum();
 
 	/**
 	 * @brief Move the camera along the up vector
@@ -191,6 +203,22 @@ class P_Camera : public Camera {
 	 * 	5 - bottom
 	 */
 	EXPORT std::vector<float> calculate_frustum_distance(glm::vec3 point);
+	/**
+	 * @brief Calculates the ray through a pixel of the viewport, e.g.
+	 * 	to pick the object under the mouse cursor
+	 * @param x The x coordinate of the pixel, as passed to
+	 * 	Window::handle_mouse_button
+	 * @param y The y coordinate of the pixel, as passed to
+	 * 	Window::handle_mouse_button
+	 * @param origin Is set to the point of the ray on the near plane
+	 * @param direction Is set to the normalized direction of the ray
+	 * @note The viewport is assumed to cover the window and to have the
+	 * 	size given by the width and height members.
+	 * @see Model::raycast
+	 */
+	EXPORT void calculate_ray(int x, int y,
+				  glm::vec3& origin,
+				  glm::vec3& direction);
 };
 
 /**
@@ -0,0 +1,242 @@
+#ifndef __DRAW_BATCH_H__
+#define __DRAW_BATCH_H__
+
+#include "app.h"
+#include "buffer.h"
+#include "shader.h"
+#include "camera.h"
+#include "mesh.h"
+
+namespace sgltk {
+
+/**
+ * @struct Draw_Elements_Indirect_Command
+ * @brief The parameters of a single draw of glMultiDrawElementsIndirect
+ */
+struct Draw_Elements_Indirect_Command {
+	/**
+	 * @brief The number of indices
+	 */
+	GLuint count;
+	/**
+	 * @brief The number of instances
+	 */
+	GLuint instance_count;
+	/**
+	 * @brief The index of the first index in the index buffer
+	 */
+	GLuint first_index;
+	/**
+	 * @brief The value added to every index
+	 */
+	GLint base_vertex;
+	/**
+	 * @brief The first instance, used as the draw id
+	 */
+	GLuint base_instance;
+};
+
+/**
+ * @struct Draw_Data
+ * @brief The per draw data of a batch
+ *
+ * The layout matches the following std430 structure:
+ * @code
+ * struct Draw_Data {
+ * 	mat4 model_matrix;
+ * 	mat4 normal_matrix;
+ * 	uint material_index;
+ * };
+ * @endcode
+ */
+struct Draw_Data {
+	/**
+	 * @brief The model matrix including the position decoding of the
+	 * 	mesh
+	 */
+	glm::mat4 model_matrix;
+	/**
+	 * @brief The normal matrix stored in the upper left 3x3 part
+	 */
+	glm::mat4 normal_matrix;
+	/**
+	 * @brief The index of the material in the material buffer
+	 */
+	unsigned int material_index;
+	unsigned int padding[3];
+};
+
+/**
+ * @struct Material_Data
+ * @brief The material of a mesh in a batch
+ *
+ * The layout matches the following std430 structure:
+ * @code
+ * struct Material_Data {
+ * 	vec4 color_ambient;
+ * 	vec4 color_diffuse;
+ * 	vec4 color_specular;
+ * 	float shininess;
+ * 	float shininess_strength;
+ * };
+ * @endcode
+ */
+struct Material_Data {
+	glm::vec4 color_ambient;
+	glm::vec4 color_diffuse;
+	glm::vec4 color_specular;
+	float shininess;
+	float shininess_strength;
+	float padding[2];
+};
+
+/**
+ * @class Draw_Batch
+ * @brief Draws many meshes that share a shader, a vertex format and their
+ * 	textures with a single glMultiDrawElementsIndirect call
+ *
+ * The vertex and index data of the meshes is copied into buffers owned
+ * by the batch. The model matrices and materials are stored in shader
+ * storage buffers, the shader finds the data of the current draw using
+ * the draw id vertex attribute:
+ * @code
+ * layout(std430, binding = 0) buffer draw_data {
+ * 	Draw_Data draws[];
+ * };
+ * layout(std430, binding = 1) buffer material_data {
+ * 	Material_Data materials[];
+ * };
+ * in uint draw_id_in;
+ * @endcode
+ */
+class Draw_Batch {
+	GLuint vao;
+	Shader *shader;
+	glm::mat4 *view_matrix;
+	glm::mat4 *projection_matrix;
+
+	struct Batch_Entry {
+		Mesh *mesh;
+		unsigned int index_buffer;
+	};
+	std::vector<Batch_Entry> entries;
+	std::vector<Vertex_Attribute> format;
+	std::vector<unsigned int> strides;
+
+	std::vector<std::unique_ptr<Buffer> > vertex_buffers;
+	Buffer index_buffer;
+	Buffer command_buffer;
+	Buffer draw_buffer;
+	Buffer material_buffer;
+	Buffer draw_id_buffer;
+	GLenum index_type;
+
+	std::vector<Draw_Elements_Indirect_Command> commands;
+	std::vector<Draw_Data> draw_data;
+	std::vector<Material_Data> materials;
+	bool rebuild;
+	bool update_draw_data;
+
+	unsigned int draw_data_binding;
+	unsigned int material_binding;
+	std::string draw_id_name;
+	std::string view_matrix_name;
+	std::string projection_matrix_name;
+	std::string view_proj_matrix_name;
+
+	//sampler locations of the textures of the first mesh
+	std::vector<int> texture_locations;
+	Shader *location_shader;
+	unsigned int location_link_count;
+
+	bool compatible(Mesh& mesh);
+	unsigned int add_material(const Mesh& mesh);
+	void setup_vertex_format();
+	void update_texture_locations();
+public:
+	EXPORT Draw_Batch();
+	EXPORT ~Draw_Batch();
+
+	/**
+	 * @brief Specifies the shader to use to render the batch
+	 * @param shader The shader to be used to render the batch
+	 * @note The shader of the first mesh is used if none is set.
+	 */
+	EXPORT void setup_shader(Shader *shader);
+	/**
+	 * @brief Sets up the view and projection matrices
+	 * @param view_matrix The view matrix
+	 * @param projection_matrix The projection matrix
+	 * @return Returns true if both pointers are not nullptr, false
+	 * 	otherwise
+	 */
+	EXPORT bool setup_camera(glm::mat4 *view_matrix,
+				 glm::mat4 *projection_matrix);
+	/**
+	 * @brief Sets up the view and projection matrices
+	 * @param camera The camera to use
+	 * @return Returns true on success, false otherwise
+	 */
+	EXPORT bool setup_camera(Camera *camera);
+	/**
+	 * @brief Sets the binding points of the shader storage buffers
+	 * @param draw_data The binding point of the per draw data
+	 * @param material_data The binding point of the materials
+	 * @note The default binding points are 0 and 1
+	 */
+	EXPORT void set_storage_bindings(unsigned int draw_data,
+					 unsigned int material_data);
+	/**
+	 * @brief Sets the name of the draw id vertex attribute in the shader
+	 * @param name The new name. An empty string resets the name to the
+	 * 	default value "draw_id_in"
+	 */
+	EXPORT void set_draw_id_name(const std::string& name);
+
+	/**
+	 * @brief Adds a mesh to the batch
+	 * @param mesh The mesh to add
+	 * @param index_buffer The index buffer of the mesh to draw
+	 * @param model_matrix The model matrix to use
+	 *	  (nullptr to use the model_matrix member of the mesh)
+	 * @return Returns the index of the draw or -1 if the mesh can not
+	 * 	be added to the batch
+	 * @note The mesh has to use the same shader, vertex attributes and
+	 * 	textures as the first mesh of the batch and may not use
+	 * 	instanced attributes or attributes from external buffers.
+	 * 	The mesh has to outlive the batch.
+	 */
+	EXPORT int add(Mesh& mesh, unsigned int index_buffer = 0,
+		       const glm::mat4 *model_matrix = nullptr);
+	/**
+	 * @brief Changes the model matrix of a draw
+	 * @param draw The index of the draw returned by add
+	 * @param model_matrix The new model matrix
+	 */
+	EXPORT void set_model_matrix(unsigned int draw,
+				     const glm::mat4& model_matrix);
+	/**
+	 * @brief Removes all meshes from the batch
+	 */
+	EXPORT void clear();
+	/**
+	 * @brief Returns the number of draws in the batch
+	 */
+	EXPORT unsigned int get_num_draws();
+	/**
+	 * @brief Copies the vertex and index data of all meshes into the
+	 * 	buffers of the batch and creates the indirect commands
+	 * @return Returns true on success, false otherwise
+	 * @note This function is called by draw when meshes were added
+	 * 	since the last build.
+	 */
+	EXPORT bool build();
+	/**
+	 * @brief Draws all meshes of the batch
+	 */
+	EXPORT void draw();
+};
+
+}
+
+#endif //__DRAW_BATCH_H__
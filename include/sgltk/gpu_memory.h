@@ -0,0 +1,199 @@
+#ifndef __GPU_MEMORY_H__
+#define __GPU_MEMORY_H__
+
+#include "app.h"
+
+#include <functional>
+
+namespace sgltk {
+
+/**
+ * @brief The kinds of resources that occupy GPU memory
+ */
+enum class RESOURCE_KIND {
+	/**
+	 * @brief Buffers bound to GL_ARRAY_BUFFER
+	 */
+	VERTEX_BUFFER,
+	/**
+	 * @brief Buffers bound to GL_ELEMENT_ARRAY_BUFFER
+	 */
+	INDEX_BUFFER,
+	/**
+	 * @brief Buffers bound to GL_UNIFORM_BUFFER
+	 */
+	UNIFORM_BUFFER,
+	/**
+	 * @brief Buffers bound to GL_SHADER_STORAGE_BUFFER
+	 */
+	STORAGE_BUFFER,
+	/**
+	 * @brief Buffers bound to any other target
+	 */
+	OTHER_BUFFER,
+	/**
+	 * @brief Textures
+	 */
+	TEXTURE,
+	/**
+	 * @brief Renderbuffers
+	 */
+	RENDERBUFFER
+};
+
+/**
+ * @brief A summary of the GPU memory tracked by the Memory_Registry
+ */
+struct Memory_Snapshot {
+	/**
+	 * @brief The total number of bytes
+	 */
+	size_t total;
+	/**
+	 * @brief The number of tracked resources
+	 */
+	unsigned int num_resources;
+	/**
+	 * @brief The number of bytes per resource kind
+	 */
+	std::map<RESOURCE_KIND, size_t> kinds;
+	/**
+	 * @brief The number of bytes of buffers per usage hint
+	 */
+	std::map<GLenum, size_t> usages;
+	/**
+	 * @brief The number of bytes of textures and renderbuffers per
+	 * 	internal format
+	 */
+	std::map<GLenum, size_t> formats;
+	/**
+	 * @brief The number of bytes per owner. Resources that were
+	 * 	created outside of any owner scope are listed under an
+	 * 	empty name.
+	 */
+	std::map<std::string, size_t> owners;
+};
+
+/**
+ * @class Memory_Registry
+ * @brief Keeps a tally of the GPU memory allocated by the sgltk resources
+ *
+ * The sizes are estimated from the sizes and formats the resources were
+ * created with. Driver overhead and padding are not included.
+ */
+class Memory_Registry {
+	struct Entry {
+		RESOURCE_KIND kind;
+		GLenum hint;
+		size_t size;
+		std::string owner;
+	};
+
+	EXPORT static std::map<const void *, Entry> resources;
+	EXPORT static std::vector<std::string> owners;
+	EXPORT static std::vector<std::function<void(const Memory_Snapshot&)> > callbacks;
+	EXPORT static size_t total;
+	EXPORT static size_t budget;
+	EXPORT static bool budget_exceeded;
+
+	static void check_budget();
+public:
+	/**
+	 * @brief Returns the resource kind of a buffer bound to a target
+	 * @param target The buffer target
+	 * @return The resource kind
+	 */
+	EXPORT static RESOURCE_KIND get_buffer_kind(GLenum target);
+	/**
+	 * @brief Returns the number of bytes per pixel of an internal format
+	 * @param internal_format The internal format
+	 * @return The number of bytes per pixel. Unknown formats are
+	 * 	counted as 4 bytes.
+	 */
+	EXPORT static unsigned int get_format_size(GLenum internal_format);
+	/**
+	 * @brief Adds a resource to the registry or updates its entry
+	 * @param resource The address of the object that owns the resource
+	 * @param kind The kind of the resource
+	 * @param hint The usage hint of buffers or the internal format of
+	 * 	textures and renderbuffers
+	 * @param size The size of the resource in bytes
+	 * @note The owner of a resource is the innermost owner scope that
+	 * 	was active when the resource was first added.
+	 */
+	EXPORT static void track(const void *resource, RESOURCE_KIND kind,
+				 GLenum hint, size_t size);
+	/**
+	 * @brief Removes a resource from the registry
+	 * @param resource The address of the object that owns the resource
+	 */
+	EXPORT static void untrack(const void *resource);
+	/**
+	 * @brief Makes all resources that are created from now on belong
+	 * 	to an owner until pop_owner is called
+	 * @param name The name of the owner
+	 * @see Memory_Owner
+	 */
+	EXPORT static void push_owner(const std::string& name);
+	/**
+	 * @brief Ends the innermost owner scope
+	 */
+	EXPORT static void pop_owner();
+	/**
+	 * @brief Returns the total number of tracked bytes
+	 * @return The total number of bytes
+	 */
+	EXPORT static size_t get_total();
+	/**
+	 * @brief Returns a summary of the tracked resources
+	 * @return The snapshot
+	 */
+	EXPORT static Memory_Snapshot get_snapshot();
+	/**
+	 * @brief Sets a soft memory budget
+	 * @param bytes The budget in bytes. 0 disables the budget.
+	 * @note Exceeding the budget does not prevent any allocations.
+	 */
+	EXPORT static void set_budget(size_t bytes);
+	/**
+	 * @brief Returns the soft memory budget
+	 * @return The budget in bytes or 0 if no budget is set
+	 */
+	EXPORT static size_t get_budget();
+	/**
+	 * @brief Adds a function that is called with a snapshot of the
+	 * 	registry whenever the total exceeds the budget after having
+	 * 	been within the budget
+	 * @param callback The function to call
+	 */
+	EXPORT static void add_budget_callback(std::function<void(const Memory_Snapshot&)> callback);
+	/**
+	 * @brief Removes all budget callbacks
+	 */
+	EXPORT static void clear_budget_callbacks();
+};
+
+/**
+ * @class Memory_Owner
+ * @brief Attributes all resources created during its lifetime to an owner
+ */
+class Memory_Owner {
+public:
+	/**
+	 * @param name The name of the owner
+	 */
+	Memory_Owner(const std::string& name) {
+		Memory_Registry::push_owner(name);
+	}
+
+	~Memory_Owner() {
+		Memory_Registry::pop_owner();
+	}
+
+	Memory_Owner(const Memory_Owner&) = delete;
+	Memory_Owner& operator=(const Memory_Owner&) = delete;
+};
+
+}
+
+#endif //__GPU_MEMORY_H__
@@ -6,6 +6,10 @@
 #include "shader.h"
 #include "camera.h"
 #include "texture.h"
+#include "mesh_optimizer.h"
+#include "bounds.h"
+#include "bvh.h"
+#include "mesh_data.h"
 
 namespace sgltk {
 
@@ -132,27 +136,163 @@ typedef EXPORT struct Vertex {
 } Vertex;
 
 
+/**
+ * @struct Vertex_Attribute
+ * @brief Describes where a vertex attribute of a mesh is read from
+ */
+struct Vertex_Attribute {
+	/**
+	 * @brief The location of the attribute
+	 */
+	int location;
+	/**
+	 * @brief The index of the vertex buffer of the mesh the attribute is
+	 * 	read from
+	 */
+	unsigned int buffer_index;
+	/**
+	 * @brief The buffer the attribute is read from if it is not one of
+	 * 	the vertex buffers of the mesh, nullptr otherwise
+	 */
+	Buffer *external_buffer;
+	/**
+	 * @brief The number of components
+	 */
+	GLint number_elements;
+	/**
+	 * @brief The data type of the components
+	 */
+	GLenum type;
+	/**
+	 * @brief True if integer components are normalized
+	 */
+	bool normalized;
+	/**
+	 * @brief The distance between two consecutive attributes in bytes
+	 */
+	GLsizei stride;
+	/**
+	 * @brief The offset of the first attribute in the vertex buffer
+	 */
+	const GLvoid *pointer;
+	/**
+	 * @brief The instance divisor
+	 */
+	unsigned int divisor;
+};
+
 /**
  * @class Mesh
  * @brief Manages meshes
  */
 class Mesh {
+	friend class Render_Queue;
+	friend class Model;
+
 	GLuint vao;
+	bool shares_vertex_array;
+	GLint base_vertex;
+	GLuint base_instance;
 	GLenum tf_mode;
 
 	glm::mat4 *view_matrix;
 	glm::mat4 *projection_matrix;
+	const Frustum *camera_frustum;
 
 	std::vector<std::unique_ptr<Buffer> > vbo;
+	std::vector<Buffer_Range*> vbo_ranges;
 
-	GLenum index_type;
 	std::vector<std::unique_ptr<Buffer> > ibo;
+	std::vector<Buffer_Range*> ibo_ranges;
+	std::vector<GLenum> ibo_types;
+
+	struct Lod {
+		unsigned int index_buffer;
+		float error;
+	};
+	std::vector<Lod> lods;
+
+	std::unique_ptr<Buffer> cluster_buffer;
+	unsigned int cluster_index_buffer;
+
+	std::shared_ptr<Triangle_BVH> bvh;
 
 	std::vector<Buffer*> attached_buffers;
 	std::vector<GLuint> attached_buffers_targets;
 	std::vector<unsigned int> attached_buffers_indices;
 
+	struct Range_Attribute {
+		int location;
+		Buffer_Range *range;
+		unsigned int offset;
+		GLint number_elements;
+		GLenum type;
+		bool normalized;
+		GLsizei stride;
+		const GLvoid *pointer;
+		unsigned int divisor;
+	};
+	std::vector<Range_Attribute> range_attributes;
+	std::vector<Vertex_Attribute> vertex_attributes;
+
+	struct Uniform_Locations {
+		int model_matrix;
+		int view_matrix;
+		int projection_matrix;
+		int model_view_matrix;
+		int view_proj_matrix;
+		int model_view_projection_matrix;
+		int normal_matrix;
+		int ambient_color;
+		int diffuse_color;
+		int specular_color;
+		int shininess;
+		int shininess_strength;
+		//sampler locations of textures followed by auto_textures
+		std::vector<int> textures;
+	};
+	Uniform_Locations locations;
+	Shader *location_shader;
+	unsigned int location_link_count;
+
+	void update_uniform_locations();
 	void material_uniform();
+	void set_matrix_uniforms(const glm::mat4& model_matrix);
+	bool set_draw_uniforms(const glm::mat4& model_matrix);
+	bool set_instanced_uniforms();
+	void share_vertex_array(Mesh& owner, GLint base_vertex);
+	void copy_properties(const Mesh_Data& data);
+	void vertex_attrib_pointer(int attrib_location,
+				   Buffer *buffer,
+				   GLint number_elements,
+				   GLenum type,
+				   bool normalized,
+				   GLsizei stride,
+				   const GLvoid *pointer,
+				   unsigned int divisor);
+	int set_attribute(int attrib_location,
+			  unsigned int buffer_index,
+			  GLint number_elements,
+			  GLenum type,
+			  bool normalized,
+			  GLsizei stride,
+			  const GLvoid *pointer,
+			  unsigned int divisor);
+	void remove_range_attribute(int attrib_location);
+	void update_range_attributes();
+	void bind_vertex_state();
+	void release_vertex_state();
+	bool draw_elements(GLenum mode, unsigned int index_buffer,
+			   unsigned int num_instances = 0);
+	void draw_unculled(GLenum mode, unsigned int index_buffer,
+			   const glm::mat4& model_matrix);
+	bool bind_index_buffer(unsigned int index_buffer,
+			       unsigned int& number_elements,
+			       unsigned int& offset,
+			       GLenum& type);
+	void record_attribute(const Vertex_Attribute& attribute);
+	void write_indices(unsigned int index_buffer,
+			   const std::vector<unsigned int>& indices);
 public:
 	/**
 	 * @brief Number of texture coordinates
@@ -168,6 +308,8 @@ public:
 	unsigned int num_vertices;
 	/**
 	 * @brief The name of the ambient materiel component
+	 * @note The locations of the uniforms are looked up once per shader.
+	 * 	Use the set_*_name functions to change the names.
 	 */
 	std::string ambient_color_name;
 	/**
@@ -221,13 +363,32 @@ public:
 	 */
 	Shader *shader;
 	/**
-	 * @brief The bounding box
+	 * @brief The bounding box in the coordinate system of the mesh
+	 */
+	AABB bounding_box;
+	/**
+	 * @brief The bounding sphere in the coordinate system of the mesh
+	 */
+	Sphere bounding_sphere;
+	/**
+	 * @brief The clusters of the mesh
+	 * @see build_clusters
 	 */
-	std::vector<glm::vec3> bounding_box;
+	std::vector<Mesh_Cluster> clusters;
 	/**
 	 * @brief The model matrix
 	 */
 	glm::mat4 model_matrix;
+	/**
+	 * @brief A transformation that is applied to the vertex positions
+	 * 	before the model matrix. It maps positions that were
+	 * 	quantized relative to the bounding box back into the
+	 * 	coordinate system of the mesh. Defaults to the identity.
+	 * @note The matrix is folded into the model matrix by the draw
+	 * 	functions. Instanced draws have to include it in the
+	 * 	instance model matrices.
+	 */
+	glm::mat4 position_decode;
 	/**
 	 * @brief The shininess of the material
 	 */
@@ -266,6 +427,20 @@ public:
 	 * 	  back face culling
 	 */
 	bool twosided;
+	/**
+	 * @brief Indicates that the mesh is blended with the scene behind it
+	 * 	and has to be drawn back to front
+	 * @see Render_Queue
+	 */
+	bool transparent;
+	/**
+	 * @brief Indicates that draw skips the mesh if its bounds are
+	 * 	outside of the view frustum. Defaults to true.
+	 * @note The bounds describe the mesh as it was uploaded. Disable
+	 * 	culling for meshes whose vertices are moved by a shader.
+	 * 	Model disables it for meshes with bones.
+	 */
+	bool frustum_culling;
 
 	EXPORT Mesh();
 	EXPORT ~Mesh();
@@ -429,6 +604,16 @@ public:
 	template <typename T>
 	unsigned int attach_vertex_buffer(const std::vector<T>& vertexdata,
 					  GLenum usage = GL_STATIC_DRAW);
+	/**
+	 * @brief Attaches a range of a buffer heap as a vertex buffer
+	 * @param range The range containing the vertex data
+	 * @return Returns the index of the buffer in the list of all attached
+	 * 	vertex buffers
+	 * @note The range is not owned by the mesh. The vertex attributes
+	 * 	pointing into the range are updated automatically if the
+	 * 	heap is compacted.
+	 */
+	EXPORT unsigned int attach_vertex_range(Buffer_Range *range);
 	/**
 	 * @brief Overwrites all data in a vertex buffer
 	 * @param buffer_index The index of the buffer to be modified
@@ -649,30 +834,369 @@ public:
 				        GLsizei stride,
 				        const GLvoid *pointer,
 				        unsigned int divisor = 0);
+	/**
+	 * @brief Sets pointers to vertex attributes that are stored as
+	 * 	normalized integers or packed formats
+	 * @param attrib_name		The attribute name in the shader
+	 * @param buffer_index		The index of the buffer that contains
+	 *				the attribute
+	 * @param number_elements	Number of elements
+	 * @param type			Element type, e.g. GL_UNSIGNED_BYTE,
+	 * 				GL_UNSIGNED_SHORT or
+	 * 				GL_INT_2_10_10_10_REV
+	 * @param stride		Memory offset between vertices
+	 * @param pointer		The offset of the attribute in the
+	 * 				vertex structure
+	 * @param divisor Determines how many instances share the same attribute value.
+	 * 		0 means that every shader instance gets a new value,
+	 * 		1 means every mesh instance gets a new value,
+	 * 		2 means that two instances get the same value and so on.
+	 * @return	Returns 0 on success, -1 if no shader was
+	 * 		specified for the mesh, -2 if the vertex attribute
+	 * 		could not be found, -3 if the buffer index is
+	 * 		invalid
+	 * @note Unsigned values are mapped to the range [0, 1] and signed
+	 * 	values to the range [-1, 1] when they are read by the shader.
+	 */
+	EXPORT int set_normalized_vertex_attribute(const std::string& attrib_name,
+						   unsigned int buffer_index,
+						   GLint number_elements,
+						   GLenum type,
+						   GLsizei stride,
+						   const GLvoid *pointer,
+						   unsigned int divisor = 0);
+	/**
+	 * @brief Sets pointers to vertex attributes that are stored as
+	 * 	normalized integers or packed formats
+	 * @param attrib_location	The attribute location in the shader
+	 * @param buffer_index		The index of the buffer that contains
+	 *				the attribute
+	 * @param number_elements	Number of elements
+	 * @param type			Element type, e.g. GL_UNSIGNED_BYTE,
+	 * 				GL_UNSIGNED_SHORT or
+	 * 				GL_INT_2_10_10_10_REV
+	 * @param stride		Memory offset between vertices
+	 * @param pointer		The offset of the attribute in the
+	 * 				vertex structure
+	 * @param divisor Determines how many instances share the same attribute value.
+	 * 		0 means that every shader instance gets a new value,
+	 * 		1 means every mesh instance gets a new value,
+	 * 		2 means that two instances get the same value and so on.
+	 * @return	Returns 0 on success, -2 if the vertex attribute
+	 * 		could not be found, -3 if the buffer index is
+	 * 		invalid
+	 * @note Unsigned values are mapped to the range [0, 1] and signed
+	 * 	values to the range [-1, 1] when they are read by the shader.
+	 */
+	EXPORT int set_normalized_vertex_attribute(int attrib_location,
+						   unsigned int buffer_index,
+						   GLint number_elements,
+						   GLenum type,
+						   GLsizei stride,
+						   const GLvoid *pointer,
+						   unsigned int divisor = 0);
 	/**
 	 * @brief Attaches an index array to the mesh
 	 * @param indices Indices describing the topology of the mesh
-	 * @return Returns the index of the index-buffer or -1 on failure.
-	 * 	   This function will fail if the index type does not match that
-	 * 	   of an already attached buffer
-	 * @note You can attach multiple index arrays
+	 * @return Returns the index of the index-buffer or -1 on failure
+	 * @note You can attach multiple index arrays. Each index array
+	 * 	keeps its own index type.
 	 */
 	template <typename T>
 	int attach_index_buffer(const std::vector<T>& indices);
+	/**
+	 * @brief Attaches an index array to the mesh and stores it using
+	 * 	the narrowest index type that can hold every index
+	 * @param indices Indices describing the topology of the mesh
+	 * @param narrow If true the indices are converted to the type
+	 * 	returned by get_index_type, otherwise they are stored as
+	 * 	32-bit indices
+	 * @return Returns the index of the index-buffer or -1 on failure
+	 */
+	EXPORT int attach_index_buffer(const std::vector<unsigned int>& indices,
+				       bool narrow);
+	/**
+	 * @brief Attaches a range of a buffer heap as an index buffer
+	 * @param range The range containing the indices
+	 * @param type The type of the indices. Must be GL_UNSIGNED_BYTE,
+	 * 	GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+	 * @return Returns the index of the index-buffer or -1 on failure
+	 * @note The range is not owned by the mesh
+	 */
+	EXPORT int attach_index_range(Buffer_Range *range, GLenum type);
+	/**
+	 * @brief Uploads mesh data that was prepared in main memory
+	 * @param data The vertex buffers, indices, levels of detail and
+	 * 	bounds of the mesh
+	 * @param vertex_heap The heap to store the vertex buffers in or
+	 * 	nullptr to create separate buffers
+	 * @param index_heap The heap to store the indices in or nullptr to
+	 * 	create separate buffers
+	 * @param usage A hint as to how the buffers will be accessed.
+	 * 	Valid values are GL_{STREAM,STATIC,DYNAMIC}_{DRAW,READ,COPY}.
+	 * @return Returns true on success, false otherwise
+	 * @note The buffers of the data are appended to the buffers that
+	 * 	are already attached. The indices are stored using the
+	 * 	narrowest index type. Ranges of the heaps are not owned by the
+	 * 	mesh. If a shader has been set up, the vertex attributes are
+	 * 	set as well.
+	 * @see set_vertex_attributes
+	 */
+	EXPORT bool upload(const Mesh_Data& data,
+			   Buffer_Heap *vertex_heap = nullptr,
+			   Buffer_Heap *index_heap = nullptr,
+			   GLenum usage = GL_STATIC_DRAW);
+	/**
+	 * @brief Sets the pointers to a list of vertex attributes
+	 * @param streams The attributes. The buffer indices refer to the
+	 * 	list of all attached vertex buffers.
+	 * @return Returns the number of attributes that were found in the
+	 * 	shader
+	 */
+	EXPORT unsigned int set_vertex_attributes(const std::vector<Vertex_Stream>& streams);
+	/**
+	 * @brief Returns the narrowest index type that can hold all indices
+	 * @param indices The indices
+	 * @return Returns GL_UNSIGNED_SHORT if all indices are smaller than
+	 * 	65536 and GL_UNSIGNED_INT otherwise
+	 * @note GL_UNSIGNED_BYTE is never returned because many GPUs do
+	 * 	not support 8-bit indices natively and the driver converts
+	 * 	them on every draw call.
+	 */
+	EXPORT static GLenum get_index_type(const std::vector<unsigned int>& indices);
+	/**
+	 * @brief Returns the type of an index buffer
+	 * @param index_buffer The index of the index buffer
+	 * @return Returns GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT,
+	 * 	GL_UNSIGNED_INT or 0 if the index buffer does not exist
+	 */
+	EXPORT GLenum get_index_buffer_type(unsigned int index_buffer);
+	/**
+	 * @brief Reads the indices of an index buffer back from the GPU
+	 * @param index_buffer The index of the index buffer
+	 * @param indices The vector that receives the indices
+	 * @return Returns true on success, false otherwise
+	 */
+	EXPORT bool read_indices(unsigned int index_buffer,
+				 std::vector<unsigned int>& indices);
+	/**
+	 * @brief Returns the number of attached vertex buffers and ranges
+	 */
+	EXPORT unsigned int get_num_vertex_buffers();
+	/**
+	 * @brief Returns the part of a buffer object that holds the data
+	 * 	of a vertex buffer
+	 * @param buffer_index The index of the vertex buffer
+	 * @return The buffer object, offset and size of the data. The buffer
+	 * 	is nullptr if the vertex buffer does not exist.
+	 */
+	EXPORT Buffer_Range get_vertex_buffer_range(unsigned int buffer_index);
+	/**
+	 * @brief Returns the vertex attributes that were set up for the mesh
+	 */
+	EXPORT const std::vector<Vertex_Attribute>& get_vertex_attributes();
 
 	/**
-	 * @brief Computes the bounding box of the mesh
+	 * @brief Computes the bounding box and the bounding sphere of the
+	 * 	mesh
 	 * @param vertexdata The vertices of the mesh
-	 * @param pointer The pointer to the position vector in the vertex
-	 * 	structure
+	 * @param pointer The offset of the position vector in the vertex
+	 * 	structure in bytes
 	 */
 	template <typename T>
 	void compute_bounding_box(const std::vector<T>& vertexdata, unsigned int pointer);
+	/**
+	 * @brief Reorders the triangles of all attached index buffers to
+	 * 	make better use of the post-transform vertex cache
+	 * @param cache_size The number of entries in the vertex cache
+	 * @param positions A pointer to the vertex positions or nullptr.
+	 * 	If positions are specified, the triangle clusters are
+	 * 	additionally sorted to reduce overdraw.
+	 * @param stride The distance between the positions of two
+	 * 	consecutive vertices in bytes
+	 * @return The vertex cache statistics of all index buffers before
+	 * 	and after the optimization
+	 * @note The indices are read back from the GPU, which stalls the
+	 * 	pipeline. The indices are expected to describe triangle
+	 * 	lists. Reordering the vertices themselves requires the vertex
+	 * 	data on the CPU, see Mesh_Optimizer::optimize_vertex_fetch.
+	 */
+	EXPORT Vertex_Cache_Report optimize(unsigned int cache_size = 16,
+					    const glm::vec3 *positions = nullptr,
+					    unsigned int stride = sizeof(glm::vec3));
+	/**
+	 * @brief Generates a chain of levels of detail by simplifying the
+	 * 	first index buffer
+	 * @param positions A pointer to the position of the first vertex
+	 * @param stride The distance between the positions of two
+	 * 	consecutive vertices in bytes
+	 * @param num_levels The number of levels to generate
+	 * @param ratio The number of triangles of each level relative to
+	 * 	the previous level
+	 * @return Returns the number of generated levels
+	 * @note Every level is attached as an additional index buffer that
+	 * 	references the original vertex buffers. The generation
+	 * 	stops early if a level can not be simplified any further.
+	 * @see Mesh_Optimizer::simplify
+	 */
+	EXPORT unsigned int generate_lods(const glm::vec3 *positions,
+					  unsigned int stride = sizeof(glm::vec3),
+					  unsigned int num_levels = 4,
+					  float ratio = 0.5f);
+	/**
+	 * @brief Adds an already attached index buffer as a level of detail
+	 * @param index_buffer The index of the index buffer
+	 * @param error The largest distance between the surface of the
+	 * 	level and the original surface in object space
+	 * @note The levels are ordered by their error.
+	 */
+	EXPORT void attach_lod(unsigned int index_buffer, float error);
+	/**
+	 * @brief Returns the number of levels of detail including the
+	 * 	full resolution mesh
+	 */
+	EXPORT unsigned int get_num_lods();
+	/**
+	 * @brief Returns the error of a level of detail
+	 * @param level The level, 0 being the full resolution mesh
+	 * @return The largest distance between the surface of the level
+	 * 	and the original surface in object space
+	 */
+	EXPORT float get_lod_error(unsigned int level);
+	/**
+	 * @brief Selects the coarsest level of detail whose error is
+	 * 	smaller than the threshold when projected onto the screen
+	 * @param model_matrix The model matrix the mesh will be drawn with
+	 * @param threshold The largest acceptable error as a fraction of
+	 * 	the viewport height, e.g. 1.0 / 1080 for one pixel on a
+	 * 	1080p screen
+	 * @return Returns the index of the index buffer of the level.
+	 * 	Returns 0 if the camera is not set up or is inside the
+	 * 	bounding sphere of the mesh.
+	 * @note The size of the mesh on the screen is estimated from the
+	 * 	bounding sphere of the bounding box.
+	 */
+	EXPORT unsigned int select_lod(const glm::mat4& model_matrix,
+				       float threshold);
+	/**
+	 * @brief Splits an index buffer into clusters of neighboring
+	 * 	triangles that can be culled individually
+	 * @param positions A pointer to the position of the first vertex
+	 * @param stride The distance between the positions of two
+	 * 	consecutive vertices in bytes
+	 * @param index_buffer The index buffer to split
+	 * @param max_vertices The largest number of distinct vertices of a
+	 * 	cluster
+	 * @param max_triangles The largest number of triangles of a cluster
+	 * @return Returns the number of clusters
+	 * @note The index buffer is reordered. The clusters are stored in
+	 * 	the clusters member and in a shader storage buffer that is
+	 * 	returned by get_cluster_buffer. The positions have to be
+	 * 	in the coordinate system of the bounding box, i.e. without
+	 * 	the position compression.
+	 * @see Mesh_Optimizer::build_clusters
+	 */
+	EXPORT unsigned int build_clusters(const glm::vec3 *positions,
+					   unsigned int stride = sizeof(glm::vec3),
+					   unsigned int index_buffer = 0,
+					   unsigned int max_vertices = 64,
+					   unsigned int max_triangles = 124);
+	/**
+	 * @brief Returns the shader storage buffer containing the clusters
+	 * @return Returns the buffer or nullptr if build_clusters has not
+	 * 	been called. The layout of the elements is described in
+	 * 	Mesh_Cluster.
+	 */
+	EXPORT Buffer *get_cluster_buffer();
+
+	/**
+	 * @brief Builds a bounding volume hierarchy over the triangles of an
+	 * 	index buffer for ray casts and overlap queries on the CPU
+	 * @param positions A pointer to the position of the first vertex
+	 * @param stride The distance between the positions of two
+	 * 	consecutive vertices in bytes
+	 * @param index_buffer The index buffer containing the triangles
+	 * @return Returns true on success, false otherwise
+	 * @note The positions are copied, the hierarchy has to be rebuilt
+	 * 	if they change. The positions have to be in the coordinate
+	 * 	system of the bounding box, i.e. without the position
+	 * 	compression.
+	 */
+	EXPORT bool build_bvh(const glm::vec3 *positions,
+			      unsigned int stride = sizeof(glm::vec3),
+			      unsigned int index_buffer = 0);
+	/**
+	 * @brief Builds a bounding volume hierarchy over the triangles of an
+	 * 	index list for ray casts and overlap queries on the CPU
+	 * @param indices The indices of the triangle list
+	 * @param positions A pointer to the position of the first vertex
+	 * @param stride The distance between the positions of two
+	 * 	consecutive vertices in bytes
+	 * @return Returns true on success, false otherwise
+	 */
+	EXPORT bool build_bvh(const std::vector<unsigned int>& indices,
+			      const glm::vec3 *positions,
+			      unsigned int stride = sizeof(glm::vec3));
+	/**
+	 * @brief Returns the bounding volume hierarchy of the triangles
+	 * @return Returns the hierarchy or nullptr if build_bvh has not
+	 * 	been called. The queries of the hierarchy are made in the
+	 * 	coordinate system of the mesh.
+	 */
+	EXPORT const Triangle_BVH *get_bvh() const;
+	/**
+	 * @brief Finds the closest intersection of a ray with the triangles
+	 * 	of the mesh
+	 * @param origin The origin of the ray
+	 * @param direction The direction of the ray
+	 * @param hit Is set to the closest intersection. The mesh member is
+	 * 	not changed.
+	 * @param max_distance The largest distance to search in units of
+	 * 	the length of the direction
+	 * @param model_matrix The model matrix to use
+	 *	  (nullptr to use the model_matrix member)
+	 * @return Returns true if the ray hits a triangle, false otherwise
+	 *	  or if build_bvh has not been called
+	 * @note The ray is transformed into the coordinate system of the
+	 * 	mesh, so the distance of the hit is measured along the
+	 * 	untransformed direction.
+	 */
+	EXPORT bool raycast(const glm::vec3& origin,
+			    const glm::vec3& direction,
+			    Ray_Hit& hit,
+			    float max_distance = std::numeric_limits<float>::max(),
+			    const glm::mat4 *model_matrix = nullptr);
+
+	/**
+	 * @brief Renders the clusters of the mesh that are inside the view
+	 * 	frustum and not facing away from the camera with a single
+	 * 	glMultiDrawElements call
+	 * @param model_matrix The model matrix to use
+	 *	  (nullptr to use the model_matrix member)
+	 * @return Returns the number of clusters that were drawn
+	 * @note Back facing clusters are only culled if the twosided member
+	 * 	is false. Without clusters or camera matrices the whole
+	 * 	index buffer is drawn. Transform feedback is not supported.
+	 * @see build_clusters
+	 */
+	EXPORT unsigned int draw_clusters(const glm::mat4 *model_matrix = nullptr);
+
+	/**
+	 * @brief Tests whether the mesh is at least partially inside the
+	 * 	view frustum
+	 * @param model_matrix The model matrix to use
+	 * @return Returns false if the bounds of the mesh are outside of the
+	 * 	view frustum, true otherwise or if the camera matrices or
+	 * 	the bounds are not set up
+	 */
+	EXPORT bool is_visible(const glm::mat4& model_matrix);
 
 	/**
 	 * @brief Renders the mesh using the first index buffer
 	 * @param mode Specifies the primitive that will be created from
 	 * 	vertices
+	 * @note The mesh is skipped if frustum_culling is true and the
+	 * 	mesh is not visible.
 	 */
 	EXPORT void draw(GLenum mode);
 
@@ -722,8 +1246,7 @@ int Mesh::add_vertex_attribute(std::string attrib_name,
 			       const T *data,
 			       GLenum usage) {
 
-	std::vector<T> tmp(data, data + number_elements);
-	unsigned int buffer_index = attach_vertex_buffer<T>(tmp, usage);
+	unsigned int buffer_index = attach_vertex_buffer<T>(data, number_elements, usage);
 	return set_vertex_attribute(attrib_name, buffer_index, number_elements, type, 0, 0);
 }
 
@@ -745,8 +1268,7 @@ int Mesh::add_vertex_attribute(int attrib_location,
 			       const T *data,
 			       GLenum usage) {
 
-	std::vector<T> tmp(data, data + number_elements);
-	unsigned int buffer_index = attach_vertex_buffer<T>(tmp, usage);
+	unsigned int buffer_index = attach_vertex_buffer<T>(data, number_elements, usage);
 	return set_vertex_attribute(attrib_location, buffer_index, number_elements, type, 0, 0);
 }
 
@@ -766,33 +1288,26 @@ unsigned int Mesh::attach_vertex_buffer(const T *vertexdata,
 					unsigned int number_elements,
 					GLenum usage) {
 
-	std::vector<T> tmp(vertexdata, vertexdata + number_elements);
-	return attach_vertex_buffer<T>(tmp, usage);
-}
-
-template <typename T>
-unsigned int Mesh::attach_vertex_buffer(const std::vector<T>& vertexdata,
-					GLenum usage) {
-
 	std::unique_ptr<Buffer> buf = std::make_unique<Buffer>(GL_ARRAY_BUFFER);
-	buf->load<T>(vertexdata, usage);
+	buf->load<T>(number_elements, vertexdata, usage);
 	vbo.push_back(std::move(buf));
+	vbo_ranges.push_back(nullptr);
 
 	return vbo.size() - 1;
 }
 
 template <typename T>
-bool Mesh::replace_buffer_data(unsigned int buffer_index,
-			       const T *data,
-			       unsigned int number_elements) {
+unsigned int Mesh::attach_vertex_buffer(const std::vector<T>& vertexdata,
+					GLenum usage) {
 
-	std::vector<T> tmp(data, data + number_elements);
-	return replace_buffer_data<T>(buffer_index, tmp);
+	return attach_vertex_buffer<T>(vertexdata.data(), vertexdata.size(),
+				       usage);
 }
 
 template <typename T>
 bool Mesh::replace_buffer_data(unsigned int buffer_index,
-			       const std::vector<T>& data) {
+			       const T *data,
+			       unsigned int number_elements) {
 
 	if(buffer_index >= vbo.size()) {
 		App::error_string.push_back("The value of the variable"
@@ -801,25 +1316,34 @@ bool Mesh::replace_buffer_data(unsigned int buffer_index,
 		return false;
 	}
 
-	vbo[buffer_index]->replace_data(data);
+	if(vbo_ranges[buffer_index]) {
+		Buffer_Range *range = vbo_ranges[buffer_index];
+		if(number_elements * sizeof(T) > range->size) {
+			App::error_string.push_back("The data does not fit "
+					"into the buffer range.");
+			return false;
+		}
+		return range->buffer->replace_partial_data(range->offset, data,
+							   number_elements);
+	}
+
+	vbo[buffer_index]->replace_data(data, number_elements);
 
 	return true;
 }
 
 template <typename T>
-bool Mesh::replace_partial_data(unsigned int buffer_index,
-				unsigned int offset,
-				const T *data,
-				unsigned int number_elements) {
+bool Mesh::replace_buffer_data(unsigned int buffer_index,
+			       const std::vector<T>& data) {
 
-	std::vector<T> tmp(data, data + number_elements);
-	return replace_partial_data<T>(buffer_index, offset, tmp);
+	return replace_buffer_data<T>(buffer_index, data.data(), data.size());
 }
 
 template <typename T>
 bool Mesh::replace_partial_data(unsigned int buffer_index,
 				unsigned int offset,
-				const std::vector<T>& data) {
+				const T *data,
+				unsigned int number_elements) {
 
 	if(buffer_index >= vbo.size()) {
 		App::error_string.push_back("The value of the variable"
@@ -828,66 +1352,69 @@ bool Mesh::replace_partial_data(unsigned int buffer_index,
 		return false;
 	}
 
-	return vbo[buffer_index]->replace_partial_data(offset, data);
+	if(vbo_ranges[buffer_index]) {
+		Buffer_Range *range = vbo_ranges[buffer_index];
+		if(offset + number_elements * sizeof(T) > range->size) {
+			App::error_string.push_back("The data does not fit "
+					"into the buffer range.");
+			return false;
+		}
+		return range->buffer->replace_partial_data(range->offset + offset,
+							   data,
+							   number_elements);
+	}
+
+	return vbo[buffer_index]->replace_partial_data(offset, data,
+						       number_elements);
+}
+
+template <typename T>
+bool Mesh::replace_partial_data(unsigned int buffer_index,
+				unsigned int offset,
+				const std::vector<T>& data) {
+
+	return replace_partial_data<T>(buffer_index, offset, data.data(),
+				       data.size());
 }
 
 
 template <>
 inline int Mesh::attach_index_buffer<unsigned char>(const std::vector<unsigned char>& indices) {
-	if(index_type && index_type != GL_UNSIGNED_BYTE)
-		return -1;
-
-	index_type = GL_UNSIGNED_BYTE;
 	std::unique_ptr<Buffer> index = std::make_unique<Buffer>(GL_ELEMENT_ARRAY_BUFFER);
 	index->load<unsigned char>(indices, GL_STATIC_DRAW);
 	ibo.push_back(std::move(index));
+	ibo_ranges.push_back(nullptr);
+	ibo_types.push_back(GL_UNSIGNED_BYTE);
 	return ibo.size() - 1;
 }
 
 template <>
 inline int Mesh::attach_index_buffer<unsigned short>(const std::vector<unsigned short>& indices) {
-	if(index_type && index_type != GL_UNSIGNED_SHORT)
-		return -1;
-
-	index_type = GL_UNSIGNED_SHORT;
 	std::unique_ptr<Buffer> index = std::make_unique<Buffer>(GL_ELEMENT_ARRAY_BUFFER);
 	index->load<unsigned short>(indices, GL_STATIC_DRAW);
 	ibo.push_back(std::move(index));
+	ibo_ranges.push_back(nullptr);
+	ibo_types.push_back(GL_UNSIGNED_SHORT);
 	return ibo.size() - 1;
 }
 
 template <>
 inline int Mesh::attach_index_buffer<unsigned int>(const std::vector<unsigned int>& indices) {
-	if(index_type && index_type != GL_UNSIGNED_INT)
-		return -1;
-
-	index_type = GL_UNSIGNED_INT;
 	std::unique_ptr<Buffer> index = std::make_unique<Buffer>(GL_ELEMENT_ARRAY_BUFFER);
 	index->load<unsigned int>(indices, GL_STATIC_DRAW);
 	ibo.push_back(std::move(index));
+	ibo_ranges.push_back(nullptr);
+	ibo_types.push_back(GL_UNSIGNED_INT);
 	return ibo.size() - 1;
 }
 
 template <typename T>
 void Mesh::compute_bounding_box(const std::vector<T>& vertexdata, unsigned int pointer) {
-	glm::vec3 *pos = (glm::vec3 *)(&(vertexdata)[0] + pointer);
-	bounding_box[0] = *pos;
-	bounding_box[1] = *pos;
-	for(size_t i = 1; i < vertexdata.size(); i++) {
-		pos = (glm::vec3 *)(&(vertexdata)[i] + pointer);
-		if(pos->x < bounding_box[0].x)
-			bounding_box[0].x = pos->x;
-		if(pos->y < bounding_box[0].y)
-			bounding_box[0].y = pos->y;
-		if(pos->z < bounding_box[0].z)
-			bounding_box[0].z = pos->z;
-		if(pos->x > bounding_box[1].x)
-			bounding_box[1].x = pos->x;
-		if(pos->y > bounding_box[1].y)
-			bounding_box[1].y = pos->y;
-		if(pos->z > bounding_box[1].z)
-			bounding_box[1].z = pos->z;
-	}
+	bounding_box = Bounds::compute_aabb(vertexdata.data(), vertexdata.size(),
+					    sizeof(T), pointer);
+	bounding_sphere = Bounds::compute_sphere(vertexdata.data(),
+						 vertexdata.size(),
+						 sizeof(T), pointer);
 }
 }
 
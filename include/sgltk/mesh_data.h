@@ -0,0 +1,207 @@
+#ifndef __MESH_DATA_H__
+#define __MESH_DATA_H__
+
+#include "app.h"
+#include "bounds.h"
+#include "bvh.h"
+
+namespace sgltk {
+
+/**
+ * @struct Vertex_Stream
+ * @brief Describes how a vertex attribute is stored in a vertex buffer
+ */
+struct Vertex_Stream {
+	/**
+	 * @brief The name of the attribute in the shader
+	 */
+	std::string name;
+	/**
+	 * @brief The number of components of the attribute
+	 */
+	GLint number_elements;
+	/**
+	 * @brief The type of the components
+	 */
+	GLenum type;
+	/**
+	 * @brief True if integer components are normalized to [0, 1] or
+	 * 	[-1, 1] when they are read by the shader
+	 */
+	bool normalized;
+	/**
+	 * @brief The size of the attribute of one vertex in bytes
+	 */
+	unsigned int size;
+	/**
+	 * @brief The index of the vertex buffer containing the attribute
+	 */
+	unsigned int buffer_index;
+	/**
+	 * @brief The distance between the attributes of two consecutive
+	 * 	vertices in bytes
+	 */
+	unsigned int stride;
+	/**
+	 * @brief The offset of the attribute within a vertex in bytes
+	 */
+	unsigned int offset;
+};
+
+/**
+ * @class Mesh_Data
+ * @brief The vertex attributes, indices and bounds of a mesh in main memory
+ *
+ * Unlike a Mesh, the data does not depend on an OpenGL context. It can be
+ * built, optimized and serialized on any thread and then be uploaded into
+ * a mesh on the thread that owns the context. Errors of these functions
+ * are reported through the thread-safe App::push_error.
+ * @see Mesh::upload
+ */
+class Mesh_Data {
+public:
+	/**
+	 * @brief Level of detail
+	 */
+	struct Lod {
+		/**
+		 * @brief The indices of the level
+		 */
+		std::vector<unsigned int> indices;
+		/**
+		 * @brief The simplification error of the level
+		 */
+		float error;
+	};
+
+	/**
+	 * @brief The number of vertices
+	 */
+	unsigned int num_vertices;
+	/**
+	 * @brief The vertex attributes
+	 */
+	std::vector<Vertex_Stream> streams;
+	/**
+	 * @brief The contents of the vertex buffers
+	 */
+	std::vector<std::vector<unsigned char> > buffers;
+	/**
+	 * @brief The indices of the full resolution mesh
+	 */
+	std::vector<unsigned int> indices;
+	/**
+	 * @brief The levels of detail in order of decreasing resolution
+	 */
+	std::vector<Lod> lods;
+	/**
+	 * @brief The bounding box of the mesh
+	 */
+	AABB bounding_box;
+	/**
+	 * @brief The bounding sphere of the mesh
+	 */
+	Sphere bounding_sphere;
+	/**
+	 * @brief The matrix that decodes compressed positions
+	 * @see Mesh::position_decode
+	 */
+	glm::mat4 position_decode;
+	/**
+	 * @brief The number of texture coordinate sets
+	 */
+	unsigned int num_uv;
+	/**
+	 * @brief The number of vertex color sets
+	 */
+	unsigned int num_col;
+	/**
+	 * @brief The bounding volume hierarchy over the triangles or nullptr.
+	 * 	The hierarchy is shared with the mesh the data is uploaded to.
+	 */
+	std::shared_ptr<Triangle_BVH> bvh;
+
+	EXPORT Mesh_Data();
+
+	/**
+	 * @brief Adds a vertex attribute that is stored in its own vertex
+	 * 	buffer
+	 * @param name The name of the attribute in the shader
+	 * @param number_elements The number of components of the attribute
+	 * @param type The type of the components
+	 * @param normalized True to normalize integer components
+	 * @param size The size of the attribute of one vertex in bytes
+	 * @param data A pointer to the attribute of the first vertex. The
+	 * 	attributes of num_vertices vertices are copied.
+	 * @return The index of the stream
+	 */
+	EXPORT unsigned int add_stream(const std::string& name,
+				       GLint number_elements,
+				       GLenum type,
+				       bool normalized,
+				       unsigned int size,
+				       const void *data);
+	/**
+	 * @brief Removes a vertex attribute
+	 * @param name The name of the attribute
+	 * @return Returns true if the attribute was removed, false if it
+	 * 	does not exist
+	 * @note Vertex buffers that are not used by any attribute anymore
+	 * 	are removed as well.
+	 */
+	EXPORT bool remove_stream(const std::string& name);
+	/**
+	 * @brief Returns the stream with the given name or nullptr if it
+	 * 	does not exist
+	 * @param name The name of the attribute
+	 */
+	EXPORT const Vertex_Stream *get_stream(const std::string& name) const;
+	/**
+	 * @brief Stores all vertex attributes in a single vertex buffer
+	 * @note Every attribute is aligned to 4 bytes.
+	 */
+	EXPORT void interleave();
+	/**
+	 * @brief Computes the bounding box and the bounding sphere
+	 * @param positions A pointer to the position of the first vertex
+	 * @param stride The distance between the positions of two
+	 * 	consecutive vertices in bytes
+	 * @note Every position consists of three consecutive floats.
+	 */
+	EXPORT void compute_bounds(const glm::vec3 *positions,
+				   unsigned int stride = sizeof(glm::vec3));
+	/**
+	 * @brief Builds the bounding volume hierarchy over the triangles
+	 * @param positions A pointer to the position of the first vertex
+	 * @param stride The distance between the positions of two
+	 * 	consecutive vertices in bytes
+	 * @param num_threads The largest number of threads to use,
+	 * 	0 to use one thread per hardware thread
+	 * @return Returns true on success, false otherwise
+	 */
+	EXPORT bool build_bvh(const glm::vec3 *positions,
+			      unsigned int stride = sizeof(glm::vec3),
+			      unsigned int num_threads = 0);
+	/**
+	 * @brief Returns the size of all vertex buffers and indices in bytes
+	 */
+	EXPORT size_t get_size() const;
+	/**
+	 * @brief Writes the data to a binary stream
+	 * @param stream The stream to write to
+	 * @return Returns true on success, false otherwise
+	 * @note The bounding volume hierarchy is not written. The data is
+	 * 	stored in the byte order of the machine.
+	 */
+	EXPORT bool save(std::ostream& stream) const;
+	/**
+	 * @brief Reads data written by save
+	 * @param stream The stream to read from
+	 * @return Returns true on success, false otherwise
+	 */
+	EXPORT bool load(std::istream& stream);
+};
+
+}
+
+#endif //__MESH_DATA_H__
@@ -0,0 +1,278 @@
+#ifndef __MESH_OPTIMIZER_H__
+#define __MESH_OPTIMIZER_H__
+
+#include "app.h"
+
+namespace sgltk {
+
+/**
+ * @struct Vertex_Cache_Statistics
+ * @brief The efficiency of the post-transform vertex cache when drawing
+ * 	triangle lists
+ */
+struct Vertex_Cache_Statistics {
+	/**
+	 * @brief The number of triangles
+	 */
+	unsigned int num_triangles;
+	/**
+	 * @brief The number of distinct vertices referenced by the indices
+	 */
+	unsigned int num_vertices;
+	/**
+	 * @brief The number of vertices that had to be transformed because
+	 * 	they were not found in the cache
+	 */
+	unsigned int num_transformed;
+
+	Vertex_Cache_Statistics() {
+		num_triangles = 0;
+		num_vertices = 0;
+		num_transformed = 0;
+	}
+
+	/**
+	 * @brief Returns the average cache miss ratio, the number of
+	 * 	transformed vertices per triangle. The optimum is 0.5 for
+	 * 	large regular meshes, the worst case is 3.
+	 */
+	float get_acmr() const {
+		if(num_triangles == 0)
+			return 0;
+		return (float)num_transformed / num_triangles;
+	}
+
+	/**
+	 * @brief Returns the average transformed vertex ratio, the number
+	 * 	of transformed vertices per referenced vertex. The optimum
+	 * 	is 1.
+	 */
+	float get_atvr() const {
+		if(num_vertices == 0)
+			return 0;
+		return (float)num_transformed / num_vertices;
+	}
+
+	/**
+	 * @brief Adds the counts of other statistics to these statistics
+	 * @param other The statistics to add
+	 */
+	void add(const Vertex_Cache_Statistics& other) {
+		num_triangles += other.num_triangles;
+		num_vertices += other.num_vertices;
+		num_transformed += other.num_transformed;
+	}
+};
+
+/**
+ * @struct Vertex_Cache_Report
+ * @brief The vertex cache efficiency before and after an optimization
+ */
+struct Vertex_Cache_Report {
+	/**
+	 * @brief The statistics of the original indices
+	 */
+	Vertex_Cache_Statistics before;
+	/**
+	 * @brief The statistics of the optimized indices
+	 */
+	Vertex_Cache_Statistics after;
+};
+
+/**
+ * @struct Mesh_Cluster
+ * @brief A small group of neighboring triangles with the data needed to
+ * 	cull it
+ *
+ * The layout matches the following std430 structure:
+ * @code
+ * struct Mesh_Cluster {
+ * 	vec3 center;
+ * 	float radius;
+ * 	vec3 cone_axis;
+ * 	float cone_cutoff;
+ * 	vec3 cone_apex;
+ * 	uint first_index;
+ * 	uint num_indices;
+ * };
+ * @endcode
+ */
+struct Mesh_Cluster {
+	/**
+	 * @brief The center of the bounding sphere
+	 */
+	glm::vec3 center;
+	/**
+	 * @brief The radius of the bounding sphere
+	 */
+	float radius;
+	/**
+	 * @brief The mean direction of the normals of the triangles
+	 */
+	glm::vec3 cone_axis;
+	/**
+	 * @brief The sine of the angle between the axis and the normal
+	 * 	that deviates from it the most. A cutoff of 1 means that the
+	 * 	cluster can not be culled based on its normals.
+	 */
+	float cone_cutoff;
+	/**
+	 * @brief The apex of the normal cone. All triangles are facing away
+	 * 	from the camera at the position p if
+	 * 	dot(normalize(cone_apex - p), cone_axis) >= cone_cutoff.
+	 */
+	glm::vec3 cone_apex;
+	/**
+	 * @brief The index of the first index of the cluster
+	 */
+	unsigned int first_index;
+	/**
+	 * @brief The number of indices of the cluster
+	 */
+	unsigned int num_indices;
+	unsigned int padding[3];
+};
+
+/**
+ * @class Mesh_Optimizer
+ * @brief Reorders triangle lists for the post-transform vertex cache,
+ * 	reduced overdraw and linear vertex fetches
+ *
+ * The vertex cache optimization implements Tipsify by Sander, Nehab and
+ * Barczak. The overdraw pass sorts the clusters Tipsify produces so that
+ * clusters facing away from the center of the mesh are drawn first.
+ * The simplification collapses edges ordered by the quadric error metric
+ * of Garland and Heckbert.
+ * The functions do not use OpenGL and can be called from any thread,
+ * errors are reported through App::push_error.
+ */
+class Mesh_Optimizer {
+public:
+	/**
+	 * @brief Simulates a FIFO vertex cache to measure the efficiency of
+	 * 	a triangle list
+	 * @param indices The indices of the triangle list
+	 * @param num_vertices The number of vertices
+	 * @param cache_size The number of entries in the simulated cache
+	 * @return The statistics of the triangle list
+	 */
+	EXPORT static Vertex_Cache_Statistics analyze(const std::vector<unsigned int>& indices,
+						      unsigned int num_vertices,
+						      unsigned int cache_size = 16);
+	/**
+	 * @brief Reorders the triangles of a triangle list to reduce the
+	 * 	number of vertex cache misses
+	 * @param indices The indices of the triangle list
+	 * @param num_vertices The number of vertices
+	 * @param cache_size The number of entries in the vertex cache
+	 * @return The index of the first triangle of every cluster of
+	 * 	the new order. The clusters can be passed to
+	 * 	optimize_overdraw.
+	 */
+	EXPORT static std::vector<unsigned int> optimize_vertex_cache(std::vector<unsigned int>& indices,
+								       unsigned int num_vertices,
+								       unsigned int cache_size = 16);
+	/**
+	 * @brief Reorders the clusters of a triangle list so that the
+	 * 	triangles on the outside of the mesh are drawn first
+	 * @param indices The indices of the triangle list
+	 * @param clusters The index of the first triangle of every cluster
+	 * 	as returned by optimize_vertex_cache
+	 * @param positions A pointer to the position of the first vertex
+	 * @param stride The distance between the positions of two
+	 * 	consecutive vertices in bytes
+	 * @note The order of the triangles within the clusters and
+	 * 	therefore most of the vertex cache efficiency is retained.
+	 */
+	EXPORT static void optimize_overdraw(std::vector<unsigned int>& indices,
+					     const std::vector<unsigned int>& clusters,
+					     const glm::vec3 *positions,
+					     unsigned int stride);
+	/**
+	 * @brief Renumbers the vertices in the order they are first
+	 * 	referenced by the indices
+	 * @param indices The indices of the triangle list
+	 * @param num_vertices The number of vertices
+	 * @return A table that maps the old vertex indices to the new ones.
+	 * 	Vertices that are not referenced are moved to the end.
+	 * @see remap
+	 */
+	EXPORT static std::vector<unsigned int> optimize_vertex_fetch(std::vector<unsigned int>& indices,
+								       unsigned int num_vertices);
+	/**
+	 * @brief Reduces the number of triangles of a triangle list by
+	 * 	collapsing edges with the smallest quadric error
+	 * @param indices The indices of the triangle list
+	 * @param num_vertices The number of vertices
+	 * @param positions A pointer to the position of the first vertex
+	 * @param stride The distance between the positions of two
+	 * 	consecutive vertices in bytes
+	 * @param target_index_count The number of indices to reduce the
+	 * 	triangle list to
+	 * @param error Is set to the largest distance between the original
+	 * 	and the simplified surface as estimated by the quadrics.
+	 * 	Can be nullptr.
+	 * @return The indices of the simplified triangle list
+	 * @note The vertices are not moved, every collapse replaces a vertex
+	 * 	with one of its neighbors. The simplified triangle list
+	 * 	therefore references the original vertex data. Vertices on
+	 * 	borders and on attribute seams, i.e. positions shared by
+	 * 	several vertices, are never removed. The result can have
+	 * 	more indices than requested if no further edges can be
+	 * 	collapsed.
+	 */
+	EXPORT static std::vector<unsigned int> simplify(const std::vector<unsigned int>& indices,
+							  unsigned int num_vertices,
+							  const glm::vec3 *positions,
+							  unsigned int stride,
+							  unsigned int target_index_count,
+							  float *error = nullptr);
+	/**
+	 * @brief Splits a triangle list into clusters of neighboring
+	 * 	triangles and computes their bounding spheres and normal
+	 * 	cones
+	 * @param indices The indices of the triangle list. They are reordered
+	 * 	so that the triangles of each cluster are contiguous.
+	 * @param num_vertices The number of vertices
+	 * @param positions A pointer to the position of the first vertex
+	 * @param stride The distance between the positions of two
+	 * 	consecutive vertices in bytes
+	 * @param max_vertices The largest number of distinct vertices of a
+	 * 	cluster
+	 * @param max_triangles The largest number of triangles of a cluster
+	 * @return The clusters in the order of the indices
+	 * @note Clusters are grown from a seed triangle by adding the
+	 * 	adjacent triangle that references the fewest new vertices.
+	 */
+	EXPORT static std::vector<Mesh_Cluster> build_clusters(std::vector<unsigned int>& indices,
+								unsigned int num_vertices,
+								const glm::vec3 *positions,
+								unsigned int stride,
+								unsigned int max_vertices = 64,
+								unsigned int max_triangles = 124);
+	/**
+	 * @brief Reorders vertex data according to a remap table
+	 * @param data The vertex data
+	 * @param remap The table returned by optimize_vertex_fetch
+	 * @param elements_per_vertex The number of elements of the vector
+	 * 	that belong to a single vertex
+	 */
+	template <typename T>
+	static void remap(std::vector<T>& data,
+			  const std::vector<unsigned int>& remap,
+			  unsigned int elements_per_vertex = 1) {
+
+		std::vector<T> tmp(data.size());
+		for(unsigned int i = 0; i < remap.size(); i++) {
+			for(unsigned int j = 0; j < elements_per_vertex; j++) {
+				tmp[remap[i] * elements_per_vertex + j] =
+					data[i * elements_per_vertex + j];
+			}
+		}
+		data.swap(tmp);
+	}
+};
+
+}
+
+#endif //__MESH_OPTIMIZER_H__
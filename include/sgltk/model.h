@@ -3,6 +3,8 @@
 
 #include "app.h"
 #include "mesh.h"
+#include "draw_batch.h"
+#include "render_queue.h"
 #include "camera.h"
 #include "shader.h"
 #include "image.h"
@@ -16,6 +18,52 @@ namespace sgltk {
 	#define BONES_PER_VERTEX 4
 #endif
 
+/**
+ * @struct Vertex_Compression
+ * @brief Selects the compact encodings of the vertex attributes of a model
+ *
+ * Compressed attributes are read through normalized or half float
+ * attribute formats, so the shaders see the same value ranges as with
+ * uncompressed attributes.
+ */
+struct Vertex_Compression {
+	/**
+	 * @brief Stores positions as 16 bit normalized integers relative to
+	 * 	the bounding box of the mesh. The decoding is done through
+	 * 	Mesh::position_decode.
+	 */
+	bool position;
+	/**
+	 * @brief Stores normals and tangents as GL_INT_2_10_10_10_REV. The
+	 * 	w component of the tangent holds the sign of the bitangent.
+	 */
+	bool normal;
+	/**
+	 * @brief Stores texture coordinates as 16 bit half floats
+	 */
+	bool texture_coordinates;
+	/**
+	 * @brief Stores colors as normalized unsigned bytes
+	 */
+	bool color;
+	/**
+	 * @brief Stores bone weights as normalized unsigned bytes and bone
+	 * 	ids as unsigned shorts
+	 */
+	bool bones;
+
+	/**
+	 * @param enable The value of all fields
+	 */
+	Vertex_Compression(bool enable = false) {
+		position = enable;
+		normal = enable;
+		texture_coordinates = enable;
+		color = enable;
+		bones = enable;
+	}
+};
+
 
 /**
  * @class Model
@@ -27,11 +75,48 @@ class Model {
 	const aiScene *scene;
 	Shader *shader;
 
-	int model_matrix_buf;
-	int normal_matrix_buf;
+	Buffer_Heap *vertex_heap;
+	Buffer_Heap *index_heap;
+	std::vector<std::pair<Buffer_Heap *, Buffer_Range *> > heap_ranges;
+
+	bool interleaved;
+	Vertex_Compression compression;
+	bool optimize_meshes;
+	unsigned int vertex_cache_size;
+	Vertex_Cache_Report optimization_report;
+	unsigned int num_lods;
+	float lod_ratio;
+	float lod_threshold;
+	std::map<const Mesh *, std::vector<Vertex_Stream> > vertex_layouts;
+	//indices of the model and normal matrix buffers attached to each mesh
+	std::map<const Mesh *, std::pair<int, int> > instance_buffers;
+
+	struct Packed_Group {
+		std::unique_ptr<Mesh> mesh;
+		std::vector<unsigned int> meshes;
+		int model_matrix_buf = -1;
+		int normal_matrix_buf = -1;
+	};
+	bool packed;
+	std::vector<Mesh_Data> packed_data;
+	std::vector<Packed_Group> packed_groups;
+	std::vector<std::unique_ptr<Buffer_Range> > packed_ranges;
 
 	glm::mat4 *view_matrix;
 	glm::mat4 *projection_matrix;
+	const Frustum *camera_frustum;
+
+	bool frustum_culling;
+	unsigned int num_culled;
+	unsigned int num_visible;
+	std::vector<glm::mat4> cull_matrices;
+	std::vector<Sphere> cull_spheres;
+	std::vector<unsigned char> cull_visible;
+	std::vector<Sphere> instance_spheres;
+
+	bool generate_bvh;
+	BVH mesh_bvh;
+	std::vector<AABB> mesh_bounds;
 
 	std::string position_name;
 	std::string normal_name;
@@ -48,11 +133,18 @@ class Model {
 	glm::mat4 glob_inv_transf;
 
 	void set_vertex_attribute(std::unique_ptr<Mesh>& mesh);
+	void set_instance_attributes(Mesh& mesh, int model_matrix_buf,
+				     int normal_matrix_buf);
 	void traverse_scene_nodes(aiNode *start_node, aiMatrix4x4 *parent_trafo);
 	void traverse_animation_nodes(float time, aiNode *node, glm::mat4 parent_transformation);
 
+	void create_mesh_data(unsigned int index, Mesh_Data& data);
 	std::unique_ptr<Mesh> create_mesh(unsigned int index);
+	void pack_meshes();
+	void draw_packed(unsigned int num_instances);
 	void compute_bounding_box();
+	void cull_meshes();
+	void build_bvh();
 
 	static aiVector3D interpolate_scaling(float time, aiNodeAnim *node);
 	static aiVector3D interpolate_translation(float time, aiNodeAnim *node);
@@ -65,9 +157,15 @@ class Model {
 		 */
 		glm::mat4 model_matrix;
 		/**
-		 * @brief Two corners of the bounding box of the model
+		 * @brief The bounding box of the model that contains the
+		 * 	meshes transformed by their model matrices
+		 */
+		AABB bounding_box;
+		/**
+		 * @brief The bounding sphere of the model that contains the
+		 * 	meshes transformed by their model matrices
 		 */
-		std::vector<glm::vec3> bounding_box;
+		Sphere bounding_sphere;
 		/**
 		 * @brief The meshes that make up the model
 		 */
@@ -112,6 +210,199 @@ class Model {
 		 *	 current working directory.
 		 */
 		EXPORT bool load(const std::string& filename);
+		/**
+		 * @brief Makes the model load the vertex and index data of its
+		 * 	meshes into ranges of buffer heaps instead of creating
+		 * 	separate buffer objects for every mesh
+		 * @param vertex_heap The heap to store the vertex data in
+		 * @param index_heap The heap to store the indices in
+		 * @note This function needs to be called before the model is
+		 * 	loaded. The heaps have to outlive the model. Passing
+		 * 	nullptr restores the default behavior.
+		 */
+		EXPORT void set_buffer_heap(Buffer_Heap *vertex_heap,
+					    Buffer_Heap *index_heap);
+		/**
+		 * @brief Makes the model store all meshes that share a vertex
+		 * 	layout in one set of vertex buffers and one index buffer
+		 * 	with a single vertex array object
+		 * @param enable If true, the meshes are packed
+		 * @note This function needs to be called before the model is
+		 * 	loaded. Each mesh is drawn with glDrawElementsBaseVertex
+		 * 	and the draw functions bind the vertex array once per
+		 * 	vertex layout instead of once per mesh. The buffer heaps
+		 * 	are not used for packed meshes. Instanced draws of packed
+		 * 	meshes require OpenGL 4.2 or the ARB_base_instance
+		 * 	extension.
+		 */
+		EXPORT void set_mesh_packing(bool enable);
+		/**
+		 * @brief Makes the model store the vertex attributes of each
+		 * 	mesh interleaved in a single vertex buffer
+		 * @param interleaved If true, the vertex attributes are
+		 * 	interleaved, otherwise every attribute is stored in a
+		 * 	separate buffer
+		 * @note This function needs to be called before the model is
+		 * 	loaded. Only the attributes used by the shader set with
+		 * 	setup_shader are stored, the positions are always
+		 * 	stored. A shader that is set up after loading can only
+		 * 	use the attributes the model was loaded with.
+		 */
+		EXPORT void set_interleaved(bool interleaved);
+		/**
+		 * @brief Selects compact encodings for the vertex attributes
+		 * @param compression The attributes to compress
+		 * @note This function needs to be called before the model is
+		 * 	loaded. Positions are quantized relative to the
+		 * 	bounding box of each mesh, which makes the draw
+		 * 	functions fold the decoding into the model matrix.
+		 */
+		EXPORT void set_vertex_compression(const Vertex_Compression& compression);
+		/**
+		 * @brief Makes the model optimize the meshes it loads for the
+		 * 	post-transform vertex cache, reduced overdraw and
+		 * 	linear vertex fetches
+		 * @param optimize If true, the meshes are optimized
+		 * @param cache_size The number of entries in the vertex cache
+		 * @note This function needs to be called before the model is
+		 * 	loaded.
+		 * @see get_optimization_report
+		 */
+		EXPORT void set_mesh_optimization(bool optimize,
+						  unsigned int cache_size = 16);
+		/**
+		 * @brief Returns the vertex cache statistics of all meshes
+		 * 	optimized by the model before and after the optimization
+		 * @return The combined statistics of all optimized meshes
+		 */
+		EXPORT const Vertex_Cache_Report& get_optimization_report();
+		/**
+		 * @brief Makes the model generate levels of detail for the
+		 * 	meshes it loads
+		 * @param num_levels The number of levels to generate in
+		 * 	addition to the full resolution mesh
+		 * @param ratio The number of triangles of each level
+		 * 	relative to the previous level
+		 * @note This function needs to be called before the model is
+		 * 	loaded. The levels share the vertex buffers of the
+		 * 	mesh and are selected by the draw function.
+		 * @see set_lod_threshold
+		 */
+		EXPORT void set_lod_generation(unsigned int num_levels,
+					       float ratio = 0.5f);
+		/**
+		 * @brief Sets the largest simplification error the draw
+		 * 	function accepts when it selects the level of detail
+		 * 	of a mesh
+		 * @param threshold The error as a fraction of the viewport
+		 * 	height, e.g. 1.0 / 1080 for one pixel on a 1080p
+		 * 	screen. 0 always draws the full resolution meshes.
+		 * @see Mesh::select_lod
+		 */
+		EXPORT void set_lod_threshold(float threshold);
+		/**
+		 * @brief Enables or disables the frustum culling of the
+		 * 	draw functions. Culling is enabled by default.
+		 * @param enable True to skip meshes outside of the view
+		 * 	frustum, false to draw all meshes
+		 */
+		EXPORT void set_frustum_culling(bool enable);
+		/**
+		 * @brief Returns the number of meshes that were skipped by
+		 * 	the last call to draw or draw_instanced
+		 */
+		EXPORT unsigned int get_num_culled_meshes();
+		/**
+		 * @brief Returns the number of meshes that were drawn by the
+		 * 	last call to draw or draw_instanced
+		 */
+		EXPORT unsigned int get_num_visible_meshes();
+		/**
+		 * @brief Makes the model build a bounding volume hierarchy
+		 * 	over the triangles of every mesh it loads
+		 * @param enable True to keep a copy of the positions and
+		 * 	indices of the meshes for spatial queries
+		 * @note This function needs to be called before the model is
+		 * 	loaded. The hierarchy over the meshes is built either way,
+		 * 	but meshes without a hierarchy over their triangles are
+		 * 	ignored by the queries.
+		 * @see Mesh::build_bvh
+		 */
+		EXPORT void set_bvh_generation(bool enable);
+		/**
+		 * @brief Updates the hierarchy over the meshes after their model
+		 * 	matrices have changed
+		 * @note The hierarchies only cover the static pose of the model.
+		 * 	Animations move the bones but not the model matrices, so
+		 * 	skinned meshes are queried in their bind pose and animate
+		 * 	does not refit the hierarchy.
+		 */
+		EXPORT void refit_bvh();
+		/**
+		 * @brief Finds the closest intersection of a ray with the
+		 * 	triangles of the model
+		 * @param origin The origin of the ray
+		 * @param direction The direction of the ray
+		 * @param hit Is set to the closest intersection
+		 * @param max_distance The largest distance to search in units
+		 * 	of the length of the direction
+		 * @param model_matrix The model matrix to use in addition to
+		 * 	the model matrices of the meshes (nullptr to use the
+		 * 	model matrices of the meshes only)
+		 * @return Returns true if the ray hits a triangle, false
+		 * 	otherwise
+		 * @see P_Camera::calculate_ray
+		 */
+		EXPORT bool raycast(const glm::vec3& origin,
+				    const glm::vec3& direction,
+				    Ray_Hit& hit,
+				    float max_distance = std::numeric_limits<float>::max(),
+				    const glm::mat4 *model_matrix = nullptr);
+		/**
+		 * @brief Tests whether a line segment intersects any triangle of
+		 * 	the model
+		 * @param start The start of the segment
+		 * @param end The end of the segment
+		 * @return Returns true if the segment intersects a triangle,
+		 * 	false otherwise
+		 * @note All queries are made in the coordinate system of the
+		 * 	bounding_box member, i.e. with the meshes transformed by
+		 * 	their model matrices.
+		 */
+		EXPORT bool intersects_segment(const glm::vec3& start,
+					       const glm::vec3& end);
+		/**
+		 * @brief Finds all triangles of the model that overlap a sphere
+		 * @param sphere The sphere
+		 * @param triangles The triangles are appended to this list
+		 */
+		EXPORT void overlap_sphere(const Sphere& sphere,
+					   std::vector<Mesh_Triangle>& triangles);
+		/**
+		 * @brief Finds all triangles of the model that are not
+		 * 	completely outside of a frustum
+		 * @param matrix The matrix that transforms into clip space,
+		 * 	e.g. a view-projection matrix
+		 * @param triangles The triangles are appended to this list
+		 * @note Triangles near the edges of the frustum may be reported
+		 * 	even though they are outside of it.
+		 */
+		EXPORT void overlap_frustum(const glm::mat4& matrix,
+					    std::vector<Mesh_Triangle>& triangles);
+		/**
+		 * @brief Finds the point on the triangles of the model closest
+		 * 	to a point
+		 * @param point The point
+		 * @param max_distance The largest distance to search
+		 * @param closest Is set to the closest point on the triangles
+		 * @param triangle Is set to the closest triangle
+		 * @return Returns true if a triangle closer than max_distance
+		 * 	exists, false otherwise
+		 */
+		EXPORT bool nearest_point(const glm::vec3& point,
+					  float max_distance,
+					  glm::vec3& closest,
+					  Mesh_Triangle& triangle);
 		/**
 		 * @brief Specifies the shader to use to render the mesh
 		 * @param shader The shader to be used to render the mesh
@@ -236,13 +527,42 @@ class Model {
 		 * @brief Draws all associated meshes with the index buffer 0.
 		 * @param model_matrix The model matrix to use
 		 *	  (nullptr to use the model_matrix member)
+		 * @note Meshes whose bounding spheres are outside of the view
+		 * 	frustum are skipped unless frustum culling is disabled.
 		 */
 		EXPORT void draw(const glm::mat4 *model_matrix = nullptr);
 		/**
 		 * @brief Draws all associated meshes multiple times
 		 * @param num_instances The number of instances to be drawn
+		 * @note A mesh is skipped if the bounding spheres of all its
+		 * 	instances set by setup_instanced_matrix are outside of
+		 * 	the view frustum.
 		 */
 		EXPORT void draw_instanced(unsigned int num_instances);
+		/**
+		 * @brief Adds all meshes of the model to a batch
+		 * @param batch The batch to add the meshes to
+		 * @param model_matrix The model matrix to use
+		 *	  (nullptr to use the model_matrix member)
+		 * @return Returns the number of meshes that were added
+		 * @note Meshes that are not compatible with the batch, e.g.
+		 * 	because they use different textures, are skipped.
+		 * 	Use separate batches for them.
+		 */
+		EXPORT unsigned int add_to_batch(Draw_Batch& batch,
+						 const glm::mat4 *model_matrix = nullptr);
+		/**
+		 * @brief Adds all meshes of the model to a render queue
+		 * @param queue The queue to add the meshes to
+		 * @param model_matrix The model matrix to use
+		 *	  (nullptr to use the model_matrix member)
+		 * @param pass The pass of the draws
+		 * @note The level of detail of every mesh is selected like
+		 * 	in draw.
+		 */
+		EXPORT void add_to_queue(Render_Queue& queue,
+					 const glm::mat4 *model_matrix = nullptr,
+					 unsigned int pass = 0);
 	};
 
 #endif //assimp_FOUND
@@ -0,0 +1,106 @@
+#ifndef __RENDER_QUEUE_H__
+#define __RENDER_QUEUE_H__
+
+#include "app.h"
+#include "shader.h"
+#include "mesh.h"
+
+namespace sgltk {
+
+/**
+ * @class Render_Queue
+ * @brief Collects mesh draws and issues them sorted by their state
+ *
+ * Every draw is assigned a 64 bit key. The keys of opaque meshes are made
+ * up of the following fields from the most to the least significant bit:
+ * @code
+ * | pass (4) | 0 (1) | shader (11) | material (16) | vertex array (16) | depth (16) |
+ * @endcode
+ * Opaque meshes are therefore grouped by their state and drawn front to
+ * back within a group. Transparent meshes are drawn after the opaque
+ * meshes of the same pass and ordered back to front:
+ * @code
+ * | pass (4) | 1 (1) | inverted depth (16) | shader (11) | material (16) | vertex array (16) |
+ * @endcode
+ * The shader, the material and the vertex state are only set up when they
+ * change from one draw to the next. The ids are assigned in the order the
+ * shaders and materials are added after the last call to clear, the
+ * fields only hold their lower bits.
+ */
+class Render_Queue {
+	struct Queue_Item {
+		Mesh *mesh;
+		unsigned int index_buffer;
+		GLenum mode;
+		glm::mat4 model_matrix;
+		unsigned int material;
+	};
+	std::vector<Queue_Item> items;
+
+	struct Sort_Entry {
+		std::uint64_t key;
+		unsigned int item;
+	};
+	std::vector<Sort_Entry> entries;
+	std::vector<Sort_Entry> sort_buffer;
+	bool sorted;
+
+	std::unordered_map<const Shader *, unsigned int> shader_ids;
+	std::unordered_map<std::string, unsigned int> material_ids;
+	std::unordered_map<const Mesh *, unsigned int> mesh_materials;
+
+	unsigned int num_state_changes;
+
+	unsigned int get_shader_id(const Shader *shader);
+	unsigned int get_material_id(const Mesh& mesh);
+	static unsigned int get_depth(const Mesh& mesh,
+				      const glm::mat4& model_matrix);
+	void radix_sort();
+public:
+	EXPORT Render_Queue();
+	EXPORT ~Render_Queue();
+
+	/**
+	 * @brief Adds a draw to the queue
+	 * @param mesh The mesh to draw
+	 * @param model_matrix The model matrix to use
+	 * @param pass The pass of the draw. Passes are drawn in ascending
+	 * 	order. Must be smaller than 16.
+	 * @param index_buffer The index buffer of the mesh to draw
+	 * @param mode Specifies what kind of primitives to render
+	 * @note The depth used to sort the draw is the distance between the
+	 * 	center of the bounding sphere of the mesh and the camera of the
+	 * 	mesh. The mesh has to outlive the draws in the queue.
+	 */
+	EXPORT void add(Mesh& mesh, const glm::mat4& model_matrix,
+			unsigned int pass = 0,
+			unsigned int index_buffer = 0,
+			GLenum mode = GL_TRIANGLES);
+	/**
+	 * @brief Removes all draws from the queue
+	 * @note Call this function every frame before adding the draws of
+	 * 	the frame.
+	 */
+	EXPORT void clear();
+	/**
+	 * @brief Returns the number of draws in the queue
+	 */
+	EXPORT unsigned int get_num_draws();
+	/**
+	 * @brief Returns the number of shader, material and vertex state
+	 * 	changes of the last call to draw
+	 */
+	EXPORT unsigned int get_num_state_changes();
+	/**
+	 * @brief Sorts the draws and issues them
+	 * @note The queue is not cleared, so the same draws can be issued
+	 * 	again without sorting them again. Blending is not changed,
+	 * 	transparent meshes require blending to be enabled by the
+	 * 	application.
+	 */
+	EXPORT void draw();
+};
+
+}
+
+#endif //__RENDER_QUEUE_H__
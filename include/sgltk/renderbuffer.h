@@ -2,6 +2,8 @@
 #define __RENDERBUFFER_H__
 
 #include "app.h"
+#include "state.h"
+#include "gpu_memory.h"
 
 namespace sgltk {
 
@@ -11,6 +13,8 @@ namespace sgltk {
  */
 class Renderbuffer {
 	GLenum format;
+
+	void allocate_storage();
 	public:
 	/**
 	 * @brief The width of the buffer
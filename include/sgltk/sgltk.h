@@ -4,14 +4,23 @@
 #include "config.h"
 #include "app.h"
 #include "timer.h"
+#include "state.h"
+#include "gpu_memory.h"
 #include "buffer.h"
+#include "mesh_optimizer.h"
+#include "bounds.h"
+#include "bvh.h"
+#include "mesh_data.h"
 #include "camera.h"
 #include "image.h"
 #include "texture.h"
 #include "shader.h"
+#include "uniform_block.h"
 #include "renderbuffer.h"
 #include "framebuffer.h"
 #include "mesh.h"
+#include "draw_batch.h"
+#include "render_queue.h"
 #include "model.h"
 #include "particle.h"
 #include "gamepad.h"
@@ -2,6 +2,7 @@
 #define __SHADER_H__
 
 #include "app.h"
+#include "state.h"
 
 namespace sgltk {
 
@@ -12,14 +13,33 @@ namespace sgltk {
 class Shader {
 	EXPORT static int counter;
 
-	//The id of the currently bound shader object
-	EXPORT static int bound;
-
 	//The id of the shader object
 	int id;
 
 	bool modify;
 	bool linked;
+	unsigned int link_count;
+
+	std::unordered_map<std::string, int> uniform_locations;
+	void cache_uniform_locations();
+
+	//the last values uploaded to every uniform location
+	std::vector<std::vector<unsigned char> > uniform_values;
+	/**
+	 * @brief Compares the values of a uniform with the last uploaded
+	 * 	values and stores them if they differ
+	 * @param location The uniform location
+	 * @param value A pointer to the values
+	 * @param size The size of the values in bytes
+	 * @param count The number of array elements starting at location
+	 * @param transpose Specifies whether a matrix is transposed
+	 * @return Returns true if the values have to be uploaded, false if
+	 * 	they are unchanged or the location is invalid
+	 */
+	EXPORT bool update_uniform_value(int location, const void *value,
+					 unsigned int size,
+					 unsigned int count = 1,
+					 bool transpose = false);
 
 	std::vector<GLuint> attached;
 
@@ -102,8 +122,24 @@ public:
 	 * @brief Returns the location of a uniform variable
 	 * @param name The name of the uniform variable
 	 * @return Returns the location of the uniform variable or -1 if it is not found
+	 * @note The locations of all active uniforms are cached when the
+	 * 	shader is linked, so this function does not query OpenGL for
+	 * 	them.
 	 */
 	EXPORT int get_uniform_location(const std::string& name);
+	/**
+	 * @brief Returns the number of times the shader was successfully
+	 * 	linked. Uniform locations obtained from the shader are
+	 * 	invalid once this number changes.
+	 */
+	EXPORT unsigned int get_link_count();
+	/**
+	 * @brief Forgets the last uploaded uniform values so that the next
+	 * 	call to set_uniform uploads them regardless of their value
+	 * @note Uploads of unchanged values are skipped. Call this function
+	 * 	after setting uniforms of the program with raw OpenGL calls.
+	 */
+	EXPORT void invalidate_uniform_values();
 	/**
 	 * @brief Sets the uniform
 	 * @param location The uniform location
@@ -606,26 +642,62 @@ public:
 
 template <>
 inline void Shader::set_uniform<int>(int location, int v0) {
-	bind();
-	glUniform1i(location, v0);
+	if(!App::direct_state_access)
+		bind();
+
+	if(!update_uniform_value(location, &v0, sizeof(v0)))
+		return;
+
+	if(App::direct_state_access) {
+		glProgramUniform1i(program, location, v0);
+	} else {
+		glUniform1i(location, v0);
+	}
 }
 
 template <>
 inline void Shader::set_uniform<unsigned int>(int location, unsigned int v0) {
-	bind();
-	glUniform1ui(location, v0);
+	if(!App::direct_state_access)
+		bind();
+
+	if(!update_uniform_value(location, &v0, sizeof(v0)))
+		return;
+
+	if(App::direct_state_access) {
+		glProgramUniform1ui(program, location, v0);
+	} else {
+		glUniform1ui(location, v0);
+	}
 }
 
 template <>
 inline void Shader::set_uniform<float>(int location, float v0) {
-	bind();
-	glUniform1f(location, v0);
+	if(!App::direct_state_access)
+		bind();
+
+	if(!update_uniform_value(location, &v0, sizeof(v0)))
+		return;
+
+	if(App::direct_state_access) {
+		glProgramUniform1f(program, location, v0);
+	} else {
+		glUniform1f(location, v0);
+	}
 }
 
 template <>
 inline void Shader::set_uniform<double>(int location, double v0) {
-	bind();
-	glUniform1d(location, v0);
+	if(!App::direct_state_access)
+		bind();
+
+	if(!update_uniform_value(location, &v0, sizeof(v0)))
+		return;
+
+	if(App::direct_state_access) {
+		glProgramUniform1d(program, location, v0);
+	} else {
+		glUniform1d(location, v0);
+	}
 }
 
 template <>
@@ -654,26 +726,66 @@ inline void Shader::set_uniform<double>(const std::string& name, double v0) {
 
 template <>
 inline void Shader::set_uniform<int>(int location, int v0, int v1) {
-	bind();
-	glUniform2i(location, v0, v1);
+	if(!App::direct_state_access)
+		bind();
+
+	int value[] = {v0, v1};
+	if(!update_uniform_value(location, value, sizeof(value)))
+		return;
+
+	if(App::direct_state_access) {
+		glProgramUniform2i(program, location, v0, v1);
+	} else {
+		glUniform2i(location, v0, v1);
+	}
 }
 
 template <>
 inline void Shader::set_uniform<unsigned int>(int location, unsigned int v0, unsigned int v1) {
-	bind();
-	glUniform2ui(location, v0, v1);
+	if(!App::direct_state_access)
+		bind();
+
+	unsigned int value[] = {v0, v1};
+	if(!update_uniform_value(location, value, sizeof(value)))
+		return;
+
+	if(App::direct_state_access) {
+		glProgramUniform2ui(program, location, v0, v1);
+	} else {
+		glUniform2ui(location, v0, v1);
+	}
 }
 
 template <>
 inline void Shader::set_uniform<float>(int location, float v0, float v1) {
-	bind();
-	glUniform2f(location, v0, v1);
+	if(!App::direct_state_access)
+		bind();
+
+	float value[] = {v0, v1};
+	if(!update_uniform_value(location, value, sizeof(value)))
+		return;
+
+	if(App::direct_state_access) {
+		glProgramUniform2f(program, location, v0, v1);
+	} else {
+		glUniform2f(location, v0, v1);
+	}
 }
 
 template <>
 inline void Shader::set_uniform<double>(int location, double v0, double v1) {
-	bind();
-	glUniform2d(location, v0, v1);
+	if(!App::direct_state_access)
+		bind();
+
+	double value[] = {v0, v1};
+	if(!update_uniform_value(location, value, sizeof(value)))
+		return;
+
+	if(App::direct_state_access) {
+		glProgramUniform2d(program, location, v0, v1);
+	} else {
+		glUniform2d(location, v0, v1);
+	}
 }
 
 template <>
@@ -702,26 +814,66 @@ inline void Shader::set_uniform<double>(const std::string& name, double v0, doub
 
 template <>
 inline void Shader::set_uniform<int>(int location, int v0, int v1, int v2) {
-	bind();
-	glUniform3i(location, v0, v1, v2);
+	if(!App::direct_state_access)
+		bind();
+
+	int value[] = {v0, v1, v2};
+	if(!update_uniform_value(location, value, sizeof(value)))
+		return;
+
+	if(App::direct_state_access) {
+		glProgramUniform3i(program, location, v0, v1, v2);
+	} else {
+		glUniform3i(location, v0, v1, v2);
+	}
 }
 
 template <>
 inline void Shader::set_uniform<unsigned int>(int location, unsigned int v0, unsigned int v1, unsigned int v2) {
-	bind();
-	glUniform3ui(location, v0, v1, v2);
+	if(!App::direct_state_access)
+		bind();
+
+	unsigned int value[] = {v0, v1, v2};
+	if(!update_uniform_value(location, value, sizeof(value)))
+		return;
+
+	if(App::direct_state_access) {
+		glProgramUniform3ui(program, location, v0, v1, v2);
+	} else {
+		glUniform3ui(location, v0, v1, v2);
+	}
 }
 
 template <>
 inline void Shader::set_uniform<float>(int location, float v0, float v1, float v2) {
-	bind();
-	glUniform3f(location, v0, v1, v2);
+	if(!App::direct_state_access)
+		bind();
+
+	float value[] = {v0, v1, v2};
+	if(!update_uniform_value(location, value, sizeof(value)))
+		return;
+
+	if(App::direct_state_access) {
+		glProgramUniform3f(program, location, v0, v1, v2);
+	} else {
+		glUniform3f(location, v0, v1, v2);
+	}
 }
 
 template <>
 inline void Shader::set_uniform<double>(int location, double v0, double v1, double v2) {
-	bind();
-	glUniform3d(location, v0, v1, v2);
+	if(!App::direct_state_access)
+		bind();
+
+	double value[] = {v0, v1, v2};
+	if(!update_uniform_value(location, value, sizeof(value)))
+		return;
+
+	if(App::direct_state_access) {
+		glProgramUniform3d(program, location, v0, v1, v2);
+	} else {
+		glUniform3d(location, v0, v1, v2);
+	}
 }
 
 template <>
@@ -750,26 +902,66 @@ inline void Shader::set_uniform<double>(const std::string& name, double v0, doub
 
 template <>
 inline void Shader::set_uniform<int>(int location, int v0, int v1, int v2, int v3) {
-	bind();
-	glUniform4i(location, v0, v1, v2, v3);
+	if(!App::direct_state_access)
+		bind();
+
+	int value[] = {v0, v1, v2, v3};
+	if(!update_uniform_value(location, value, sizeof(value)))
+		return;
+
+	if(App::direct_state_access) {
+		glProgramUniform4i(program, location, v0, v1, v2, v3);
+	} else {
+		glUniform4i(location, v0, v1, v2, v3);
+	}
 }
 
 template <>
 inline void Shader::set_uniform<unsigned int>(int location, unsigned int v0, unsigned int v1, unsigned int v2, unsigned int v3) {
-	bind();
-	glUniform4ui(location, v0, v1, v2, v3);
+	if(!App::direct_state_access)
+		bind();
+
+	unsigned int value[] = {v0, v1, v2, v3};
+	if(!update_uniform_value(location, value, sizeof(value)))
+		return;
+
+	if(App::direct_state_access) {
+		glProgramUniform4ui(program, location, v0, v1, v2, v3);
+	} else {
+		glUniform4ui(location, v0, v1, v2, v3);
+	}
 }
 
 template <>
 inline void Shader::set_uniform<float>(int location, float v0, float v1, float v2, float v3) {
-	bind();
-	glUniform4f(location, v0, v1, v2, v3);
+	if(!App::direct_state_access)
+		bind();
+
+	float value[] = {v0, v1, v2, v3};
+	if(!update_uniform_value(location, value, sizeof(value)))
+		return;
+
+	if(App::direct_state_access) {
+		glProgramUniform4f(program, location, v0, v1, v2, v3);
+	} else {
+		glUniform4f(location, v0, v1, v2, v3);
+	}
 }
 
 template <>
 inline void Shader::set_uniform<double>(int location, double v0, double v1, double v2, double v3) {
-	bind();
-	glUniform4d(location, v0, v1, v2, v3);
+	if(!App::direct_state_access)
+		bind();
+
+	double value[] = {v0, v1, v2, v3};
+	if(!update_uniform_value(location, value, sizeof(value)))
+		return;
+
+	if(App::direct_state_access) {
+		glProgramUniform4d(program, location, v0, v1, v2, v3);
+	} else {
+		glUniform4d(location, v0, v1, v2, v3);
+	}
 }
 
 template <>
@@ -801,20 +993,38 @@ inline void Shader::set_uniform<int>(int location, unsigned int count, unsigned
 	if(location < 0)
 		return;
 
-	bind();
+	if(!App::direct_state_access)
+		bind();
+
+	if(elements >= 1 && elements <= 4 &&
+	   !update_uniform_value(location, value,
+				 count * elements * sizeof(int), count))
+		return;
 
 	switch(elements) {
 	case 1:
-		glUniform1iv(location, count, value);
+		if(App::direct_state_access)
+			glProgramUniform1iv(program, location, count, value);
+		else
+			glUniform1iv(location, count, value);
 		break;
 	case 2:
-		glUniform2iv(location, count, value);
+		if(App::direct_state_access)
+			glProgramUniform2iv(program, location, count, value);
+		else
+			glUniform2iv(location, count, value);
 		break;
 	case 3:
-		glUniform3iv(location, count, value);
+		if(App::direct_state_access)
+			glProgramUniform3iv(program, location, count, value);
+		else
+			glUniform3iv(location, count, value);
 		break;
 	case 4:
-		glUniform4iv(location, count, value);
+		if(App::direct_state_access)
+			glProgramUniform4iv(program, location, count, value);
+		else
+			glUniform4iv(location, count, value);
 		break;
 	default:
 		std::string error = "Wrong number of elements given to"
@@ -830,20 +1040,38 @@ inline void Shader::set_uniform<unsigned int>(int location, unsigned int count,
 	if(location < 0)
 		return;
 
-	bind();
+	if(!App::direct_state_access)
+		bind();
+
+	if(elements >= 1 && elements <= 4 &&
+	   !update_uniform_value(location, value,
+				 count * elements * sizeof(unsigned int), count))
+		return;
 
 	switch(elements) {
 	case 1:
-		glUniform1uiv(location, count, value);
+		if(App::direct_state_access)
+			glProgramUniform1uiv(program, location, count, value);
+		else
+			glUniform1uiv(location, count, value);
 		break;
 	case 2:
-		glUniform2uiv(location, count, value);
+		if(App::direct_state_access)
+			glProgramUniform2uiv(program, location, count, value);
+		else
+			glUniform2uiv(location, count, value);
 		break;
 	case 3:
-		glUniform3uiv(location, count, value);
+		if(App::direct_state_access)
+			glProgramUniform3uiv(program, location, count, value);
+		else
+			glUniform3uiv(location, count, value);
 		break;
 	case 4:
-		glUniform4uiv(location, count, value);
+		if(App::direct_state_access)
+			glProgramUniform4uiv(program, location, count, value);
+		else
+			glUniform4uiv(location, count, value);
 		break;
 	default:
 		std::string error = "Wrong number of elements given to"
@@ -859,20 +1087,38 @@ inline void Shader::set_uniform<float>(int location, unsigned int count, unsigne
 	if(location < 0)
 		return;
 
-	bind();
+	if(!App::direct_state_access)
+		bind();
+
+	if(elements >= 1 && elements <= 4 &&
+	   !update_uniform_value(location, value,
+				 count * elements * sizeof(float), count))
+		return;
 
 	switch(elements) {
 	case 1:
-		glUniform1fv(location, count, value);
+		if(App::direct_state_access)
+			glProgramUniform1fv(program, location, count, value);
+		else
+			glUniform1fv(location, count, value);
 		break;
 	case 2:
-		glUniform2fv(location, count, value);
+		if(App::direct_state_access)
+			glProgramUniform2fv(program, location, count, value);
+		else
+			glUniform2fv(location, count, value);
 		break;
 	case 3:
-		glUniform3fv(location, count, value);
+		if(App::direct_state_access)
+			glProgramUniform3fv(program, location, count, value);
+		else
+			glUniform3fv(location, count, value);
 		break;
 	case 4:
-		glUniform4fv(location, count, value);
+		if(App::direct_state_access)
+			glProgramUniform4fv(program, location, count, value);
+		else
+			glUniform4fv(location, count, value);
 		break;
 	default:
 		std::string error = "Wrong number of elements given to"
@@ -888,20 +1134,38 @@ inline void Shader::set_uniform<double>(int location, unsigned int count, unsign
 	if(location < 0)
 		return;
 
-	bind();
+	if(!App::direct_state_access)
+		bind();
+
+	if(elements >= 1 && elements <= 4 &&
+	   !update_uniform_value(location, value,
+				 count * elements * sizeof(double), count))
+		return;
 
 	switch(elements) {
 	case 1:
-		glUniform1dv(location, count, value);
+		if(App::direct_state_access)
+			glProgramUniform1dv(program, location, count, value);
+		else
+			glUniform1dv(location, count, value);
 		break;
 	case 2:
-		glUniform2dv(location, count, value);
+		if(App::direct_state_access)
+			glProgramUniform2dv(program, location, count, value);
+		else
+			glUniform2dv(location, count, value);
 		break;
 	case 3:
-		glUniform3dv(location, count, value);
+		if(App::direct_state_access)
+			glProgramUniform3dv(program, location, count, value);
+		else
+			glUniform3dv(location, count, value);
 		break;
 	case 4:
-		glUniform4dv(location, count, value);
+		if(App::direct_state_access)
+			glProgramUniform4dv(program, location, count, value);
+		else
+			glUniform4dv(location, count, value);
 		break;
 	default:
 		std::string error = "Wrong number of elements given to"
@@ -947,27 +1211,33 @@ inline void Shader::set_uniform<float>(int location, unsigned int count, unsigne
 	if(columns < 2 || rows < 2 || columns > 4 || rows > 4)
 		return;
 
-	bind();
+	if(!App::direct_state_access)
+		bind();
+
+	if(!update_uniform_value(location, value,
+				  count * columns * rows * sizeof(float),
+				  count, transpose))
+		return;
 
 	if(columns == rows) {
 		switch(rows) {
 		case 2:
-			glUniformMatrix2fv(location,
-				count,
-				transpose,
-				value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix2fv(program, location, count, transpose, value);
+			else
+				glUniformMatrix2fv(location, count, transpose, value);
 			break;
 		case 3:
-			glUniformMatrix3fv(location,
-				count,
-				transpose,
-				value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix3fv(program, location, count, transpose, value);
+			else
+				glUniformMatrix3fv(location, count, transpose, value);
 			break;
 		case 4:
-			glUniformMatrix4fv(location,
-				count,
-				transpose,
-				value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix4fv(program, location, count, transpose, value);
+			else
+				glUniformMatrix4fv(location, count, transpose, value);
 			break;
 		default:
 			std::string error = "Wrong number of elements given to"
@@ -978,17 +1248,35 @@ inline void Shader::set_uniform<float>(int location, unsigned int count, unsigne
 		}
 	} else {
 		if(columns == 2 && rows == 3) {
-			glUniformMatrix2x3fv(location, count, transpose, value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix2x3fv(program, location, count, transpose, value);
+			else
+				glUniformMatrix2x3fv(location, count, transpose, value);
 		} else if(columns == 3 && rows == 2) {
-			glUniformMatrix3x2fv(location, count, transpose, value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix3x2fv(program, location, count, transpose, value);
+			else
+				glUniformMatrix3x2fv(location, count, transpose, value);
 		} else if(columns == 2 && rows == 4) {
-			glUniformMatrix2x4fv(location, count, transpose, value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix2x4fv(program, location, count, transpose, value);
+			else
+				glUniformMatrix2x4fv(location, count, transpose, value);
 		} else if(columns == 4 && rows == 2) {
-			glUniformMatrix4x2fv(location, count, transpose, value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix4x2fv(program, location, count, transpose, value);
+			else
+				glUniformMatrix4x2fv(location, count, transpose, value);
 		} else if(columns == 3 && rows == 4) {
-			glUniformMatrix3x4fv(location, count, transpose, value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix3x4fv(program, location, count, transpose, value);
+			else
+				glUniformMatrix3x4fv(location, count, transpose, value);
 		} else if(columns == 4 && rows == 3) {
-			glUniformMatrix4x3fv(location, count, transpose, value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix4x3fv(program, location, count, transpose, value);
+			else
+				glUniformMatrix4x3fv(location, count, transpose, value);
 		} else {
 			std::string error = "Wrong number of elements given to"
 				"the set_uniform function";
@@ -1005,27 +1293,33 @@ inline void Shader::set_uniform<double>(int location, unsigned int count, unsign
 	if(columns < 2 || rows < 2 || columns > 4 || rows > 4)
 		return;
 
-	bind();
+	if(!App::direct_state_access)
+		bind();
+
+	if(!update_uniform_value(location, value,
+				  count * columns * rows * sizeof(double),
+				  count, transpose))
+		return;
 
 	if(columns == rows) {
 		switch(rows) {
 		case 2:
-			glUniformMatrix2dv(location,
-				count,
-				transpose,
-				value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix2dv(program, location, count, transpose, value);
+			else
+				glUniformMatrix2dv(location, count, transpose, value);
 			break;
 		case 3:
-			glUniformMatrix3dv(location,
-				count,
-				transpose,
-				value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix3dv(program, location, count, transpose, value);
+			else
+				glUniformMatrix3dv(location, count, transpose, value);
 			break;
 		case 4:
-			glUniformMatrix4dv(location,
-				count,
-				transpose,
-				value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix4dv(program, location, count, transpose, value);
+			else
+				glUniformMatrix4dv(location, count, transpose, value);
 			break;
 		default:
 			std::string error = "Wrong number of elements given to"
@@ -1037,17 +1331,35 @@ inline void Shader::set_uniform<double>(int location, unsigned int count, unsign
 		}
 	} else {
 		if(columns == 2 && rows == 3) {
-			glUniformMatrix2x3dv(location, count, transpose, value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix2x3dv(program, location, count, transpose, value);
+			else
+				glUniformMatrix2x3dv(location, count, transpose, value);
 		} else if(columns == 3 && rows == 2) {
-			glUniformMatrix3x2dv(location, count, transpose, value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix3x2dv(program, location, count, transpose, value);
+			else
+				glUniformMatrix3x2dv(location, count, transpose, value);
 		} else if(columns == 2 && rows == 4) {
-			glUniformMatrix2x4dv(location, count, transpose, value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix2x4dv(program, location, count, transpose, value);
+			else
+				glUniformMatrix2x4dv(location, count, transpose, value);
 		} else if(columns == 4 && rows == 2) {
-			glUniformMatrix4x2dv(location, count, transpose, value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix4x2dv(program, location, count, transpose, value);
+			else
+				glUniformMatrix4x2dv(location, count, transpose, value);
 		} else if(columns == 3 && rows == 4) {
-			glUniformMatrix3x4dv(location, count, transpose, value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix3x4dv(program, location, count, transpose, value);
+			else
+				glUniformMatrix3x4dv(location, count, transpose, value);
 		} else if(columns == 4 && rows == 3) {
-			glUniformMatrix4x3dv(location, count, transpose, value);
+			if(App::direct_state_access)
+				glProgramUniformMatrix4x3dv(program, location, count, transpose, value);
+			else
+				glUniformMatrix4x3dv(location, count, transpose, value);
 		} else {
 			std::string error = "Wrong number of elements given to"
 				"the set_uniform function";
@@ -0,0 +1,238 @@
+#ifndef __STATE_H__
+#define __STATE_H__
+
+#include "app.h"
+
+namespace sgltk {
+
+/**
+ * @class State_Cache
+ * @brief Tracks the binding state of an OpenGL context to skip redundant
+ * 	bind calls
+ *
+ * All wrapper classes route their bind and unbind operations through the
+ * current state cache. Bindings that are unknown to the cache are always
+ * issued, so raw OpenGL calls made by the application only require a
+ * call to invalidate to keep the cache in sync.
+ */
+class State_Cache {
+	struct Indexed_Binding {
+		GLuint buffer;
+		GLintptr offset;
+		GLsizeiptr size;
+	};
+
+	EXPORT static State_Cache default_cache;
+	EXPORT static State_Cache *current;
+
+	std::map<GLenum, GLuint> buffers;
+	std::map<GLuint, GLuint> element_buffers;
+	std::map<std::pair<GLenum, GLuint>, Indexed_Binding> indexed_buffers;
+	std::map<std::pair<GLuint, GLenum>, GLuint> textures;
+	GLuint active_unit;
+	GLuint vertex_array;
+	GLuint read_framebuffer;
+	GLuint draw_framebuffer;
+	GLuint renderbuffer;
+	GLuint program;
+
+	unsigned long long issued_calls;
+	unsigned long long skipped_calls;
+	unsigned long long skipped_uploads;
+	unsigned long long frame_skipped_uploads;
+
+	bool update(GLuint& cached, GLuint value);
+	void set_active_texture(GLuint unit);
+public:
+	/**
+	 * @brief If true, the wrapper classes unbind their objects after
+	 * 	internal operations like uploading data or setting
+	 * 	parameters. If false, the objects stay bound until another
+	 * 	object is bound to the same target. Defaults to true.
+	 * @note Explicit calls to the unbind functions of the wrapper
+	 * 	classes are not affected by this setting.
+	 */
+	bool unbind_after_use;
+
+	EXPORT State_Cache();
+	EXPORT ~State_Cache();
+
+	/**
+	 * @brief Returns the state cache of the current context
+	 * @return The current state cache
+	 */
+	EXPORT static State_Cache& get();
+	/**
+	 * @brief Makes this state cache the current state cache
+	 * @note Every OpenGL context needs its own state cache. Call this
+	 * 	function whenever the current context changes.
+	 */
+	EXPORT void make_current();
+	/**
+	 * @brief Marks all bindings as unknown
+	 * @note Call this function after changing bindings with raw OpenGL
+	 * 	calls.
+	 */
+	EXPORT void invalidate();
+	/**
+	 * @brief Binds a buffer to a target
+	 * @param target The target to bind the buffer to
+	 * @param buffer The name of the buffer object
+	 */
+	EXPORT void bind_buffer(GLenum target, GLuint buffer);
+	/**
+	 * @brief Binds a buffer to an indexed buffer target
+	 * @param target The target to bind the buffer to
+	 * @param index The index of the binding point
+	 * @param buffer The name of the buffer object
+	 */
+	EXPORT void bind_buffer_base(GLenum target, GLuint index, GLuint buffer);
+	/**
+	 * @brief Binds a range of a buffer to an indexed buffer target
+	 * @param target The target to bind the buffer to
+	 * @param index The index of the binding point
+	 * @param buffer The name of the buffer object
+	 * @param offset The starting offset in bytes into the buffer
+	 * @param size The size of the range in bytes
+	 */
+	EXPORT void bind_buffer_range(GLenum target, GLuint index, GLuint buffer,
+				      GLintptr offset, GLsizeiptr size);
+	/**
+	 * @brief Unbinds the buffer bound to a target if unbind_after_use
+	 * 	is true
+	 * @param target The target of the binding
+	 */
+	EXPORT void release_buffer(GLenum target);
+	/**
+	 * @brief Deletes a buffer object and removes it from all bindings
+	 * @param buffer The name of the buffer object
+	 */
+	EXPORT void delete_buffer(GLuint buffer);
+	/**
+	 * @brief Binds a texture to a texture unit
+	 * @param unit The index of the texture unit
+	 * @param target The target to bind the texture to
+	 * @param texture The name of the texture object
+	 */
+	EXPORT void bind_texture(GLuint unit, GLenum target, GLuint texture);
+	/**
+	 * @brief Binds a texture to a texture unit to be sampled by a shader
+	 * @param unit The index of the texture unit
+	 * @param target The target to bind the texture to
+	 * @param texture The name of the texture object
+	 * @note Unlike bind_texture this function does not change the active
+	 * 	texture unit if the texture is already bound to the unit.
+	 * 	Skipped binds are counted as skipped uploads.
+	 */
+	EXPORT void use_texture(GLuint unit, GLenum target, GLuint texture);
+	/**
+	 * @brief Unbinds the texture bound to a texture unit if
+	 * 	unbind_after_use is true
+	 * @param unit The index of the texture unit
+	 * @param target The target of the binding
+	 */
+	EXPORT void release_texture(GLuint unit, GLenum target);
+	/**
+	 * @brief Deletes a texture object and removes it from all bindings
+	 * @param texture The name of the texture object
+	 */
+	EXPORT void delete_texture(GLuint texture);
+	/**
+	 * @brief Binds a vertex array object
+	 * @param vertex_array The name of the vertex array object
+	 */
+	EXPORT void bind_vertex_array(GLuint vertex_array);
+	/**
+	 * @brief Unbinds the vertex array object if unbind_after_use is true
+	 */
+	EXPORT void release_vertex_array();
+	/**
+	 * @brief Deletes a vertex array object
+	 * @param vertex_array The name of the vertex array object
+	 */
+	EXPORT void delete_vertex_array(GLuint vertex_array);
+	/**
+	 * @brief Binds a framebuffer
+	 * @param target The target to bind the framebuffer to. Must be
+	 * 	GL_FRAMEBUFFER, GL_READ_FRAMEBUFFER or GL_DRAW_FRAMEBUFFER.
+	 * @param framebuffer The name of the framebuffer object
+	 */
+	EXPORT void bind_framebuffer(GLenum target, GLuint framebuffer);
+	/**
+	 * @brief Deletes a framebuffer object
+	 * @param framebuffer The name of the framebuffer object
+	 */
+	EXPORT void delete_framebuffer(GLuint framebuffer);
+	/**
+	 * @brief Binds a renderbuffer
+	 * @param renderbuffer The name of the renderbuffer object
+	 */
+	EXPORT void bind_renderbuffer(GLuint renderbuffer);
+	/**
+	 * @brief Unbinds the renderbuffer if unbind_after_use is true
+	 */
+	EXPORT void release_renderbuffer();
+	/**
+	 * @brief Deletes a renderbuffer object
+	 * @param renderbuffer The name of the renderbuffer object
+	 */
+	EXPORT void delete_renderbuffer(GLuint renderbuffer);
+	/**
+	 * @brief Makes a program object part of the current rendering state
+	 * @param program The name of the program object
+	 */
+	EXPORT void use_program(GLuint program);
+	/**
+	 * @brief Returns the name of the program object currently in use
+	 * @return The name of the program object or 0 if no program is in
+	 * 	use or the program is unknown
+	 */
+	EXPORT GLuint get_program();
+	/**
+	 * @brief Deletes a program object
+	 * @param program The name of the program object
+	 */
+	EXPORT void delete_program(GLuint program);
+	/**
+	 * @brief Returns the number of OpenGL bind calls that were issued
+	 * @return The number of issued calls
+	 */
+	EXPORT unsigned long long get_issued_calls();
+	/**
+	 * @brief Returns the number of OpenGL bind calls that were skipped
+	 * 	because the binding was already in place
+	 * @return The number of skipped calls
+	 */
+	EXPORT unsigned long long get_skipped_calls();
+	/**
+	 * @brief Counts a uniform upload or texture bind that was skipped
+	 * 	because the value was already in place
+	 */
+	EXPORT void count_skipped_upload();
+	/**
+	 * @brief Returns the number of uniform uploads and texture binds
+	 * 	that were skipped since the current frame started
+	 * @return The number of skipped uploads
+	 */
+	EXPORT unsigned long long get_skipped_uploads();
+	/**
+	 * @brief Returns the number of uniform uploads and texture binds
+	 * 	that were skipped during the last frame
+	 * @return The number of skipped uploads
+	 * @note Window::run calls end_frame after every frame.
+	 */
+	EXPORT unsigned long long get_frame_skipped_uploads();
+	/**
+	 * @brief Marks the end of a frame and restarts the skipped upload
+	 * 	counter
+	 */
+	EXPORT void end_frame();
+	/**
+	 * @brief Resets the issued and skipped call counters
+	 */
+	EXPORT void reset_counters();
+};
+
+}
+
+#endif //__STATE_H__
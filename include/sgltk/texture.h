@@ -2,6 +2,8 @@
 #define __TEXTURE_H__
 
 #include "app.h"
+#include "state.h"
+#include "gpu_memory.h"
 #include "image.h"
 
 namespace sgltk {
@@ -15,6 +17,20 @@ class Texture {
 	 * @brief Contains stored textures
 	 */
 	EXPORT static std::map<std::string, std::shared_ptr<Texture> > textures;
+protected:
+	/**
+	 * @brief Unbinds the texture from texture unit 0 after an internal
+	 * 	operation unless the state cache keeps bindings
+	 * @see State_Cache::unbind_after_use
+	 */
+	EXPORT void release();
+	/**
+	 * @brief Updates the size of the texture in the memory registry
+	 * 	based on its width, height and number of layers
+	 * @param internal_format The internal format of the texture
+	 * @param mipmaps True if the texture has a full mipmap chain
+	 */
+	EXPORT void track_memory(GLenum internal_format, bool mipmaps);
 public:
 	/**
 	 * @brief Adds a path to the list of paths to be searched
@@ -45,7 +61,10 @@ public:
 	 */
 	unsigned int num_layers;
 
-	EXPORT Texture();
+	/**
+	 * @param target The texture target
+	 */
+	EXPORT Texture(GLenum target);
 	EXPORT ~Texture();
 
 	/**
@@ -92,6 +111,14 @@ public:
 	 * @param texture_unit The texture unit to bind the texture to
 	 */
 	virtual void unbind(unsigned int texture_unit = 0) = 0;
+	/**
+	 * @brief Binds the texture to be sampled by a shader while drawing
+	 * @param texture_unit The texture unit to bind the texture to
+	 * @note The bind is skipped if the texture is already bound to the
+	 * 	texture unit.
+	 * @see State_Cache::use_texture
+	 */
+	EXPORT void use(unsigned int texture_unit = 0);
 	/**
 	 * @brief Binds a level of a texture to an image unit
 	 * @param unit The index of the image unit to which to bind the texture
@@ -0,0 +1,464 @@
+#ifndef __UNIFORM_BLOCK_H__
+#define __UNIFORM_BLOCK_H__
+
+#include "app.h"
+#include "buffer.h"
+#include "shader.h"
+
+#include <cstring>
+
+namespace sgltk {
+
+/**
+ * @brief The memory layout rules of a uniform or shader storage block
+ */
+enum class BLOCK_LAYOUT {
+	STD140,
+	STD430
+};
+
+/**
+ * @brief Rounds an offset up to the next multiple of an alignment
+ * @param offset The offset in bytes
+ * @param alignment The alignment in bytes
+ * @return The aligned offset
+ */
+constexpr unsigned int block_align(unsigned int offset, unsigned int alignment) {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * @brief Allows array types like glm::vec4[4] to be used as the type
+ * 	of a block field
+ */
+template <typename T>
+using Block_Member = T;
+
+/**
+ * @brief Describes how a type is stored in a block with the layout L
+ *
+ * Every specialization provides the base alignment, the size, the array
+ * and matrix strides and a function that writes a value to its place in
+ * the block. Supported are the scalar types float, double, int,
+ * unsigned int and bool, the glm vector and matrix types and arrays of
+ * these types.
+ */
+template <typename T, BLOCK_LAYOUT L>
+struct Block_Type;
+
+/**
+ * @brief The storage of scalars in blocks
+ */
+template <typename T>
+struct Block_Scalar {
+	static constexpr unsigned int get_alignment() {return sizeof(T);}
+	static constexpr unsigned int get_size() {return sizeof(T);}
+	static constexpr unsigned int get_array_stride() {return 0;}
+	static constexpr unsigned int get_matrix_stride() {return 0;}
+	static void pack(const T& value, unsigned char *destination) {
+		std::memcpy(destination, &value, sizeof(T));
+	}
+};
+
+/**
+ * @brief The storage of vectors in blocks
+ */
+template <typename V, typename C, unsigned int N>
+struct Block_Vector {
+	static constexpr unsigned int get_alignment() {
+		return (N == 2 ? 2 : 4) * sizeof(C);
+	}
+	static constexpr unsigned int get_size() {return N * sizeof(C);}
+	static constexpr unsigned int get_array_stride() {return 0;}
+	static constexpr unsigned int get_matrix_stride() {return 0;}
+	static void pack(const V& value, unsigned char *destination) {
+		std::memcpy(destination, &value[0], N * sizeof(C));
+	}
+};
+
+/**
+ * @brief The storage of column major matrices in blocks
+ *
+ * A matrix is stored like an array of its column vectors.
+ */
+template <typename M, typename V, unsigned int C, BLOCK_LAYOUT L>
+struct Block_Matrix {
+	static constexpr unsigned int get_alignment() {
+		return (L == BLOCK_LAYOUT::STD140) ?
+			block_align(Block_Type<V, L>::get_alignment(), 16) :
+			Block_Type<V, L>::get_alignment();
+	}
+	static constexpr unsigned int get_matrix_stride() {
+		return block_align(Block_Type<V, L>::get_size(), get_alignment());
+	}
+	static constexpr unsigned int get_size() {
+		return C * get_matrix_stride();
+	}
+	static constexpr unsigned int get_array_stride() {return 0;}
+	static void pack(const M& value, unsigned char *destination) {
+		for(unsigned int i = 0; i < C; i++) {
+			Block_Type<V, L>::pack(value[i], destination +
+					       i * get_matrix_stride());
+		}
+	}
+};
+
+template <BLOCK_LAYOUT L> struct Block_Type<float, L> : Block_Scalar<float> {};
+template <BLOCK_LAYOUT L> struct Block_Type<double, L> : Block_Scalar<double> {};
+template <BLOCK_LAYOUT L> struct Block_Type<int, L> : Block_Scalar<int> {};
+template <BLOCK_LAYOUT L> struct Block_Type<unsigned int, L> : Block_Scalar<unsigned int> {};
+
+template <BLOCK_LAYOUT L>
+struct Block_Type<bool, L> : Block_Scalar<GLuint> {
+	static void pack(const bool& value, unsigned char *destination) {
+		GLuint converted = value ? 1 : 0;
+		std::memcpy(destination, &converted, sizeof(GLuint));
+	}
+};
+
+template <BLOCK_LAYOUT L> struct Block_Type<glm::vec2, L> : Block_Vector<glm::vec2, float, 2> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::vec3, L> : Block_Vector<glm::vec3, float, 3> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::vec4, L> : Block_Vector<glm::vec4, float, 4> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::dvec2, L> : Block_Vector<glm::dvec2, double, 2> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::dvec3, L> : Block_Vector<glm::dvec3, double, 3> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::dvec4, L> : Block_Vector<glm::dvec4, double, 4> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::ivec2, L> : Block_Vector<glm::ivec2, int, 2> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::ivec3, L> : Block_Vector<glm::ivec3, int, 3> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::ivec4, L> : Block_Vector<glm::ivec4, int, 4> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::uvec2, L> : Block_Vector<glm::uvec2, unsigned int, 2> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::uvec3, L> : Block_Vector<glm::uvec3, unsigned int, 3> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::uvec4, L> : Block_Vector<glm::uvec4, unsigned int, 4> {};
+
+template <BLOCK_LAYOUT L> struct Block_Type<glm::mat2, L> : Block_Matrix<glm::mat2, glm::vec2, 2, L> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::mat3, L> : Block_Matrix<glm::mat3, glm::vec3, 3, L> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::mat4, L> : Block_Matrix<glm::mat4, glm::vec4, 4, L> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::mat2x3, L> : Block_Matrix<glm::mat2x3, glm::vec3, 2, L> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::mat2x4, L> : Block_Matrix<glm::mat2x4, glm::vec4, 2, L> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::mat3x2, L> : Block_Matrix<glm::mat3x2, glm::vec2, 3, L> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::mat3x4, L> : Block_Matrix<glm::mat3x4, glm::vec4, 3, L> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::mat4x2, L> : Block_Matrix<glm::mat4x2, glm::vec2, 4, L> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::mat4x3, L> : Block_Matrix<glm::mat4x3, glm::vec3, 4, L> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::dmat2, L> : Block_Matrix<glm::dmat2, glm::dvec2, 2, L> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::dmat3, L> : Block_Matrix<glm::dmat3, glm::dvec3, 3, L> {};
+template <BLOCK_LAYOUT L> struct Block_Type<glm::dmat4, L> : Block_Matrix<glm::dmat4, glm::dvec4, 4, L> {};
+
+/**
+ * @brief The storage of arrays in blocks
+ *
+ * In the std140 layout the alignment and the stride of the elements are
+ * rounded up to the alignment of a vec4.
+ */
+template <typename T, size_t N, BLOCK_LAYOUT L>
+struct Block_Type<T[N], L> {
+	static constexpr unsigned int get_alignment() {
+		return (L == BLOCK_LAYOUT::STD140) ?
+			block_align(Block_Type<T, L>::get_alignment(), 16) :
+			Block_Type<T, L>::get_alignment();
+	}
+	static constexpr unsigned int get_array_stride() {
+		return block_align(Block_Type<T, L>::get_size(), get_alignment());
+	}
+	static constexpr unsigned int get_size() {
+		return N * get_array_stride();
+	}
+	static constexpr unsigned int get_matrix_stride() {
+		return Block_Type<T, L>::get_matrix_stride();
+	}
+	static void pack(const T (&value)[N], unsigned char *destination) {
+		for(size_t i = 0; i < N; i++) {
+			Block_Type<T, L>::pack(value[i], destination +
+					       i * get_array_stride());
+		}
+	}
+};
+
+/**
+ * @brief Marks the end of the field list of a block layout
+ */
+template <BLOCK_LAYOUT L>
+struct Block_Type<void, L> {
+	static constexpr unsigned int get_alignment() {return 1;}
+	static constexpr unsigned int get_size() {return 0;}
+	static constexpr unsigned int get_array_stride() {return 0;}
+	static constexpr unsigned int get_matrix_stride() {return 0;}
+};
+
+/**
+ * @brief Computes the offsets and the size of a block at compile time
+ * @tparam L The layout rules of the block
+ * @tparam Types The types of the fields of the block in the order of
+ * 	their declaration followed by void
+ */
+template <BLOCK_LAYOUT L, typename... Types>
+struct Block_Layout {
+	/**
+	 * @brief Returns the layout rules of the block
+	 */
+	static constexpr BLOCK_LAYOUT get_layout() {
+		return L;
+	}
+
+	/**
+	 * @brief Returns the number of fields of the block
+	 */
+	static constexpr unsigned int get_num_fields() {
+		return sizeof...(Types) - 1;
+	}
+
+	/**
+	 * @brief Returns the offset of a field in bytes from the start of
+	 * 	the block
+	 * @param index The index of the field. If the index is equal to
+	 * 	the number of fields the end of the last field is returned.
+	 */
+	static constexpr unsigned int get_offset(unsigned int index) {
+		const unsigned int alignments[] = {Block_Type<Types, L>::get_alignment()...};
+		const unsigned int sizes[] = {Block_Type<Types, L>::get_size()...};
+		unsigned int offset = 0;
+		for(unsigned int i = 0; i < index; i++)
+			offset = block_align(offset, alignments[i]) + sizes[i];
+		return block_align(offset, alignments[index]);
+	}
+
+	/**
+	 * @brief Returns the array stride of a field or 0 if the field is
+	 * 	not an array
+	 * @param index The index of the field
+	 */
+	static constexpr unsigned int get_array_stride(unsigned int index) {
+		const unsigned int strides[] = {Block_Type<Types, L>::get_array_stride()...};
+		return strides[index];
+	}
+
+	/**
+	 * @brief Returns the matrix stride of a field or 0 if the field is
+	 * 	not a matrix or an array of matrices
+	 * @param index The index of the field
+	 */
+	static constexpr unsigned int get_matrix_stride(unsigned int index) {
+		const unsigned int strides[] = {Block_Type<Types, L>::get_matrix_stride()...};
+		return strides[index];
+	}
+
+	/**
+	 * @brief Returns the base alignment of the block
+	 */
+	static constexpr unsigned int get_alignment() {
+		const unsigned int alignments[] = {Block_Type<Types, L>::get_alignment()...};
+		unsigned int alignment = (L == BLOCK_LAYOUT::STD140) ? 16 : 1;
+		for(unsigned int i = 0; i < sizeof...(Types); i++) {
+			if(alignments[i] > alignment)
+				alignment = alignments[i];
+		}
+		return alignment;
+	}
+
+	/**
+	 * @brief Returns the size of the block in bytes including the
+	 * 	padding at the end
+	 */
+	static constexpr unsigned int get_size() {
+		return block_align(get_offset(get_num_fields()), get_alignment());
+	}
+
+	/**
+	 * @brief Writes the value of a field to its place in the block
+	 * @param value The value of the field
+	 * @param destination The start of the block
+	 */
+	template <unsigned int index, typename T>
+	static void pack(const T& value, unsigned char *destination) {
+		static_assert(index < sizeof...(Types) - 1, "Invalid field index");
+		Block_Type<T, L>::pack(value, destination + get_offset(index));
+	}
+};
+
+/**
+ * @struct Block_Field
+ * @brief Describes a field of a block
+ */
+struct Block_Field {
+	/**
+	 * @brief The name of the field in the shader
+	 */
+	std::string name;
+	/**
+	 * @brief The offset of the field in bytes
+	 */
+	unsigned int offset;
+	/**
+	 * @brief The array stride of the field or 0 if it is not an array
+	 */
+	unsigned int array_stride;
+	/**
+	 * @brief The matrix stride of the field or 0 if it is not a matrix
+	 */
+	unsigned int matrix_stride;
+};
+
+#define SGLTK_BLOCK_MEMBER(type, name) sgltk::Block_Member<type> name;
+#define SGLTK_BLOCK_TYPE(type, name) sgltk::Block_Member<type>,
+#define SGLTK_BLOCK_INDEX(type, name) name##_index,
+#define SGLTK_BLOCK_NAME(type, name) #name,
+#define SGLTK_BLOCK_PACK(type, name) layout_type::pack<name##_index>(name, destination);
+
+/**
+ * Declares a struct that can be stored in a Uniform_Block. The fields
+ * are described by a macro that takes another macro as its argument and
+ * invokes it as FIELD(type, name) for every field:
+ *
+ * @code
+ * #define CAMERA_FIELDS(FIELD) \
+ * 	FIELD(glm::mat4, view) \
+ * 	FIELD(glm::mat4, projection) \
+ * 	FIELD(glm::vec3, position) \
+ * 	FIELD(float, time) \
+ * 	FIELD(glm::vec4[4], lights)
+ * SGLTK_BLOCK(Camera, sgltk::BLOCK_LAYOUT::STD140, CAMERA_FIELDS);
+ * @endcode
+ *
+ * The resulting struct has a member for every field, the enumerators
+ * <name>_index and num_fields, the typedef layout_type with the
+ * compile time layout, the function get_field_name and the function
+ * pack that writes the fields to their places in the block.
+ * The names of the fields have to match the names of the block members
+ * in the shader. Types containing commas need a typedef.
+ */
+#define SGLTK_BLOCK(block, layout, FIELDS) \
+struct block { \
+	FIELDS(SGLTK_BLOCK_MEMBER) \
+	enum { FIELDS(SGLTK_BLOCK_INDEX) num_fields }; \
+	typedef sgltk::Block_Layout<layout, FIELDS(SGLTK_BLOCK_TYPE) void> layout_type; \
+	static const char *get_field_name(unsigned int index) { \
+		static const char *names[] = {FIELDS(SGLTK_BLOCK_NAME) nullptr}; \
+		return names[index]; \
+	} \
+	void pack(unsigned char *destination) const { \
+		FIELDS(SGLTK_BLOCK_PACK) \
+	} \
+}
+
+/**
+ * @class Block_Buffer
+ * @brief Manages the buffer of a uniform or shader storage block and
+ * 	uploads only the bytes that changed since the last upload
+ */
+class Block_Buffer {
+	std::vector<unsigned char> uploaded;
+	bool force_upload;
+
+	bool verify_uniform_block(GLuint program, const std::string& block_name);
+	bool verify_storage_block(GLuint program, const std::string& block_name);
+	bool compare_field(const std::string& block_name,
+			   const Block_Field& field,
+			   GLint offset, GLint array_stride,
+			   GLint matrix_stride);
+protected:
+	GLenum target;
+	std::vector<Block_Field> fields;
+	/**
+	 * @brief The packed contents of the block
+	 */
+	std::vector<unsigned char> staging;
+
+	/**
+	 * @param target The target of the buffer. Must be
+	 * 	GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER.
+	 * @param usage A hint as to how the buffer will be accessed
+	 * @param size The size of the block in bytes
+	 */
+	EXPORT Block_Buffer(GLenum target, GLenum usage, unsigned int size);
+public:
+	/**
+	 * @brief The buffer that holds the block
+	 */
+	Buffer buffer;
+
+	EXPORT virtual ~Block_Buffer();
+	Block_Buffer(const Block_Buffer&) = delete;
+	Block_Buffer& operator=(const Block_Buffer&) = delete;
+
+	/**
+	 * @brief Binds the buffer to an indexed binding point of its target
+	 * @param index The index of the binding point
+	 */
+	EXPORT void bind(unsigned int index);
+	/**
+	 * @brief Forces the next upload to transfer the whole block
+	 */
+	EXPORT void set_dirty();
+	/**
+	 * @brief Uploads the bytes of the staging data that differ from the
+	 * 	last upload as a single range
+	 * @return The number of bytes that were uploaded
+	 */
+	EXPORT unsigned int upload();
+	/**
+	 * @brief Compares the layout of the block with the layout the
+	 * 	linked shader reports for a block
+	 * @param shader The linked shader
+	 * @param block_name The name of the block in the shader
+	 * @return Returns true if the offsets and strides of all fields
+	 * 	match and the buffer is large enough, false otherwise
+	 * @note Mismatches are written to App::error_string. Call this
+	 * 	function once after linking the shader.
+	 */
+	EXPORT bool verify(Shader& shader, const std::string& block_name);
+};
+
+/**
+ * @class Uniform_Block
+ * @brief Stores a block declared with SGLTK_BLOCK in a uniform or shader
+ * 	storage buffer
+ *
+ * The fields are modified through the member data. On update the block
+ * is packed according to its layout and only the modified range of bytes
+ * is transferred to the buffer.
+ */
+template <typename T>
+class Uniform_Block : public Block_Buffer {
+public:
+	/**
+	 * @brief The CPU copy of the block
+	 */
+	T data;
+
+	/**
+	 * @param target The target of the buffer. Must be
+	 * 	GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER.
+	 * @param usage A hint as to how the buffer will be accessed
+	 */
+	Uniform_Block(GLenum target = GL_UNIFORM_BUFFER,
+		      GLenum usage = GL_DYNAMIC_DRAW) :
+		Block_Buffer(target, usage, T::layout_type::get_size()) {
+
+		for(unsigned int i = 0; i < T::layout_type::get_num_fields(); i++) {
+			Block_Field field;
+			field.name = T::get_field_name(i);
+			field.offset = T::layout_type::get_offset(i);
+			field.array_stride = T::layout_type::get_array_stride(i);
+			field.matrix_stride = T::layout_type::get_matrix_stride(i);
+			fields.push_back(field);
+		}
+	}
+
+	/**
+	 * @brief Returns the size of the block in bytes
+	 */
+	static constexpr unsigned int get_size() {
+		return T::layout_type::get_size();
+	}
+
+	/**
+	 * @brief Packs the block and uploads the modified bytes
+	 * @return The number of bytes that were uploaded
+	 */
+	unsigned int update() {
+		data.pack(staging.data());
+		return upload();
+	}
+};
+
+}
+
+#endif //__UNIFORM_BLOCK_H__
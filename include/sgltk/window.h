@@ -4,6 +4,7 @@
 #include "app.h"
 #include "image.h"
 #include "timer.h"
+#include "state.h"
 #include "gamepad.h"
 #include "joystick.h"
 
@@ -35,6 +36,7 @@ class Window {
 	bool running;
 	static unsigned int cnt;
 	SDL_GLContext context;
+	State_Cache state_cache;
 	const Uint8 *keys;
 	bool mouse_relative;
 	unsigned int fps_time;
@@ -4,8 +4,16 @@ using namespace sgltk;
 
 bool App::initialized = false;
 bool App::gl_version_manual = false;
+bool App::direct_state_access_enabled = true;
+bool App::direct_state_access = false;
 struct SYS_INFO App::sys_info;
 std::vector<std::string> App::error_string = {};
+std::mutex App::error_mutex;
+
+void App::push_error(const std::string& error) {
+	std::lock_guard<std::mutex> lock(error_mutex);
+	error_string.push_back(error);
+}
 
 bool App::init_glew() {
 	glewExperimental=GL_TRUE;
@@ -13,9 +21,19 @@ bool App::init_glew() {
 		App::error_string.push_back("glewInit failed");
 		return false;
 	}
+	sys_info.direct_state_access = GLEW_VERSION_4_5 ||
+		(GLEW_ARB_direct_state_access &&
+		(GLEW_VERSION_4_1 || GLEW_ARB_separate_shader_objects));
+	enable_direct_state_access(direct_state_access_enabled);
 	return true;
 }
 
+bool App::enable_direct_state_access(bool enable) {
+	direct_state_access_enabled = enable;
+	direct_state_access = enable && sys_info.direct_state_access;
+	return direct_state_access;
+}
+
 bool App::init_img() {
 	unsigned int flags = IMG_INIT_JPG | IMG_INIT_PNG | IMG_INIT_TIF;
 	if((IMG_Init(flags) & flags) != flags) {
@@ -0,0 +1,288 @@
+#include <sgltk/bounds.h>
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define SGLTK_BOUNDS_SSE
+	#define SGLTK_BOUNDS_AVX
+#elif defined(__SSE__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <xmmintrin.h>
+	#define SGLTK_BOUNDS_SSE
+#endif
+
+using namespace sgltk;
+
+static_assert(sizeof(Sphere) == 4 * sizeof(float),
+	      "The spheres have to be packed to be loaded with SSE");
+
+static inline const float *get_position(const unsigned char *data,
+					size_t vertex, size_t stride) {
+	return (const float *)(data + vertex * stride);
+}
+
+AABB Bounds::compute_aabb(const void *data, size_t num_vertices,
+			  size_t stride, size_t offset) {
+
+	AABB box = {glm::vec3(0), glm::vec3(0)};
+	if(!data || num_vertices == 0)
+		return box;
+
+	const unsigned char *start = (const unsigned char *)data + offset;
+	const float *p = get_position(start, 0, stride);
+	box.min = glm::vec3(p[0], p[1], p[2]);
+	box.max = box.min;
+
+	//the vector loads read four floats, so the last vertex is read with
+	//scalar code to stay within the position data
+	size_t num_simd = 0;
+#ifdef SGLTK_BOUNDS_SSE
+	if(stride >= 4)
+		num_simd = num_vertices - 1;
+
+	if(num_simd > 0) {
+		__m128 min = _mm_loadu_ps(p);
+		__m128 max = min;
+		size_t i = 1;
+#ifdef SGLTK_BOUNDS_AVX
+		__m256 min2 = _mm256_castps128_ps256(min);
+		min2 = _mm256_insertf128_ps(min2, min, 1);
+		__m256 max2 = min2;
+		for(; i + 1 < num_simd; i += 2) {
+			__m256 v = _mm256_castps128_ps256(
+				_mm_loadu_ps(get_position(start, i, stride)));
+			v = _mm256_insertf128_ps(v,
+				_mm_loadu_ps(get_position(start, i + 1, stride)), 1);
+			min2 = _mm256_min_ps(min2, v);
+			max2 = _mm256_max_ps(max2, v);
+		}
+		min = _mm_min_ps(_mm256_castps256_ps128(min2),
+				 _mm256_extractf128_ps(min2, 1));
+		max = _mm_max_ps(_mm256_castps256_ps128(max2),
+				 _mm256_extractf128_ps(max2, 1));
+#endif //SGLTK_BOUNDS_AVX
+		for(; i < num_simd; i++) {
+			__m128 v = _mm_loadu_ps(get_position(start, i, stride));
+			min = _mm_min_ps(min, v);
+			max = _mm_max_ps(max, v);
+		}
+
+		float result[4];
+		_mm_storeu_ps(result, min);
+		box.min = glm::vec3(result[0], result[1], result[2]);
+		_mm_storeu_ps(result, max);
+		box.max = glm::vec3(result[0], result[1], result[2]);
+	}
+#endif //SGLTK_BOUNDS_SSE
+
+	for(size_t i = std::max(num_simd, (size_t)1); i < num_vertices; i++) {
+		p = get_position(start, i, stride);
+		glm::vec3 pos(p[0], p[1], p[2]);
+		box.min = glm::min(box.min, pos);
+		box.max = glm::max(box.max, pos);
+	}
+	return box;
+}
+
+Sphere Bounds::compute_sphere(const void *data, size_t num_vertices,
+			      size_t stride, size_t offset) {
+
+	Sphere sphere = {glm::vec3(0), 0};
+	if(!data || num_vertices == 0)
+		return sphere;
+
+	const unsigned char *start = (const unsigned char *)data + offset;
+	auto position = [&](size_t vertex) {
+		const float *p = get_position(start, vertex, stride);
+		return glm::vec3(p[0], p[1], p[2]);
+	};
+
+	//start with the pair of extremal points along the coordinate axes
+	//that are the farthest apart
+	size_t min_vertex[3] = {0, 0, 0};
+	size_t max_vertex[3] = {0, 0, 0};
+	glm::vec3 min = position(0);
+	glm::vec3 max = min;
+	for(size_t i = 1; i < num_vertices; i++) {
+		glm::vec3 p = position(i);
+		for(unsigned int j = 0; j < 3; j++) {
+			if(p[j] < min[j]) {
+				min[j] = p[j];
+				min_vertex[j] = i;
+			}
+			if(p[j] > max[j]) {
+				max[j] = p[j];
+				max_vertex[j] = i;
+			}
+		}
+	}
+	glm::vec3 a = position(min_vertex[0]);
+	glm::vec3 b = position(max_vertex[0]);
+	for(unsigned int j = 1; j < 3; j++) {
+		glm::vec3 a_j = position(min_vertex[j]);
+		glm::vec3 b_j = position(max_vertex[j]);
+		if(glm::dot(b_j - a_j, b_j - a_j) > glm::dot(b - a, b - a)) {
+			a = a_j;
+			b = b_j;
+		}
+	}
+	sphere.center = 0.5f * (a + b);
+	sphere.radius = 0.5f * glm::length(b - a);
+
+	//grow the sphere to include the remaining points
+	float radius2 = sphere.radius * sphere.radius;
+	for(size_t i = 0; i < num_vertices; i++) {
+		glm::vec3 p = position(i);
+		glm::vec3 d = p - sphere.center;
+		float distance2 = glm::dot(d, d);
+		if(distance2 > radius2) {
+			float distance = std::sqrt(distance2);
+			float new_radius = 0.5f * (sphere.radius + distance);
+			sphere.center += d * ((new_radius - sphere.radius) / distance);
+			sphere.radius = new_radius;
+			radius2 = new_radius * new_radius;
+		}
+	}
+	return sphere;
+}
+
+AABB Bounds::transform(const AABB& box, const glm::mat4& matrix) {
+	//Arvo's method: every column of the matrix moves the corners along
+	//one axis, the extremes of the products are summed up
+	AABB ret;
+	ret.min = glm::vec3(matrix[3]);
+	ret.max = ret.min;
+	for(unsigned int i = 0; i < 3; i++) {
+		glm::vec3 column(matrix[i]);
+		glm::vec3 a = column * box.min[i];
+		glm::vec3 b = column * box.max[i];
+		ret.min += glm::min(a, b);
+		ret.max += glm::max(a, b);
+	}
+	return ret;
+}
+
+Sphere Bounds::transform(const Sphere& sphere, const glm::mat4& matrix) {
+	float scale = std::max(glm::length(glm::vec3(matrix[0])),
+			       std::max(glm::length(glm::vec3(matrix[1])),
+					glm::length(glm::vec3(matrix[2]))));
+	Sphere ret;
+	ret.center = glm::vec3(matrix * glm::vec4(sphere.center, 1));
+	ret.radius = sphere.radius * scale;
+	return ret;
+}
+
+AABB Bounds::merge(const AABB& a, const AABB& b) {
+	return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+Sphere Bounds::merge(const Sphere& a, const Sphere& b) {
+	glm::vec3 d = b.center - a.center;
+	float distance = glm::length(d);
+	if(distance + b.radius <= a.radius)
+		return a;
+	if(distance + a.radius <= b.radius)
+		return b;
+
+	Sphere ret;
+	ret.radius = 0.5f * (distance + a.radius + b.radius);
+	ret.center = a.center + d * ((ret.radius - a.radius) / distance);
+	return ret;
+}
+
+Frustum::Frustum() {
+	for(unsigned int i = 0; i < 6; i++) {
+		planes[i] = glm::vec4(0, 0, 0, 1);
+		plane_x[i] = 0;
+		plane_y[i] = 0;
+		plane_z[i] = 0;
+		plane_w[i] = 1;
+	}
+}
+
+Frustum::Frustum(const glm::mat4& matrix) {
+	update(matrix);
+}
+
+void Frustum::update(const glm::mat4& matrix) {
+	//Gribb and Hartmann: the planes are sums and differences of the
+	//rows of the matrix
+	glm::vec4 row[4];
+	for(unsigned int i = 0; i < 4; i++) {
+		row[i] = glm::vec4(matrix[0][i], matrix[1][i],
+				   matrix[2][i], matrix[3][i]);
+	}
+	for(unsigned int i = 0; i < 3; i++) {
+		planes[2 * i] = row[3] + row[i];
+		planes[2 * i + 1] = row[3] - row[i];
+	}
+	for(unsigned int i = 0; i < 6; i++) {
+		float length = glm::length(glm::vec3(planes[i]));
+		if(length > 0)
+			planes[i] /= length;
+		plane_x[i] = planes[i].x;
+		plane_y[i] = planes[i].y;
+		plane_z[i] = planes[i].z;
+		plane_w[i] = planes[i].w;
+	}
+}
+
+bool Frustum::intersects(const Sphere& sphere) const {
+	for(unsigned int i = 0; i < 6; i++) {
+		if(glm::dot(glm::vec3(planes[i]), sphere.center) +
+		   planes[i].w < -sphere.radius)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::intersects(const AABB& box) const {
+	glm::vec3 center = box.get_center();
+	glm::vec3 extent = box.get_extent();
+	for(unsigned int i = 0; i < 6; i++) {
+		glm::vec3 normal(planes[i]);
+		//the distance of the corner farthest along the normal
+		float radius = glm::dot(extent, glm::abs(normal));
+		if(glm::dot(normal, center) + planes[i].w < -radius)
+			return false;
+	}
+	return true;
+}
+
+size_t Frustum::intersects(const Sphere *spheres, size_t num_spheres,
+			   unsigned char *visible) const {
+
+	size_t num_visible = 0;
+	size_t i = 0;
+#ifdef SGLTK_BOUNDS_SSE
+	//a sphere is exactly four floats, four spheres are transposed into
+	//one register per component
+	for(; i + 4 <= num_spheres; i += 4) {
+		__m128 x = _mm_loadu_ps(&spheres[i].center.x);
+		__m128 y = _mm_loadu_ps(&spheres[i + 1].center.x);
+		__m128 z = _mm_loadu_ps(&spheres[i + 2].center.x);
+		__m128 r = _mm_loadu_ps(&spheres[i + 3].center.x);
+		_MM_TRANSPOSE4_PS(x, y, z, r);
+		__m128 neg_r = _mm_sub_ps(_mm_setzero_ps(), r);
+
+		__m128 outside = _mm_setzero_ps();
+		for(unsigned int j = 0; j < 6; j++) {
+			__m128 d = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane_x[j])),
+					   _mm_mul_ps(y, _mm_set1_ps(plane_y[j]))),
+				_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane_z[j])),
+					   _mm_set1_ps(plane_w[j])));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(d, neg_r));
+		}
+		int mask = _mm_movemask_ps(outside);
+		for(unsigned int j = 0; j < 4; j++) {
+			visible[i + j] = !(mask & (1 << j));
+			num_visible += visible[i + j];
+		}
+	}
+#endif //SGLTK_BOUNDS_SSE
+	for(; i < num_spheres; i++) {
+		visible[i] = intersects(spheres[i]);
+		num_visible += visible[i];
+	}
+	return num_visible;
+}
@@ -0,0 +1,219 @@
+#include <sgltk/buffer.h>
+
+using namespace sgltk;
+
+Buffer_Heap::Buffer_Heap(unsigned int page_size,
+			 GLenum target,
+			 GLenum usage,
+			 unsigned int alignment) {
+
+	this->target = target;
+	this->usage = usage;
+	this->alignment = alignment ? alignment : 1;
+	this->page_size = ((page_size + this->alignment - 1) /
+			   this->alignment) * this->alignment;
+}
+
+Buffer_Heap::~Buffer_Heap() {
+}
+
+Buffer_Heap::Page *Buffer_Heap::create_page(unsigned int size) {
+	std::unique_ptr<Page> page = std::make_unique<Page>();
+	page->size = size;
+	page->buffer = std::make_unique<Buffer>(target);
+	page->buffer->create_empty<char>(size, usage);
+	page->buffer->num_elements = size;
+	page->free_blocks[0] = size;
+	pages.push_back(std::move(page));
+	return pages.back().get();
+}
+
+Buffer_Range *Buffer_Heap::allocate_from_page(Page& page, unsigned int size) {
+	for(auto it = page.free_blocks.begin(); it != page.free_blocks.end(); it++) {
+		unsigned int block_offset = it->first;
+		unsigned int block_size = it->second;
+		if(block_size < size)
+			continue;
+
+		page.free_blocks.erase(it);
+		if(block_size > size)
+			page.free_blocks[block_offset + size] = block_size - size;
+
+		std::unique_ptr<Buffer_Range> range = std::make_unique<Buffer_Range>();
+		range->buffer = page.buffer.get();
+		range->offset = block_offset;
+		range->size = size;
+		page.ranges.push_back(std::move(range));
+		return page.ranges.back().get();
+	}
+	return nullptr;
+}
+
+Buffer_Range *Buffer_Heap::allocate(unsigned int size) {
+	if(size == 0)
+		return nullptr;
+
+	//every block starts and ends on the alignment boundary
+	unsigned int block_size = ((size + alignment - 1) / alignment) * alignment;
+
+	Buffer_Range *range = nullptr;
+	for(std::unique_ptr<Page>& page : pages) {
+		range = allocate_from_page(*page, block_size);
+		if(range)
+			break;
+	}
+
+	if(!range) {
+		Page *page = create_page(std::max(block_size, page_size));
+		range = allocate_from_page(*page, block_size);
+	}
+
+	if(range)
+		range->size = size;
+	return range;
+}
+
+bool Buffer_Heap::free(Buffer_Range *range) {
+	if(!range)
+		return false;
+
+	for(std::unique_ptr<Page>& page : pages) {
+		if(page->buffer.get() != range->buffer)
+			continue;
+
+		auto it = std::find_if(page->ranges.begin(), page->ranges.end(),
+			[range](const std::unique_ptr<Buffer_Range>& r) {
+				return r.get() == range;
+			});
+		if(it == page->ranges.end())
+			return false;
+
+		unsigned int offset = range->offset;
+		unsigned int size = ((range->size + alignment - 1) /
+				     alignment) * alignment;
+		page->ranges.erase(it);
+
+		//merge the block with its neighbors
+		auto next = page->free_blocks.lower_bound(offset);
+		if(next != page->free_blocks.end() &&
+				next->first == offset + size) {
+			size += next->second;
+			next = page->free_blocks.erase(next);
+		}
+		if(next != page->free_blocks.begin()) {
+			auto prev = std::prev(next);
+			if(prev->first + prev->second == offset) {
+				prev->second += size;
+				return true;
+			}
+		}
+		page->free_blocks[offset] = size;
+		return true;
+	}
+	return false;
+}
+
+bool Buffer_Heap::compact_page(Page& page) {
+	page.ranges.sort([](const std::unique_ptr<Buffer_Range>& a,
+			    const std::unique_ptr<Buffer_Range>& b) {
+		return a->offset < b->offset;
+	});
+
+	std::vector<unsigned int> new_offsets;
+	new_offsets.reserve(page.ranges.size());
+	unsigned int end = 0;
+	bool moved = false;
+	for(const auto& range : page.ranges) {
+		if(range->offset != end)
+			moved = true;
+		new_offsets.push_back(end);
+		end += ((range->size + alignment - 1) / alignment) * alignment;
+	}
+
+	if(!moved)
+		return false;
+
+	//the source and destination of a copy may not overlap,
+	//so the ranges are gathered in a temporary buffer first
+	GLuint tmp;
+	unsigned int i = 0;
+	if(App::direct_state_access) {
+		glCreateBuffers(1, &tmp);
+		glNamedBufferData(tmp, end, nullptr, GL_STREAM_COPY);
+		for(const auto& range : page.ranges) {
+			glCopyNamedBufferSubData(page.buffer->buffer, tmp,
+						 range->offset, new_offsets[i++],
+						 range->size);
+		}
+		glCopyNamedBufferSubData(tmp, page.buffer->buffer, 0, 0, end);
+	} else {
+		State_Cache& state = State_Cache::get();
+		glGenBuffers(1, &tmp);
+		state.bind_buffer(GL_COPY_WRITE_BUFFER, tmp);
+		glBufferData(GL_COPY_WRITE_BUFFER, end, nullptr, GL_STREAM_COPY);
+		state.bind_buffer(GL_COPY_READ_BUFFER, page.buffer->buffer);
+		for(const auto& range : page.ranges) {
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+					    range->offset, new_offsets[i++],
+					    range->size);
+		}
+		state.bind_buffer(GL_COPY_READ_BUFFER, tmp);
+		state.bind_buffer(GL_COPY_WRITE_BUFFER, page.buffer->buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+				    0, 0, end);
+		state.release_buffer(GL_COPY_READ_BUFFER);
+		state.release_buffer(GL_COPY_WRITE_BUFFER);
+	}
+	State_Cache::get().delete_buffer(tmp);
+
+	i = 0;
+	for(auto& range : page.ranges) {
+		range->offset = new_offsets[i++];
+	}
+
+	page.free_blocks.clear();
+	if(end < page.size)
+		page.free_blocks[end] = page.size - end;
+	return true;
+}
+
+bool Buffer_Heap::compact() {
+	bool moved = false;
+	for(std::unique_ptr<Page>& page : pages) {
+		if(compact_page(*page))
+			moved = true;
+	}
+	return moved;
+}
+
+unsigned int Buffer_Heap::get_num_pages() {
+	return pages.size();
+}
+
+unsigned int Buffer_Heap::get_capacity() {
+	unsigned int ret = 0;
+	for(const std::unique_ptr<Page>& page : pages) {
+		ret += page->size;
+	}
+	return ret;
+}
+
+unsigned int Buffer_Heap::get_free_size() {
+	unsigned int ret = 0;
+	for(const std::unique_ptr<Page>& page : pages) {
+		for(const auto& block : page->free_blocks) {
+			ret += block.second;
+		}
+	}
+	return ret;
+}
+
+unsigned int Buffer_Heap::get_largest_free_block() {
+	unsigned int ret = 0;
+	for(const std::unique_ptr<Page>& page : pages) {
+		for(const auto& block : page->free_blocks) {
+			ret = std::max(ret, block.second);
+		}
+	}
+	return ret;
+}
@@ -0,0 +1,129 @@
+#include <sgltk/buffer.h>
+
+using namespace sgltk;
+
+Buffer_Readback::Buffer_Readback() {
+	if(App::direct_state_access)
+		glCreateBuffers(1, &staging);
+	else
+		glGenBuffers(1, &staging);
+	capacity = 0;
+	size = 0;
+	fence = nullptr;
+	pending = false;
+}
+
+Buffer_Readback::~Buffer_Readback() {
+	if(fence)
+		glDeleteSync(fence);
+	Memory_Registry::untrack(this);
+	State_Cache::get().delete_buffer(staging);
+}
+
+bool Buffer_Readback::start(Buffer& source, unsigned int offset, unsigned int size) {
+	if(offset > source.size || size > source.size - offset) {
+		App::error_string.push_back("The requested readback range exceeds "
+					    "the size of the buffer");
+		return false;
+	}
+
+	if(fence) {
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	if(App::direct_state_access) {
+		if(size > capacity) {
+			glNamedBufferData(staging, size, nullptr, GL_STREAM_READ);
+			capacity = size;
+			Memory_Registry::track(this, RESOURCE_KIND::OTHER_BUFFER,
+					       GL_STREAM_READ, capacity);
+		}
+		glCopyNamedBufferSubData(source.buffer, staging, offset, 0, size);
+	} else {
+		State_Cache& state = State_Cache::get();
+		state.bind_buffer(GL_COPY_WRITE_BUFFER, staging);
+		if(size > capacity) {
+			glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr,
+				     GL_STREAM_READ);
+			capacity = size;
+			Memory_Registry::track(this, RESOURCE_KIND::OTHER_BUFFER,
+					       GL_STREAM_READ, capacity);
+		}
+		state.bind_buffer(GL_COPY_READ_BUFFER, source.buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+				    offset, 0, size);
+		state.release_buffer(GL_COPY_READ_BUFFER);
+		state.release_buffer(GL_COPY_WRITE_BUFFER);
+	}
+
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	//make sure the fence will be signaled without an explicit flush
+	glFlush();
+
+	this->size = size;
+	pending = true;
+	return true;
+}
+
+bool Buffer_Readback::is_pending() {
+	return pending;
+}
+
+bool Buffer_Readback::is_ready() {
+	if(!pending)
+		return false;
+	if(!fence)
+		return true;
+
+	GLint status = GL_UNSIGNALED;
+	glGetSynciv(fence, GL_SYNC_STATUS, 1, nullptr, &status);
+	if(status != GL_SIGNALED)
+		return false;
+
+	glDeleteSync(fence);
+	fence = nullptr;
+	return true;
+}
+
+bool Buffer_Readback::wait(GLuint64 timeout) {
+	if(!pending)
+		return false;
+	if(!fence)
+		return true;
+
+	GLenum ret = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+	if(ret == GL_TIMEOUT_EXPIRED)
+		return false;
+
+	glDeleteSync(fence);
+	fence = nullptr;
+	return ret != GL_WAIT_FAILED;
+}
+
+unsigned int Buffer_Readback::get_size() {
+	return size;
+}
+
+bool Buffer_Readback::read(void *storage) {
+	if(!pending || !storage)
+		return false;
+
+	while(fence && !wait(1000000)) {
+		//the wait failed
+		if(!fence)
+			return false;
+	}
+
+	if(App::direct_state_access) {
+		glGetNamedBufferSubData(staging, 0, size, storage);
+	} else {
+		State_Cache& state = State_Cache::get();
+		state.bind_buffer(GL_COPY_READ_BUFFER, staging);
+		glGetBufferSubData(GL_COPY_READ_BUFFER, 0, size, storage);
+		state.release_buffer(GL_COPY_READ_BUFFER);
+	}
+
+	pending = false;
+	return true;
+}
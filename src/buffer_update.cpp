@@ -0,0 +1,130 @@
+#include <sgltk/buffer.h>
+#include <sgltk/timer.h>
+
+using namespace sgltk;
+
+BUFFER_UPDATE Buffer::benchmark_update_modes(unsigned int size,
+					     unsigned int iterations,
+					     bool allow_unsynchronized,
+					     std::vector<double> *times) {
+
+	const BUFFER_UPDATE modes[] = {
+		BUFFER_UPDATE::SUB_DATA,
+		BUFFER_UPDATE::ORPHAN,
+		BUFFER_UPDATE::MAP_INVALIDATE,
+		BUFFER_UPDATE::MAP_UNSYNCHRONIZED
+	};
+	const unsigned int num_modes = sizeof(modes) / sizeof(modes[0]);
+
+	if(times)
+		times->assign(num_modes, 0);
+	if(size == 0 || iterations == 0)
+		return BUFFER_UPDATE::SUB_DATA;
+
+	std::vector<unsigned char> data(size, 0);
+	BUFFER_UPDATE fastest = BUFFER_UPDATE::SUB_DATA;
+	double fastest_time = std::numeric_limits<double>::max();
+	Timer timer;
+
+	for(unsigned int i = 0; i < num_modes; i++) {
+		Buffer source;
+		Buffer destination;
+		source.create_empty<unsigned char>(size, GL_STREAM_DRAW);
+		destination.create_empty<unsigned char>(size, GL_STREAM_COPY);
+		source.set_update_mode(modes[i]);
+
+		glFinish();
+		timer.start();
+		for(unsigned int j = 0; j < iterations; j++) {
+			data[j % size] = (unsigned char)j;
+			source.replace_data(data.data(), size);
+			//make the GPU read the buffer before the next update
+			destination.copy(source, 0, 0, size);
+		}
+		glFinish();
+		double time = timer.get_time_ms();
+
+		if(times)
+			(*times)[i] = time;
+		if(modes[i] == BUFFER_UPDATE::MAP_UNSYNCHRONIZED &&
+		   !allow_unsynchronized)
+			continue;
+		if(time < fastest_time) {
+			fastest_time = time;
+			fastest = modes[i];
+		}
+	}
+	return fastest;
+}
+
+Mapped_Range::Mapped_Range(Buffer& buffer, unsigned int offset,
+			   unsigned int size, GLbitfield access) {
+
+	this->buffer = &buffer;
+	this->offset = offset;
+	this->size = size;
+	pointer = buffer.map_range(offset, size, access);
+	if(!pointer)
+		App::error_string.push_back("Error mapping the buffer range");
+}
+
+Mapped_Range::Mapped_Range(Mapped_Range&& other) {
+	buffer = other.buffer;
+	pointer = other.pointer;
+	offset = other.offset;
+	size = other.size;
+	other.pointer = nullptr;
+}
+
+Mapped_Range& Mapped_Range::operator=(Mapped_Range&& other) {
+	if(this == &other)
+		return *this;
+
+	unmap();
+	buffer = other.buffer;
+	pointer = other.pointer;
+	offset = other.offset;
+	size = other.size;
+	other.pointer = nullptr;
+	return *this;
+}
+
+Mapped_Range::~Mapped_Range() {
+	unmap();
+}
+
+bool Mapped_Range::is_mapped() {
+	return pointer != nullptr;
+}
+
+void *Mapped_Range::get_pointer() {
+	return pointer;
+}
+
+unsigned int Mapped_Range::get_offset() {
+	return offset;
+}
+
+unsigned int Mapped_Range::get_size() {
+	return size;
+}
+
+bool Mapped_Range::flush(unsigned int offset, unsigned int size) {
+	if(!pointer || offset > this->size || size > this->size - offset)
+		return false;
+
+	buffer->flush_range(offset, size);
+	return true;
+}
+
+bool Mapped_Range::flush() {
+	return flush(0, size);
+}
+
+bool Mapped_Range::unmap() {
+	if(!pointer)
+		return false;
+
+	pointer = nullptr;
+	return buffer->unmap();
+}
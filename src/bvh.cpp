@@ -0,0 +1,667 @@
+#include <sgltk/bvh.h>
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define SGLTK_BVH_SSE
+	#define SGLTK_BVH_AVX
+#elif defined(__SSE__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <xmmintrin.h>
+	#define SGLTK_BVH_SSE
+#endif
+
+using namespace sgltk;
+
+//the number of bins the surface area heuristic evaluates per axis
+static const unsigned int num_bins = 16;
+//subtrees with fewer primitives are not worth a thread
+static const unsigned int parallel_threshold = 4096;
+//deeper nodes are split at the median to bound the traversal stack
+static const unsigned int max_sah_depth = 64;
+
+//the number of triangles that are intersected with a ray at once
+#ifdef SGLTK_BVH_AVX
+static const unsigned int packet_width = 8;
+#else
+static const unsigned int packet_width = 4;
+#endif
+//the first vertex and the two edges of packet_width triangles
+static const unsigned int packet_size = 9 * packet_width;
+
+struct Build_Context {
+	const std::vector<AABB>& bounds;
+	std::vector<glm::vec3> centroids;
+	std::vector<unsigned int>& primitives;
+	unsigned int max_leaf_size;
+};
+
+static float half_area(const AABB& box) {
+	glm::vec3 d = box.max - box.min;
+	return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+static const AABB empty_box = {
+	glm::vec3(std::numeric_limits<float>::max()),
+	glm::vec3(-std::numeric_limits<float>::max())
+};
+
+static void build_node(Build_Context& context,
+		       std::vector<BVH_Node>& nodes,
+		       unsigned int node_index,
+		       unsigned int begin,
+		       unsigned int end,
+		       unsigned int depth,
+		       unsigned int thread_depth) {
+
+	AABB box = empty_box;
+	AABB centroid_box = empty_box;
+	for(unsigned int i = begin; i < end; i++) {
+		unsigned int primitive = context.primitives[i];
+		box = Bounds::merge(box, context.bounds[primitive]);
+		const glm::vec3& c = context.centroids[primitive];
+		centroid_box = Bounds::merge(centroid_box, AABB{c, c});
+	}
+	nodes[node_index].bounds = box;
+	nodes[node_index].first = begin;
+	nodes[node_index].count = end - begin;
+
+	unsigned int count = end - begin;
+	if(count <= context.max_leaf_size)
+		return;
+
+	//binned surface area heuristic
+	float best_cost = std::numeric_limits<float>::max();
+	unsigned int best_axis = 0;
+	unsigned int best_split = 0;
+	glm::vec3 extent = centroid_box.max - centroid_box.min;
+	for(unsigned int axis = 0; axis < 3 && depth < max_sah_depth; axis++) {
+		if(extent[axis] <= 0)
+			continue;
+
+		AABB bin_bounds[num_bins];
+		unsigned int bin_counts[num_bins] = {0};
+		for(AABB& bin : bin_bounds)
+			bin = empty_box;
+		float scale = num_bins / extent[axis];
+		for(unsigned int i = begin; i < end; i++) {
+			unsigned int primitive = context.primitives[i];
+			unsigned int bin = std::min(num_bins - 1, (unsigned int)
+				((context.centroids[primitive][axis] -
+				  centroid_box.min[axis]) * scale));
+			bin_counts[bin]++;
+			bin_bounds[bin] = Bounds::merge(bin_bounds[bin],
+							context.bounds[primitive]);
+		}
+
+		//sweep from the right to get the cost of every right side
+		float right_area[num_bins];
+		unsigned int right_count[num_bins];
+		AABB right = empty_box;
+		unsigned int num_right = 0;
+		for(unsigned int i = num_bins - 1; i > 0; i--) {
+			right = Bounds::merge(right, bin_bounds[i]);
+			num_right += bin_counts[i];
+			right_area[i] = half_area(right);
+			right_count[i] = num_right;
+		}
+		AABB left = empty_box;
+		unsigned int num_left = 0;
+		for(unsigned int i = 1; i < num_bins; i++) {
+			left = Bounds::merge(left, bin_bounds[i - 1]);
+			num_left += bin_counts[i - 1];
+			if(num_left == 0 || right_count[i] == 0)
+				continue;
+			float cost = num_left * half_area(left) +
+				right_count[i] * right_area[i];
+			if(cost < best_cost) {
+				best_cost = cost;
+				best_axis = axis;
+				best_split = i;
+			}
+		}
+	}
+
+	unsigned int *first = &context.primitives[begin];
+	unsigned int *last = &context.primitives[0] + end;
+	unsigned int *middle;
+	if(best_cost < std::numeric_limits<float>::max()) {
+		//a leaf is cheaper than the split
+		float leaf_cost = count * half_area(box);
+		if(best_cost >= leaf_cost && count <= 4 * context.max_leaf_size)
+			return;
+
+		float scale = num_bins / extent[best_axis];
+		float min = centroid_box.min[best_axis];
+		middle = std::partition(first, last, [&](unsigned int primitive) {
+			unsigned int bin = std::min(num_bins - 1, (unsigned int)
+				((context.centroids[primitive][best_axis] - min) * scale));
+			return bin < best_split;
+		});
+	} else {
+		//all centroids are equal or the node is too deep, split at the
+		//median along the longest axis
+		unsigned int axis = 0;
+		if(extent.y > extent[axis])
+			axis = 1;
+		if(extent.z > extent[axis])
+			axis = 2;
+		middle = first + count / 2;
+		std::nth_element(first, middle, last,
+				 [&](unsigned int a, unsigned int b) {
+			return context.centroids[a][axis] <
+				context.centroids[b][axis];
+		});
+	}
+	unsigned int mid = begin + (unsigned int)(middle - first);
+
+	unsigned int left = nodes.size();
+	nodes[node_index].first = left;
+	nodes[node_index].count = 0;
+	nodes.resize(nodes.size() + 2);
+
+	if(thread_depth == 0 || count < parallel_threshold) {
+		build_node(context, nodes, left, begin, mid,
+			   depth + 1, 0);
+		build_node(context, nodes, left + 1, mid, end,
+			   depth + 1, 0);
+		return;
+	}
+
+	//the right subtree is built into its own node list on a new thread
+	//and appended afterwards
+	std::vector<BVH_Node> right_nodes(1);
+	std::thread thread(build_node, std::ref(context), std::ref(right_nodes),
+			   0, mid, end, depth + 1, thread_depth - 1);
+	build_node(context, nodes, left, begin, mid, depth + 1,
+		   thread_depth - 1);
+	thread.join();
+
+	unsigned int offset = nodes.size();
+	for(BVH_Node& node : right_nodes) {
+		if(node.count == 0)
+			node.first += offset - 1;
+	}
+	nodes[left + 1] = right_nodes[0];
+	nodes.insert(nodes.end(), right_nodes.begin() + 1, right_nodes.end());
+}
+
+void BVH::build(const std::vector<AABB>& bounds,
+		unsigned int max_leaf_size,
+		unsigned int num_threads) {
+
+	nodes.clear();
+	primitives.resize(bounds.size());
+	if(bounds.empty())
+		return;
+
+	for(unsigned int i = 0; i < primitives.size(); i++)
+		primitives[i] = i;
+
+	Build_Context context = {bounds, std::vector<glm::vec3>(bounds.size()),
+				 primitives, std::max(max_leaf_size, 1u)};
+	for(unsigned int i = 0; i < bounds.size(); i++)
+		context.centroids[i] = bounds[i].get_center();
+
+	if(num_threads == 0)
+		num_threads = std::thread::hardware_concurrency();
+	//every level of threads doubles the number of threads
+	unsigned int thread_depth = 0;
+	while((2u << thread_depth) <= num_threads)
+		thread_depth++;
+
+	nodes.reserve(2 * bounds.size() / context.max_leaf_size + 1);
+	nodes.resize(1);
+	build_node(context, nodes, 0, 0, bounds.size(), 0, thread_depth);
+}
+
+void BVH::refit(const std::vector<AABB>& bounds) {
+	//children are stored after their parents
+	for(size_t i = nodes.size(); i-- > 0;) {
+		BVH_Node& node = nodes[i];
+		if(node.count > 0) {
+			node.bounds = bounds[primitives[node.first]];
+			for(unsigned int j = 1; j < node.count; j++) {
+				node.bounds = Bounds::merge(node.bounds,
+					bounds[primitives[node.first + j]]);
+			}
+		} else {
+			node.bounds = Bounds::merge(nodes[node.first].bounds,
+						    nodes[node.first + 1].bounds);
+		}
+	}
+}
+
+bool BVH::intersect_ray(const AABB& box,
+			const glm::vec3& origin,
+			const glm::vec3& inverse_direction,
+			float max_distance,
+			float& distance) {
+
+	glm::vec3 t0 = (box.min - origin) * inverse_direction;
+	glm::vec3 t1 = (box.max - origin) * inverse_direction;
+	glm::vec3 t_min = glm::min(t0, t1);
+	glm::vec3 t_max = glm::max(t0, t1);
+	float t_enter = std::max(std::max(t_min.x, t_min.y),
+				 std::max(t_min.z, 0.0f));
+	float t_exit = std::min(std::min(t_max.x, t_max.y),
+				std::min(t_max.z, max_distance));
+	distance = t_enter;
+	return t_enter <= t_exit;
+}
+
+bool Triangle_BVH::build(const std::vector<unsigned int>& indices,
+			 const glm::vec3 *positions,
+			 unsigned int stride,
+			 unsigned int num_vertices,
+			 unsigned int num_threads) {
+
+	if(!positions || indices.size() % 3 != 0)
+		return false;
+	for(unsigned int index : indices) {
+		if(index >= num_vertices) {
+			App::push_error("The indices reference "
+					"more vertices than the "
+					"mesh contains");
+			return false;
+		}
+	}
+
+	this->positions.resize(num_vertices);
+	for(unsigned int i = 0; i < num_vertices; i++) {
+		this->positions[i] = *(const glm::vec3 *)((const char *)positions +
+							  i * stride);
+	}
+	this->indices = indices;
+
+	std::vector<AABB> bounds(indices.size() / 3);
+	for(unsigned int i = 0; i < bounds.size(); i++) {
+		const glm::vec3& a = this->positions[indices[3 * i]];
+		const glm::vec3& b = this->positions[indices[3 * i + 1]];
+		const glm::vec3& c = this->positions[indices[3 * i + 2]];
+		bounds[i].min = glm::min(a, glm::min(b, c));
+		bounds[i].max = glm::max(a, glm::max(b, c));
+	}
+	bvh.build(bounds, packet_width, num_threads);
+
+	//store the first vertex and the edges of the triangles of every leaf
+	//in packets of packet_width lanes, unused lanes are degenerate
+	//triangles that are never hit
+	packets.clear();
+	node_packets.assign(bvh.nodes.size(), 0);
+	for(unsigned int i = 0; i < bvh.nodes.size(); i++) {
+		const BVH_Node& node = bvh.nodes[i];
+		if(node.count == 0)
+			continue;
+
+		node_packets[i] = packets.size() / packet_size;
+		unsigned int num_packets = (node.count + packet_width - 1) /
+			packet_width;
+		size_t start = packets.size();
+		packets.resize(start + num_packets * packet_size, 0);
+		for(unsigned int j = 0; j < node.count; j++) {
+			unsigned int triangle = bvh.primitives[node.first + j];
+			const glm::vec3& a = this->positions[indices[3 * triangle]];
+			const glm::vec3& b = this->positions[indices[3 * triangle + 1]];
+			const glm::vec3& c = this->positions[indices[3 * triangle + 2]];
+			glm::vec3 values[3] = {a, b - a, c - a};
+			float *packet = &packets[start + (j / packet_width) * packet_size];
+			for(unsigned int k = 0; k < 9; k++) {
+				packet[k * packet_width + j % packet_width] =
+					values[k / 3][k % 3];
+			}
+		}
+	}
+	return true;
+}
+
+unsigned int Triangle_BVH::get_num_triangles() const {
+	return indices.size() / 3;
+}
+
+AABB Triangle_BVH::get_bounds() const {
+	if(bvh.empty())
+		return {glm::vec3(0), glm::vec3(0)};
+	return bvh.nodes[0].bounds;
+}
+
+//Moeller and Trumbore, the packet holds the first vertices and the two edges
+//of the triangles as nine arrays of packet_width floats. The distances and
+//barycentrics of all lanes are written to t, u and v and the lanes that are
+//hit closer than max_distance are returned as a bit mask.
+static unsigned int intersect_packet(const float *packet,
+				     const glm::vec3& origin,
+				     const glm::vec3& direction,
+				     float max_distance,
+				     float *t, float *u, float *v) {
+
+#if defined(SGLTK_BVH_AVX)
+	__m256 a[9];
+	for(unsigned int i = 0; i < 9; i++)
+		a[i] = _mm256_loadu_ps(packet + i * packet_width);
+	__m256 dx = _mm256_set1_ps(direction.x);
+	__m256 dy = _mm256_set1_ps(direction.y);
+	__m256 dz = _mm256_set1_ps(direction.z);
+
+	//p = cross(direction, e2)
+	__m256 px = _mm256_sub_ps(_mm256_mul_ps(dy, a[8]), _mm256_mul_ps(dz, a[7]));
+	__m256 py = _mm256_sub_ps(_mm256_mul_ps(dz, a[6]), _mm256_mul_ps(dx, a[8]));
+	__m256 pz = _mm256_sub_ps(_mm256_mul_ps(dx, a[7]), _mm256_mul_ps(dy, a[6]));
+	__m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[3], px),
+						 _mm256_mul_ps(a[4], py)),
+				   _mm256_mul_ps(a[5], pz));
+	__m256 inverse_det = _mm256_div_ps(_mm256_set1_ps(1), det);
+
+	//s = origin - v0
+	__m256 sx = _mm256_sub_ps(_mm256_set1_ps(origin.x), a[0]);
+	__m256 sy = _mm256_sub_ps(_mm256_set1_ps(origin.y), a[1]);
+	__m256 sz = _mm256_sub_ps(_mm256_set1_ps(origin.z), a[2]);
+	__m256 lane_u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(
+		_mm256_mul_ps(sx, px), _mm256_mul_ps(sy, py)),
+		_mm256_mul_ps(sz, pz)), inverse_det);
+
+	//q = cross(s, e1)
+	__m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, a[5]), _mm256_mul_ps(sz, a[4]));
+	__m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, a[3]), _mm256_mul_ps(sx, a[5]));
+	__m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, a[4]), _mm256_mul_ps(sy, a[3]));
+	__m256 lane_v = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(
+		_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)),
+		_mm256_mul_ps(dz, qz)), inverse_det);
+	__m256 lane_t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(
+		_mm256_mul_ps(a[6], qx), _mm256_mul_ps(a[7], qy)),
+		_mm256_mul_ps(a[8], qz)), inverse_det);
+
+	__m256 zero = _mm256_setzero_ps();
+	__m256 mask = _mm256_cmp_ps(det, zero, _CMP_NEQ_OQ);
+	mask = _mm256_and_ps(mask, _mm256_cmp_ps(lane_u, zero, _CMP_GE_OQ));
+	mask = _mm256_and_ps(mask, _mm256_cmp_ps(lane_v, zero, _CMP_GE_OQ));
+	mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(lane_u, lane_v),
+						 _mm256_set1_ps(1), _CMP_LE_OQ));
+	mask = _mm256_and_ps(mask, _mm256_cmp_ps(lane_t, zero, _CMP_GE_OQ));
+	mask = _mm256_and_ps(mask, _mm256_cmp_ps(lane_t,
+						 _mm256_set1_ps(max_distance),
+						 _CMP_LE_OQ));
+	_mm256_storeu_ps(t, lane_t);
+	_mm256_storeu_ps(u, lane_u);
+	_mm256_storeu_ps(v, lane_v);
+	return _mm256_movemask_ps(mask);
+#elif defined(SGLTK_BVH_SSE)
+	__m128 a[9];
+	for(unsigned int i = 0; i < 9; i++)
+		a[i] = _mm_loadu_ps(packet + i * packet_width);
+	__m128 dx = _mm_set1_ps(direction.x);
+	__m128 dy = _mm_set1_ps(direction.y);
+	__m128 dz = _mm_set1_ps(direction.z);
+
+	//p = cross(direction, e2)
+	__m128 px = _mm_sub_ps(_mm_mul_ps(dy, a[8]), _mm_mul_ps(dz, a[7]));
+	__m128 py = _mm_sub_ps(_mm_mul_ps(dz, a[6]), _mm_mul_ps(dx, a[8]));
+	__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, a[7]), _mm_mul_ps(dy, a[6]));
+	__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[3], px),
+					   _mm_mul_ps(a[4], py)),
+				_mm_mul_ps(a[5], pz));
+	__m128 inverse_det = _mm_div_ps(_mm_set1_ps(1), det);
+
+	//s = origin - v0
+	__m128 sx = _mm_sub_ps(_mm_set1_ps(origin.x), a[0]);
+	__m128 sy = _mm_sub_ps(_mm_set1_ps(origin.y), a[1]);
+	__m128 sz = _mm_sub_ps(_mm_set1_ps(origin.z), a[2]);
+	__m128 lane_u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px),
+							 _mm_mul_ps(sy, py)),
+					      _mm_mul_ps(sz, pz)), inverse_det);
+
+	//q = cross(s, e1)
+	__m128 qx = _mm_sub_ps(_mm_mul_ps(sy, a[5]), _mm_mul_ps(sz, a[4]));
+	__m128 qy = _mm_sub_ps(_mm_mul_ps(sz, a[3]), _mm_mul_ps(sx, a[5]));
+	__m128 qz = _mm_sub_ps(_mm_mul_ps(sx, a[4]), _mm_mul_ps(sy, a[3]));
+	__m128 lane_v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx),
+							 _mm_mul_ps(dy, qy)),
+					      _mm_mul_ps(dz, qz)), inverse_det);
+	__m128 lane_t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a[6], qx),
+							 _mm_mul_ps(a[7], qy)),
+					      _mm_mul_ps(a[8], qz)), inverse_det);
+
+	__m128 zero = _mm_setzero_ps();
+	__m128 mask = _mm_cmpneq_ps(det, zero);
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(lane_u, zero));
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(lane_v, zero));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(lane_u, lane_v),
+					     _mm_set1_ps(1)));
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(lane_t, zero));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(lane_t, _mm_set1_ps(max_distance)));
+	_mm_storeu_ps(t, lane_t);
+	_mm_storeu_ps(u, lane_u);
+	_mm_storeu_ps(v, lane_v);
+	return _mm_movemask_ps(mask);
+#else
+	unsigned int mask = 0;
+	for(unsigned int i = 0; i < packet_width; i++) {
+		glm::vec3 a(packet[i], packet[packet_width + i],
+			    packet[2 * packet_width + i]);
+		glm::vec3 e1(packet[3 * packet_width + i],
+			     packet[4 * packet_width + i],
+			     packet[5 * packet_width + i]);
+		glm::vec3 e2(packet[6 * packet_width + i],
+			     packet[7 * packet_width + i],
+			     packet[8 * packet_width + i]);
+		glm::vec3 p = glm::cross(direction, e2);
+		float det = glm::dot(e1, p);
+		if(det == 0)
+			continue;
+		float inverse_det = 1.0f / det;
+		glm::vec3 s = origin - a;
+		u[i] = glm::dot(s, p) * inverse_det;
+		glm::vec3 q = glm::cross(s, e1);
+		v[i] = glm::dot(direction, q) * inverse_det;
+		t[i] = glm::dot(e2, q) * inverse_det;
+		if(u[i] >= 0 && v[i] >= 0 && u[i] + v[i] <= 1 &&
+		   t[i] >= 0 && t[i] <= max_distance)
+			mask |= 1 << i;
+	}
+	return mask;
+#endif
+}
+
+bool Triangle_BVH::cast(const glm::vec3& origin,
+			const glm::vec3& direction,
+			float max_distance,
+			bool any_hit,
+			Ray_Hit& hit) const {
+
+	if(bvh.empty())
+		return false;
+
+	glm::vec3 inverse_direction = 1.0f / direction;
+	float closest = max_distance;
+	bool found = false;
+
+	//visit the closer child first to shorten the ray early
+	unsigned int stack[128];
+	unsigned int stack_size = 0;
+	float distance;
+	if(!BVH::intersect_ray(bvh.nodes[0].bounds, origin, inverse_direction,
+			       closest, distance))
+		return false;
+	stack[stack_size++] = 0;
+	while(stack_size > 0) {
+		unsigned int node_index = stack[--stack_size];
+		const BVH_Node& node = bvh.nodes[node_index];
+		if(node.count > 0) {
+			const float *packet = &packets[node_packets[node_index] *
+						       packet_size];
+			for(unsigned int i = 0; i < node.count;
+			    i += packet_width, packet += packet_size) {
+				float t[packet_width];
+				float u[packet_width];
+				float v[packet_width];
+				unsigned int mask = intersect_packet(packet, origin,
+								     direction,
+								     closest,
+								     t, u, v);
+				for(unsigned int j = 0; mask; j++, mask >>= 1) {
+					if(!(mask & 1) || t[j] > closest)
+						continue;
+					closest = t[j];
+					hit.triangle = bvh.primitives[node.first + i + j];
+					hit.barycentrics = glm::vec2(u[j], v[j]);
+					hit.distance = t[j];
+					found = true;
+				}
+			}
+			if(found && any_hit)
+				return true;
+			continue;
+		}
+
+		float d_left, d_right;
+		bool left = BVH::intersect_ray(bvh.nodes[node.first].bounds,
+					       origin, inverse_direction,
+					       closest, d_left);
+		bool right = BVH::intersect_ray(bvh.nodes[node.first + 1].bounds,
+						origin, inverse_direction,
+						closest, d_right);
+		if(left && right) {
+			if(d_left <= d_right) {
+				stack[stack_size++] = node.first + 1;
+				stack[stack_size++] = node.first;
+			} else {
+				stack[stack_size++] = node.first;
+				stack[stack_size++] = node.first + 1;
+			}
+		} else if(left) {
+			stack[stack_size++] = node.first;
+		} else if(right) {
+			stack[stack_size++] = node.first + 1;
+		}
+	}
+	return found;
+}
+
+bool Triangle_BVH::raycast(const glm::vec3& origin,
+			   const glm::vec3& direction,
+			   float max_distance,
+			   Ray_Hit& hit) const {
+
+	return cast(origin, direction, max_distance, false, hit);
+}
+
+bool Triangle_BVH::intersects_segment(const glm::vec3& start,
+				      const glm::vec3& end) const {
+
+	Ray_Hit hit;
+	return cast(start, end - start, 1, true, hit);
+}
+
+glm::vec3 Triangle_BVH::closest_point_on_triangle(const glm::vec3& p,
+						  const glm::vec3& a,
+						  const glm::vec3& b,
+						  const glm::vec3& c) {
+
+	//Ericson, Real-Time Collision Detection 5.1.5
+	glm::vec3 ab = b - a;
+	glm::vec3 ac = c - a;
+	glm::vec3 ap = p - a;
+	float d1 = glm::dot(ab, ap);
+	float d2 = glm::dot(ac, ap);
+	if(d1 <= 0 && d2 <= 0)
+		return a;
+
+	glm::vec3 bp = p - b;
+	float d3 = glm::dot(ab, bp);
+	float d4 = glm::dot(ac, bp);
+	if(d3 >= 0 && d4 <= d3)
+		return b;
+
+	float vc = d1 * d4 - d3 * d2;
+	if(vc <= 0 && d1 >= 0 && d3 <= 0)
+		return a + ab * (d1 / (d1 - d3));
+
+	glm::vec3 cp = p - c;
+	float d5 = glm::dot(ab, cp);
+	float d6 = glm::dot(ac, cp);
+	if(d6 >= 0 && d5 <= d6)
+		return c;
+
+	float vb = d5 * d2 - d1 * d6;
+	if(vb <= 0 && d2 >= 0 && d6 <= 0)
+		return a + ac * (d2 / (d2 - d6));
+
+	float va = d3 * d6 - d5 * d4;
+	if(va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+	float denominator = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+//the squared distance between a point and a box
+static float distance2(const AABB& box, const glm::vec3& point) {
+	glm::vec3 d = glm::max(glm::max(box.min - point, point - box.max),
+			       glm::vec3(0));
+	return glm::dot(d, d);
+}
+
+void Triangle_BVH::overlap_sphere(const Sphere& sphere,
+				  std::vector<unsigned int>& triangles) const {
+
+	float radius2 = sphere.radius * sphere.radius;
+	bvh.traverse([&](const AABB& box) {
+		return distance2(box, sphere.center) <= radius2;
+	}, [&](unsigned int triangle) {
+		glm::vec3 p = closest_point_on_triangle(sphere.center,
+					positions[indices[3 * triangle]],
+					positions[indices[3 * triangle + 1]],
+					positions[indices[3 * triangle + 2]]);
+		glm::vec3 d = p - sphere.center;
+		if(glm::dot(d, d) <= radius2)
+			triangles.push_back(triangle);
+		return true;
+	});
+}
+
+void Triangle_BVH::overlap_frustum(const Frustum& frustum,
+				   std::vector<unsigned int>& triangles) const {
+
+	bvh.traverse([&](const AABB& box) {
+		return frustum.intersects(box);
+	}, [&](unsigned int triangle) {
+		//the triangle is outside if all vertices are behind one plane
+		for(const glm::vec4& plane : frustum.planes) {
+			bool outside = true;
+			for(unsigned int i = 0; i < 3 && outside; i++) {
+				const glm::vec3& p = positions[indices[3 * triangle + i]];
+				outside = glm::dot(glm::vec3(plane), p) + plane.w < 0;
+			}
+			if(outside)
+				return true;
+		}
+		triangles.push_back(triangle);
+		return true;
+	});
+}
+
+bool Triangle_BVH::nearest_point(const glm::vec3& point,
+				 float max_distance,
+				 glm::vec3& closest,
+				 unsigned int& triangle) const {
+
+	float best = max_distance * max_distance;
+	bool found = false;
+	bvh.traverse([&](const AABB& box) {
+		return distance2(box, point) <= best;
+	}, [&](unsigned int i) {
+		glm::vec3 p = closest_point_on_triangle(point,
+					positions[indices[3 * i]],
+					positions[indices[3 * i + 1]],
+					positions[indices[3 * i + 2]]);
+		glm::vec3 d = p - point;
+		float d2 = glm::dot(d, d);
+		if(d2 <= best) {
+			best = d2;
+			closest = p;
+			triangle = i;
+			found = true;
+		}
+		return true;
+	});
+	return found;
+}
@@ -16,6 +16,7 @@ Camera::Camera(glm::vec3 position,
 	near_plane = 1.0f;
 	far_plane = 800.f;
 
+	projection_matrix = glm::mat4(1.0);
 	update_view_matrix();
 }
 
@@ -24,6 +25,11 @@ Camera::~Camera() {
 
 void Camera::update_view_matrix() {
 	view_matrix = glm::lookAt(position, position + direction, up);
+	update_frustum();
+}
+
+void Camera::update_frustum() {
+	frustum.update(projection_matrix * view_matrix);
 }
 
 void Camera::move_up(float delta) {
@@ -43,6 +43,7 @@ void IP_Camera::update_projection_matrix() {
 	projection_matrix = glm::infinitePerspective(fovy,
 						(GLfloat)width / (GLfloat)height,
 						near_plane);
+	update_frustum();
 }
 
 std::vector<glm::vec3> IP_Camera::calculate_frustum_points() {
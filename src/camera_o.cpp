@@ -51,6 +51,7 @@ void O_Camera::update_projection_matrix() {
 	projection_matrix = glm::ortho(-width / 2, width / 2,
 				       -height / 2, height / 2,
 				       near_plane, far_plane);
+	update_frustum();
 }
 
 std::vector<glm::vec3> O_Camera::calculate_frustum_points() {
@@ -54,6 +54,7 @@ void P_Camera::update_projection_matrix() {
 	projection_matrix = glm::perspective(fovy,
 					     (GLfloat)width / (GLfloat)height,
 					     near_plane, far_plane);
+	update_frustum();
 }
 
 std::vector<glm::vec3> P_Camera::calculate_frustum_points() {
@@ -109,3 +110,18 @@ std::vector<float> P_Camera::calculate_frustum_distance(glm::vec3 point) {
 
 	return ret;
 }
+
+void P_Camera::calculate_ray(int x, int y,
+			     glm::vec3& origin,
+			     glm::vec3& direction) {
+
+	//window coordinates start at the top left corner
+	glm::vec2 ndc(2 * (x + 0.5f) / width - 1,
+		      1 - 2 * (y + 0.5f) / height);
+
+	glm::mat4 mat = glm::inverse(projection_matrix * view_matrix);
+	glm::vec4 near_point = mat * glm::vec4(ndc.x, ndc.y, -1, 1);
+	glm::vec4 far_point = mat * glm::vec4(ndc.x, ndc.y, 1, 1);
+	origin = glm::vec3(near_point) / near_point.w;
+	direction = glm::normalize(glm::vec3(far_point) / far_point.w - origin);
+}
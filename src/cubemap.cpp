@@ -2,24 +2,19 @@
 
 using namespace sgltk;
 
-Cubemap::Cubemap() : Texture() {
-	target = GL_TEXTURE_CUBE_MAP;
+Cubemap::Cubemap() : Texture(GL_TEXTURE_CUBE_MAP) {
 }
 
 Cubemap::Cubemap(unsigned int res_x,
 		 unsigned int res_y,
 		 GLenum internal_format,
-		 GLenum type, GLenum format) : Texture() {
-
-	target = GL_TEXTURE_CUBE_MAP;
+		 GLenum type, GLenum format) : Texture(GL_TEXTURE_CUBE_MAP) {
 	create_empty(res_x, res_y, internal_format, type, format);
 }
 
 Cubemap::Cubemap(const Image& pos_x, const Image& neg_x,
 		 const Image& pos_y, const Image& neg_y,
-		 const Image& pos_z, const Image& neg_z) : Texture() {
-
-	target = GL_TEXTURE_CUBE_MAP;
+		 const Image& pos_z, const Image& neg_z) : Texture(GL_TEXTURE_CUBE_MAP) {
 	load(pos_x, neg_x, pos_y, neg_y, pos_z, neg_z);
 }
 
@@ -33,6 +28,8 @@ void Cubemap::create_empty(unsigned int res_x,
 
 	width = res_x;
 	height = res_y;
+	track_memory(internal_format, false);
+
 	bind();
 
 	for(unsigned int i = 0; i < 6; i++) {
@@ -45,7 +42,7 @@ void Cubemap::create_empty(unsigned int res_x,
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	unbind();
+	release();
 }
 
 bool Cubemap::load(const std::string& pos_x, const std::string& neg_x,
@@ -70,6 +67,10 @@ bool Cubemap::load(const Image& pos_x, const Image& neg_x,
 	std::vector<const Image *> sides =
 	{&pos_x, &neg_x, &pos_y, &neg_y, &pos_z, &neg_z};
 
+	width = pos_x.width;
+	height = pos_x.height;
+	track_memory(GL_RGBA, false);
+
 	bind();
 	for(unsigned int i = 0; i < 6; i++) {
 		tmp = SDL_ConvertSurfaceFormat(sides[i]->image,
@@ -88,16 +89,14 @@ bool Cubemap::load(const Image& pos_x, const Image& neg_x,
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	unbind();
+	release();
 	return true;
 }
 
 void Cubemap::bind(unsigned int texture_unit) {
-	glActiveTexture(GL_TEXTURE0 + texture_unit);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	State_Cache::get().bind_texture(texture_unit, GL_TEXTURE_CUBE_MAP, texture);
 }
 
 void Cubemap::unbind(unsigned int texture_unit) {
-	glActiveTexture(GL_TEXTURE0 + texture_unit);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	State_Cache::get().bind_texture(texture_unit, GL_TEXTURE_CUBE_MAP, 0);
 }
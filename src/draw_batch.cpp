@@ -0,0 +1,483 @@
+#include <sgltk/draw_batch.h>
+
+using namespace sgltk;
+
+Draw_Batch::Draw_Batch() :
+	index_buffer(GL_ELEMENT_ARRAY_BUFFER),
+	command_buffer(GL_DRAW_INDIRECT_BUFFER),
+	draw_buffer(GL_SHADER_STORAGE_BUFFER),
+	material_buffer(GL_SHADER_STORAGE_BUFFER),
+	draw_id_buffer(GL_ARRAY_BUFFER) {
+
+	glGenVertexArrays(1, &vao);
+	shader = nullptr;
+	view_matrix = nullptr;
+	projection_matrix = nullptr;
+	index_type = GL_UNSIGNED_INT;
+	rebuild = false;
+	update_draw_data = false;
+	location_shader = nullptr;
+	location_link_count = 0;
+
+	draw_data_binding = 0;
+	material_binding = 1;
+	draw_id_name = "draw_id_in";
+	view_matrix_name = "view_matrix";
+	projection_matrix_name = "proj_matrix";
+	view_proj_matrix_name = "view_proj_matrix";
+}
+
+Draw_Batch::~Draw_Batch() {
+	State_Cache::get().delete_vertex_array(vao);
+}
+
+void Draw_Batch::setup_shader(Shader *shader) {
+	this->shader = shader;
+	rebuild = true;
+}
+
+bool Draw_Batch::setup_camera(glm::mat4 *view_matrix,
+			      glm::mat4 *projection_matrix) {
+
+	if(!view_matrix || !projection_matrix)
+		return false;
+
+	this->view_matrix = view_matrix;
+	this->projection_matrix = projection_matrix;
+	return true;
+}
+
+bool Draw_Batch::setup_camera(Camera *camera) {
+	if(!camera)
+		return false;
+
+	view_matrix = &camera->view_matrix;
+	projection_matrix = &camera->projection_matrix;
+	return true;
+}
+
+void Draw_Batch::set_storage_bindings(unsigned int draw_data,
+				      unsigned int material_data) {
+
+	draw_data_binding = draw_data;
+	material_binding = material_data;
+}
+
+void Draw_Batch::set_draw_id_name(const std::string& name) {
+	if(name.length() > 0)
+		draw_id_name = name;
+	else
+		draw_id_name = "draw_id_in";
+	rebuild = true;
+}
+
+//returns the size of a single attribute in bytes
+static unsigned int get_attribute_size(const Vertex_Attribute& attribute) {
+	switch(attribute.type) {
+		case GL_INT_2_10_10_10_REV:
+		case GL_UNSIGNED_INT_2_10_10_10_REV:
+			return 4;
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return attribute.number_elements;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+		case GL_HALF_FLOAT:
+			return 2 * attribute.number_elements;
+		case GL_DOUBLE:
+			return 8 * attribute.number_elements;
+		default:
+			return 4 * attribute.number_elements;
+	}
+}
+
+bool Draw_Batch::compatible(Mesh& mesh) {
+	if(mesh.shader && shader && mesh.shader != shader) {
+		App::error_string.push_back("The mesh uses a different shader "
+					    "than the batch");
+		return false;
+	}
+
+	std::vector<Vertex_Attribute> attributes = mesh.get_vertex_attributes();
+	if(attributes.empty()) {
+		App::error_string.push_back("The mesh has no vertex attributes");
+		return false;
+	}
+	for(const Vertex_Attribute& attribute : attributes) {
+		if(attribute.external_buffer || attribute.divisor > 0) {
+			App::error_string.push_back("Meshes with instanced "
+						    "attributes or attributes "
+						    "in external buffers can "
+						    "not be batched");
+			return false;
+		}
+	}
+	std::sort(attributes.begin(), attributes.end(),
+		[](const Vertex_Attribute& a, const Vertex_Attribute& b) {
+			return a.location < b.location;
+		});
+
+	if(entries.empty()) {
+		//all attributes read from a buffer need the same stride
+		std::vector<unsigned int> buffer_strides;
+		for(const Vertex_Attribute& attribute : attributes) {
+			unsigned int stride = attribute.stride;
+			if(stride == 0)
+				stride = get_attribute_size(attribute);
+			if(attribute.buffer_index >= buffer_strides.size())
+				buffer_strides.resize(attribute.buffer_index + 1, 0);
+			unsigned int& buffer_stride = buffer_strides[attribute.buffer_index];
+			if(buffer_stride > 0 && buffer_stride != stride) {
+				App::error_string.push_back("The attributes of a "
+							    "vertex buffer have "
+							    "different strides");
+				return false;
+			}
+			buffer_stride = stride;
+		}
+		format = attributes;
+		strides = buffer_strides;
+		return true;
+	}
+
+	bool same_format = attributes.size() == format.size();
+	for(unsigned int i = 0; same_format && i < format.size(); i++) {
+		const Vertex_Attribute& a = attributes[i];
+		const Vertex_Attribute& b = format[i];
+		same_format = a.location == b.location &&
+			a.buffer_index == b.buffer_index &&
+			a.number_elements == b.number_elements &&
+			a.type == b.type && a.normalized == b.normalized &&
+			a.stride == b.stride && a.pointer == b.pointer;
+	}
+	if(!same_format) {
+		App::error_string.push_back("The mesh uses a different vertex "
+					    "format than the batch");
+		return false;
+	}
+
+	auto same_textures = [](const std::vector<std::tuple<std::string, const Texture&, unsigned int> >& a,
+				const std::vector<std::tuple<std::string, const Texture&, unsigned int> >& b) {
+		if(a.size() != b.size())
+			return false;
+		for(unsigned int i = 0; i < a.size(); i++) {
+			if(std::get<0>(a[i]) != std::get<0>(b[i]) ||
+			   &std::get<1>(a[i]) != &std::get<1>(b[i]) ||
+			   std::get<2>(a[i]) != std::get<2>(b[i]))
+				return false;
+		}
+		return true;
+	};
+	Mesh *first = entries[0].mesh;
+	if(!same_textures(mesh.textures, first->textures) ||
+	   !same_textures(mesh.auto_textures, first->auto_textures)) {
+		App::error_string.push_back("The mesh uses different textures "
+					    "than the batch");
+		return false;
+	}
+	return true;
+}
+
+unsigned int Draw_Batch::add_material(const Mesh& mesh) {
+	Material_Data material;
+	material.color_ambient = mesh.color_ambient;
+	material.color_diffuse = mesh.color_diffuse;
+	material.color_specular = mesh.color_specular;
+	material.shininess = mesh.shininess;
+	material.shininess_strength = mesh.shininess_strength;
+	material.padding[0] = 0;
+	material.padding[1] = 0;
+
+	for(unsigned int i = 0; i < materials.size(); i++) {
+		const Material_Data& other = materials[i];
+		if(other.color_ambient == material.color_ambient &&
+		   other.color_diffuse == material.color_diffuse &&
+		   other.color_specular == material.color_specular &&
+		   other.shininess == material.shininess &&
+		   other.shininess_strength == material.shininess_strength)
+			return i;
+	}
+	materials.push_back(material);
+	return materials.size() - 1;
+}
+
+int Draw_Batch::add(Mesh& mesh, unsigned int index_buffer,
+		    const glm::mat4 *model_matrix) {
+
+	if(mesh.get_index_buffer_type(index_buffer) == 0) {
+		App::error_string.push_back("Error: Invalid index buffer");
+		return -1;
+	}
+	if(!compatible(mesh))
+		return -1;
+
+	if(!shader)
+		shader = mesh.shader;
+
+	entries.push_back({&mesh, index_buffer});
+	draw_data.push_back(Draw_Data());
+	set_model_matrix(entries.size() - 1,
+			 model_matrix ? *model_matrix : mesh.model_matrix);
+	draw_data.back().material_index = add_material(mesh);
+	rebuild = true;
+	return entries.size() - 1;
+}
+
+void Draw_Batch::set_model_matrix(unsigned int draw,
+				  const glm::mat4& model_matrix) {
+
+	if(draw >= draw_data.size())
+		return;
+
+	Draw_Data& data = draw_data[draw];
+	data.model_matrix = model_matrix * entries[draw].mesh->position_decode;
+	data.normal_matrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model_matrix))));
+	update_draw_data = true;
+}
+
+void Draw_Batch::clear() {
+	entries.clear();
+	format.clear();
+	strides.clear();
+	commands.clear();
+	draw_data.clear();
+	materials.clear();
+	rebuild = false;
+	update_draw_data = false;
+}
+
+unsigned int Draw_Batch::get_num_draws() {
+	return entries.size();
+}
+
+void Draw_Batch::setup_vertex_format() {
+	State_Cache& state = State_Cache::get();
+	state.bind_vertex_array(vao);
+	for(const Vertex_Attribute& attribute : format) {
+		state.bind_buffer(GL_ARRAY_BUFFER,
+				  vertex_buffers[attribute.buffer_index]->buffer);
+		glEnableVertexAttribArray(attribute.location);
+		if(attribute.normalized) {
+			glVertexAttribPointer(attribute.location,
+					      attribute.number_elements,
+					      attribute.type, GL_TRUE,
+					      attribute.stride,
+					      (void *)attribute.pointer);
+			continue;
+		}
+		switch(attribute.type) {
+			case GL_BYTE:
+			case GL_UNSIGNED_BYTE:
+			case GL_SHORT:
+			case GL_UNSIGNED_SHORT:
+			case GL_INT:
+			case GL_UNSIGNED_INT:
+				glVertexAttribIPointer(attribute.location,
+						       attribute.number_elements,
+						       attribute.type,
+						       attribute.stride,
+						       (void *)attribute.pointer);
+				break;
+			case GL_DOUBLE:
+				glVertexAttribLPointer(attribute.location,
+						       attribute.number_elements,
+						       attribute.type,
+						       attribute.stride,
+						       (void *)attribute.pointer);
+				break;
+			default:
+				glVertexAttribPointer(attribute.location,
+						      attribute.number_elements,
+						      attribute.type, GL_FALSE,
+						      attribute.stride,
+						      (void *)attribute.pointer);
+				break;
+		}
+	}
+
+	//the base instance of every command selects its draw data
+	int location = shader ? shader->get_attribute_location(draw_id_name) : -1;
+	if(location >= 0) {
+		state.bind_buffer(GL_ARRAY_BUFFER, draw_id_buffer.buffer);
+		glEnableVertexAttribArray(location);
+		glVertexAttribIPointer(location, 1, GL_UNSIGNED_INT, 0, nullptr);
+		glVertexAttribDivisor(location, 1);
+	}
+	state.release_buffer(GL_ARRAY_BUFFER);
+	state.release_vertex_array();
+}
+
+void Draw_Batch::update_texture_locations() {
+	Mesh *first = entries[0].mesh;
+	if(shader == location_shader &&
+	   shader->get_link_count() == location_link_count &&
+	   texture_locations.size() == first->textures.size() +
+				       first->auto_textures.size())
+		return;
+
+	location_shader = shader;
+	location_link_count = shader->get_link_count();
+	texture_locations.clear();
+	for(const auto *texture_list : {&first->textures, &first->auto_textures}) {
+		for(const auto& tex : *texture_list) {
+			int texture_loc = shader->get_uniform_location(std::get<0>(tex));
+			if(texture_loc >= 0)
+				texture_loc += std::get<2>(tex);
+			texture_locations.push_back(texture_loc);
+		}
+	}
+}
+
+bool Draw_Batch::build() {
+	rebuild = false;
+	commands.clear();
+	location_shader = nullptr;
+	if(entries.empty())
+		return true;
+
+	std::vector<unsigned int> num_vertices(entries.size());
+	std::vector<unsigned int> indices;
+	unsigned int total_vertices = 0;
+	unsigned int max_index = 0;
+	for(unsigned int i = 0; i < entries.size(); i++) {
+		Mesh& mesh = *entries[i].mesh;
+		num_vertices[i] = std::numeric_limits<unsigned int>::max();
+		for(unsigned int j = 0; j < strides.size(); j++) {
+			if(strides[j] == 0)
+				continue;
+			Buffer_Range range = mesh.get_vertex_buffer_range(j);
+			if(!range.buffer) {
+				App::error_string.push_back("The mesh is missing "
+							    "a vertex buffer");
+				return false;
+			}
+			num_vertices[i] = std::min(num_vertices[i],
+						   range.size / strides[j]);
+		}
+
+		std::vector<unsigned int> mesh_indices;
+		if(!mesh.read_indices(entries[i].index_buffer, mesh_indices)) {
+			App::error_string.push_back("Unable to read the indices "
+						    "of the mesh");
+			return false;
+		}
+
+		Draw_Elements_Indirect_Command command;
+		command.count = mesh_indices.size();
+		command.instance_count = 1;
+		command.first_index = indices.size();
+		command.base_vertex = total_vertices;
+		command.base_instance = i;
+		commands.push_back(command);
+
+		//meshes without indices keep an empty command so that the
+		//draw ids still match the entries
+		if(!mesh_indices.empty())
+			max_index = std::max(max_index,
+					     *std::max_element(mesh_indices.begin(),
+							       mesh_indices.end()));
+		indices.insert(indices.end(), mesh_indices.begin(),
+			       mesh_indices.end());
+		total_vertices += num_vertices[i];
+	}
+
+	//copy the vertex data of all meshes behind each other
+	vertex_buffers.resize(strides.size());
+	for(unsigned int j = 0; j < strides.size(); j++) {
+		if(strides[j] == 0)
+			continue;
+		if(!vertex_buffers[j])
+			vertex_buffers[j] = std::make_unique<Buffer>(GL_ARRAY_BUFFER);
+		vertex_buffers[j]->create_empty<unsigned char>(total_vertices * strides[j],
+							       GL_STATIC_DRAW);
+		for(unsigned int i = 0; i < entries.size(); i++) {
+			Buffer_Range range = entries[i].mesh->get_vertex_buffer_range(j);
+			vertex_buffers[j]->copy(range.buffer, range.offset,
+						commands[i].base_vertex * strides[j],
+						num_vertices[i] * strides[j]);
+		}
+	}
+
+	if(max_index <= 0xFFFF) {
+		index_type = GL_UNSIGNED_SHORT;
+		std::vector<unsigned short> narrow_indices(indices.begin(),
+							   indices.end());
+		index_buffer.load(narrow_indices, GL_STATIC_DRAW);
+	} else {
+		index_type = GL_UNSIGNED_INT;
+		index_buffer.load(indices, GL_STATIC_DRAW);
+	}
+
+	std::vector<unsigned int> draw_ids(entries.size());
+	for(unsigned int i = 0; i < draw_ids.size(); i++)
+		draw_ids[i] = i;
+	draw_id_buffer.load(draw_ids, GL_STATIC_DRAW);
+	command_buffer.load(commands, GL_STATIC_DRAW);
+	material_buffer.load(materials, GL_STATIC_DRAW);
+	draw_buffer.load(draw_data, GL_DYNAMIC_DRAW);
+	update_draw_data = false;
+
+	setup_vertex_format();
+	return true;
+}
+
+void Draw_Batch::draw() {
+	if(!shader) {
+		App::error_string.push_back("Error: No shader specified");
+		return;
+	}
+	shader->bind();
+
+	if(rebuild && !build())
+		return;
+
+	if(commands.empty())
+		return;
+
+	if(update_draw_data) {
+		draw_buffer.replace_partial_data(0, draw_data);
+		update_draw_data = false;
+	}
+
+	if(view_matrix)
+		shader->set_uniform(view_matrix_name, false, *view_matrix);
+	if(projection_matrix)
+		shader->set_uniform(projection_matrix_name, false,
+				    *projection_matrix);
+	if(view_matrix && projection_matrix)
+		shader->set_uniform(view_proj_matrix_name, false,
+				    (*projection_matrix) * (*view_matrix));
+
+	//all meshes of the batch share the textures of the first mesh
+	update_texture_locations();
+	Mesh *first = entries[0].mesh;
+	int num_textures = 0;
+	unsigned int i = 0;
+	for(const auto *texture_list : {&first->textures, &first->auto_textures}) {
+		for(const auto& tex : *texture_list) {
+			int texture_loc = texture_locations[i++];
+			if(texture_loc >= 0) {
+				shader->set_uniform(texture_loc, num_textures);
+				const_cast<Texture&>(std::get<1>(tex)).use(num_textures++);
+			}
+		}
+	}
+
+	draw_buffer.bind(GL_SHADER_STORAGE_BUFFER, draw_data_binding);
+	material_buffer.bind(GL_SHADER_STORAGE_BUFFER, material_binding);
+
+	State_Cache& state = State_Cache::get();
+	state.bind_vertex_array(vao);
+	state.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer.buffer);
+	state.bind_buffer(GL_DRAW_INDIRECT_BUFFER, command_buffer.buffer);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, index_type, nullptr,
+				    commands.size(), 0);
+	state.release_buffer(GL_DRAW_INDIRECT_BUFFER);
+	state.release_buffer(GL_ELEMENT_ARRAY_BUFFER);
+	state.release_vertex_array();
+
+	if(state.unbind_after_use) {
+		draw_buffer.unbind();
+		material_buffer.unbind();
+	}
+}
@@ -8,17 +8,23 @@ Framebuffer::Framebuffer(GLenum target) {
 	this->target = target;
 	width = 0;
 	height = 0;
-	glGenFramebuffers(1, &buffer);
+	if(App::direct_state_access)
+		glCreateFramebuffers(1, &buffer);
+	else
+		glGenFramebuffers(1, &buffer);
 	if(max_color_attachments == 0)
 		glGetIntegerv(GL_MAX_COLOR_ATTACHMENTS,
 			      &Framebuffer::max_color_attachments);
 }
 
 Framebuffer::~Framebuffer() {
-	glDeleteFramebuffers(1, &buffer);
+	State_Cache::get().delete_framebuffer(buffer);
 }
 
 GLenum Framebuffer::get_buffer_status() {
+	if(App::direct_state_access)
+		return glCheckNamedFramebufferStatus(buffer, target);
+
 	bind();
 	GLenum ret = glCheckFramebufferStatus(target);
 	unbind();
@@ -26,11 +32,11 @@ GLenum Framebuffer::get_buffer_status() {
 }
 
 void Framebuffer::bind() {
-	glBindFramebuffer(target, buffer);
+	State_Cache::get().bind_framebuffer(target, buffer);
 }
 
 void Framebuffer::bind(GLenum target) {
-	glBindFramebuffer(target, buffer);
+	State_Cache::get().bind_framebuffer(target, buffer);
 	if(draw_buffers.size() == 0) {
 		glDrawBuffer(GL_NONE);
 	} else {
@@ -39,7 +45,7 @@ void Framebuffer::bind(GLenum target) {
 }
 
 void Framebuffer::unbind() {
-	glBindFramebuffer(target, 0);
+	State_Cache::get().bind_framebuffer(target, 0);
 }
 
 bool Framebuffer::attach_texture(GLenum attachment,
@@ -54,9 +60,13 @@ bool Framebuffer::attach_texture(GLenum attachment,
 			"renderbuffers.");
 		return false;
 	}
-	bind();
-	glFramebufferTexture(target, attachment, texture.texture, 0);
-	unbind();
+	if(App::direct_state_access) {
+		glNamedFramebufferTexture(buffer, attachment, texture.texture, 0);
+	} else {
+		bind();
+		glFramebufferTexture(target, attachment, texture.texture, 0);
+		unbind();
+	}
 	GLenum attachment_max = GL_COLOR_ATTACHMENT0 + max_color_attachments;
 	switch(attachment) {
 		case GL_NONE:
@@ -95,9 +105,15 @@ bool Framebuffer::attach_texture_layer(GLenum attachment,
 					    " number of layers of the texture");
 		return false;
 	}
-	bind();
-	glFramebufferTextureLayer(target, attachment, texture.texture, 0, layer);
-	unbind();
+	if(App::direct_state_access) {
+		glNamedFramebufferTextureLayer(buffer, attachment,
+					       texture.texture, 0, layer);
+	} else {
+		bind();
+		glFramebufferTextureLayer(target, attachment,
+					  texture.texture, 0, layer);
+		unbind();
+	}
 	GLenum attachment_max = GL_COLOR_ATTACHMENT0 + max_color_attachments;
 	switch(attachment) {
 		case GL_NONE:
@@ -130,12 +146,19 @@ bool Framebuffer::attach_renderbuffer(GLenum attachment,
 			"renderbuffers.");
 		return false;
 	}
-	bind();
-	glFramebufferRenderbuffer(target,
-				  attachment,
-				  GL_RENDERBUFFER,
-				  buffer.buffer);
-	unbind();
+	if(App::direct_state_access) {
+		glNamedFramebufferRenderbuffer(this->buffer,
+					       attachment,
+					       GL_RENDERBUFFER,
+					       buffer.buffer);
+	} else {
+		bind();
+		glFramebufferRenderbuffer(target,
+					  attachment,
+					  GL_RENDERBUFFER,
+					  buffer.buffer);
+		unbind();
+	}
 	GLenum attachment_max = GL_COLOR_ATTACHMENT0 + max_color_attachments;
 	switch(attachment) {
 		case GL_NONE:
@@ -157,6 +180,16 @@ bool Framebuffer::attach_renderbuffer(GLenum attachment,
 }
 
 void Framebuffer::finalize() {
+	if(App::direct_state_access) {
+		if(draw_buffers.size() == 0) {
+			glNamedFramebufferDrawBuffer(buffer, GL_NONE);
+		} else {
+			glNamedFramebufferDrawBuffers(buffer, draw_buffers.size(),
+						      draw_buffers.data());
+		}
+		return;
+	}
+
 	bind();
 	if(draw_buffers.size() == 0) {
 		glDrawBuffer(GL_NONE);
@@ -179,7 +212,7 @@ void Framebuffer::blit_to(sgltk::Framebuffer *target,
 			  GLenum filter) {
 
 	if(!target) {
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		State_Cache::get().bind_framebuffer(GL_DRAW_FRAMEBUFFER, 0);
 	} else {
 		target->bind(GL_DRAW_FRAMEBUFFER);
 	}
@@ -202,7 +235,7 @@ void Framebuffer::blit_from_default(unsigned int src_x0,
 				    GLbitfield mask,
 				    GLenum filter) {
 
-	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	State_Cache::get().bind_framebuffer(GL_READ_FRAMEBUFFER, 0);
 	bind(GL_DRAW_FRAMEBUFFER);
 	glBlitFramebuffer(src_x0, src_y0, src_x1, src_y1, dst_x0, dst_y0, dst_x1, dst_y1, mask, filter);
 	unbind();
@@ -0,0 +1,202 @@
+#include <sgltk/gpu_memory.h>
+
+using namespace sgltk;
+
+std::map<const void *, Memory_Registry::Entry> Memory_Registry::resources;
+std::vector<std::string> Memory_Registry::owners;
+std::vector<std::function<void(const Memory_Snapshot&)> > Memory_Registry::callbacks;
+size_t Memory_Registry::total = 0;
+size_t Memory_Registry::budget = 0;
+bool Memory_Registry::budget_exceeded = false;
+
+RESOURCE_KIND Memory_Registry::get_buffer_kind(GLenum target) {
+	switch(target) {
+		case GL_ARRAY_BUFFER:
+			return RESOURCE_KIND::VERTEX_BUFFER;
+		case GL_ELEMENT_ARRAY_BUFFER:
+			return RESOURCE_KIND::INDEX_BUFFER;
+		case GL_UNIFORM_BUFFER:
+			return RESOURCE_KIND::UNIFORM_BUFFER;
+		case GL_SHADER_STORAGE_BUFFER:
+			return RESOURCE_KIND::STORAGE_BUFFER;
+		default:
+			return RESOURCE_KIND::OTHER_BUFFER;
+	}
+}
+
+unsigned int Memory_Registry::get_format_size(GLenum internal_format) {
+	switch(internal_format) {
+		case GL_R8:
+		case GL_R8I:
+		case GL_R8UI:
+		case GL_R8_SNORM:
+		case GL_RED:
+		case GL_STENCIL_INDEX8:
+			return 1;
+		case GL_R16:
+		case GL_R16F:
+		case GL_R16I:
+		case GL_R16UI:
+		case GL_RG8:
+		case GL_RG8I:
+		case GL_RG8UI:
+		case GL_RG:
+		case GL_RGB565:
+		case GL_RGBA4:
+		case GL_RGB5_A1:
+		case GL_DEPTH_COMPONENT16:
+			return 2;
+		case GL_RGB8:
+		case GL_SRGB8:
+		case GL_RGB:
+		case GL_DEPTH_COMPONENT24:
+			return 3;
+		case GL_R32F:
+		case GL_R32I:
+		case GL_R32UI:
+		case GL_RG16:
+		case GL_RG16F:
+		case GL_RG16I:
+		case GL_RG16UI:
+		case GL_RGBA8:
+		case GL_SRGB8_ALPHA8:
+		case GL_RGBA:
+		case GL_RGB10_A2:
+		case GL_R11F_G11F_B10F:
+		case GL_RGB9_E5:
+		case GL_DEPTH_COMPONENT32:
+		case GL_DEPTH_COMPONENT32F:
+		case GL_DEPTH_COMPONENT:
+		case GL_DEPTH24_STENCIL8:
+		case GL_DEPTH_STENCIL:
+			return 4;
+		case GL_RGB16:
+		case GL_RGB16F:
+		case GL_RGB16I:
+		case GL_RGB16UI:
+			return 6;
+		case GL_RG32F:
+		case GL_RG32I:
+		case GL_RG32UI:
+		case GL_RGBA16:
+		case GL_RGBA16F:
+		case GL_RGBA16I:
+		case GL_RGBA16UI:
+		case GL_DEPTH32F_STENCIL8:
+			return 8;
+		case GL_RGB32F:
+		case GL_RGB32I:
+		case GL_RGB32UI:
+			return 12;
+		case GL_RGBA32F:
+		case GL_RGBA32I:
+		case GL_RGBA32UI:
+			return 16;
+		default:
+			return 4;
+	}
+}
+
+void Memory_Registry::check_budget() {
+	if(budget == 0 || total <= budget) {
+		budget_exceeded = false;
+		return;
+	}
+
+	//only report the transition into the exceeded state
+	if(budget_exceeded)
+		return;
+
+	budget_exceeded = true;
+	if(callbacks.empty())
+		return;
+
+	Memory_Snapshot snapshot = get_snapshot();
+	for(const auto& callback : callbacks) {
+		callback(snapshot);
+	}
+}
+
+void Memory_Registry::track(const void *resource, RESOURCE_KIND kind,
+			    GLenum hint, size_t size) {
+
+	auto it = resources.find(resource);
+	if(it == resources.end()) {
+		Entry entry;
+		entry.kind = kind;
+		entry.hint = hint;
+		entry.size = size;
+		if(!owners.empty())
+			entry.owner = owners.back();
+		resources[resource] = entry;
+	} else {
+		total -= it->second.size;
+		it->second.kind = kind;
+		it->second.hint = hint;
+		it->second.size = size;
+	}
+	total += size;
+	check_budget();
+}
+
+void Memory_Registry::untrack(const void *resource) {
+	auto it = resources.find(resource);
+	if(it == resources.end())
+		return;
+
+	total -= it->second.size;
+	resources.erase(it);
+	check_budget();
+}
+
+void Memory_Registry::push_owner(const std::string& name) {
+	owners.push_back(name);
+}
+
+void Memory_Registry::pop_owner() {
+	if(!owners.empty())
+		owners.pop_back();
+}
+
+size_t Memory_Registry::get_total() {
+	return total;
+}
+
+Memory_Snapshot Memory_Registry::get_snapshot() {
+	Memory_Snapshot snapshot;
+	snapshot.total = total;
+	snapshot.num_resources = resources.size();
+	for(const auto& resource : resources) {
+		const Entry& entry = resource.second;
+		snapshot.kinds[entry.kind] += entry.size;
+		switch(entry.kind) {
+			case RESOURCE_KIND::TEXTURE:
+			case RESOURCE_KIND::RENDERBUFFER:
+				snapshot.formats[entry.hint] += entry.size;
+				break;
+			default:
+				snapshot.usages[entry.hint] += entry.size;
+				break;
+		}
+		snapshot.owners[entry.owner] += entry.size;
+	}
+	return snapshot;
+}
+
+void Memory_Registry::set_budget(size_t bytes) {
+	budget = bytes;
+	budget_exceeded = false;
+	check_budget();
+}
+
+size_t Memory_Registry::get_budget() {
+	return budget;
+}
+
+void Memory_Registry::add_budget_callback(std::function<void(const Memory_Snapshot&)> callback) {
+	callbacks.push_back(callback);
+}
+
+void Memory_Registry::clear_budget_callbacks() {
+	callbacks.clear();
+}
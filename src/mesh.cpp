@@ -5,17 +5,25 @@ using namespace sgltk;
 Mesh::Mesh() {
 	tf_mode = GL_NONE;
 	model_matrix = glm::mat4(1.0);
+	position_decode = glm::mat4(1.0);
 	shader = nullptr;
 	num_uv = 0;
 	num_col = 0;
 	num_vertices = 0;
-	index_type = 0;
+	transparent = false;
+	frustum_culling = true;
+	cluster_index_buffer = 0;
 	glGenVertexArrays(1, &vao);
+	shares_vertex_array = false;
+	base_vertex = 0;
+	base_instance = 0;
 
 	view_matrix = nullptr;
 	projection_matrix = nullptr;
+	camera_frustum = nullptr;
 
-	bounding_box = { glm::vec3(0, 0, 0), glm::vec3(0, 0, 0) };
+	bounding_box = {glm::vec3(0, 0, 0), glm::vec3(0, 0, 0)};
+	bounding_sphere = {glm::vec3(0, 0, 0), 0};
 
 	model_matrix_name =			"model_matrix";
 	view_matrix_name =			"view_matrix";
@@ -30,6 +38,8 @@ Mesh::Mesh() {
 	specular_color_name =			"color_specular";
 	shininess_name =			"shininess";
 	shininess_strength_name =		"shininess_strength";
+	location_shader = nullptr;
+	location_link_count = 0;
 
 	shininess = 0.0;
 	shininess_strength = 1.0;
@@ -39,7 +49,16 @@ Mesh::Mesh() {
 }
 
 Mesh::~Mesh() {
-	glDeleteVertexArrays(1, &vao);
+	if(!shares_vertex_array)
+		State_Cache::get().delete_vertex_array(vao);
+}
+
+void Mesh::share_vertex_array(Mesh& owner, GLint base_vertex) {
+	if(!shares_vertex_array)
+		State_Cache::get().delete_vertex_array(vao);
+	vao = owner.vao;
+	shares_vertex_array = true;
+	this->base_vertex = base_vertex;
 }
 
 void Mesh::setup_shader(Shader *shader) {
@@ -53,6 +72,7 @@ bool Mesh::setup_camera(glm::mat4 *view_matrix,
 
 	this->view_matrix = view_matrix;
 	this->projection_matrix = projection_matrix;
+	camera_frustum = nullptr;
 	return true;
 }
 
@@ -62,6 +82,7 @@ bool Mesh::setup_camera(Camera *camera) {
 
 	this->view_matrix = &camera->view_matrix;
 	this->projection_matrix = &camera->projection_matrix;
+	camera_frustum = &camera->frustum;
 	return true;
 }
 
@@ -71,6 +92,7 @@ void Mesh::set_model_matrix_name(const std::string& name) {
 		model_matrix_name = name;
 	else
 		model_matrix_name = "model_matrix";
+	location_shader = nullptr;
 }
 
 void Mesh::set_view_matrix_name(const std::string& name) {
@@ -79,6 +101,7 @@ void Mesh::set_view_matrix_name(const std::string& name) {
 		view_matrix_name = name;
 	else
 		view_matrix_name = "view_matrix";
+	location_shader = nullptr;
 }
 
 void Mesh::set_projection_matrix_name(const std::string& name) {
@@ -87,6 +110,7 @@ void Mesh::set_projection_matrix_name(const std::string& name) {
 		projection_matrix_name = name;
 	else
 		projection_matrix_name = "proj_matrix";
+	location_shader = nullptr;
 }
 
 void Mesh::set_model_view_matrix_name(const std::string& name) {
@@ -95,6 +119,7 @@ void Mesh::set_model_view_matrix_name(const std::string& name) {
 		model_view_matrix_name = name;
 	else
 		model_view_matrix_name = "model_view_matrix";
+	location_shader = nullptr;
 }
 
 void Mesh::set_view_proj_matrix_name(const std::string& name) {
@@ -103,6 +128,7 @@ void Mesh::set_view_proj_matrix_name(const std::string& name) {
 		view_proj_matrix_name = name;
 	else
 		view_proj_matrix_name = "view_proj_matrix";
+	location_shader = nullptr;
 }
 
 void Mesh::set_model_view_proj_name(const std::string& name) {
@@ -111,6 +137,7 @@ void Mesh::set_model_view_proj_name(const std::string& name) {
 		model_view_projection_matrix_name = name;
 	else
 		model_view_projection_matrix_name = "model_view_proj_matrix";
+	location_shader = nullptr;
 }
 
 void Mesh::set_normal_matrix_name(const std::string& name) {
@@ -119,6 +146,7 @@ void Mesh::set_normal_matrix_name(const std::string& name) {
 		normal_matrix_name = name;
 	else
 		normal_matrix_name = "normal_matrix";
+	location_shader = nullptr;
 }
 
 void Mesh::set_ambient_color_name(const std::string& name) {
@@ -126,6 +154,7 @@ void Mesh::set_ambient_color_name(const std::string& name) {
 		ambient_color_name = name;
 	else
 		ambient_color_name = "color_ambient";
+	location_shader = nullptr;
 }
 
 void Mesh::set_diffuse_color_name(const std::string& name) {
@@ -133,6 +162,7 @@ void Mesh::set_diffuse_color_name(const std::string& name) {
 		diffuse_color_name = name;
 	else
 		diffuse_color_name = "color_diffuse";
+	location_shader = nullptr;
 }
 
 void Mesh::set_specular_color_name(const std::string& name) {
@@ -140,6 +170,7 @@ void Mesh::set_specular_color_name(const std::string& name) {
 		specular_color_name = name;
 	else
 		specular_color_name = "color_specular";
+	location_shader = nullptr;
 }
 
 void Mesh::set_shininess_name(const std::string& name) {
@@ -147,6 +178,7 @@ void Mesh::set_shininess_name(const std::string& name) {
 		shininess_name = name;
 	else
 		shininess_name = "shininess";
+	location_shader = nullptr;
 }
 
 void Mesh::set_shininess_strength_name(const std::string& name) {
@@ -154,6 +186,7 @@ void Mesh::set_shininess_strength_name(const std::string& name) {
 		shininess_strength_name = name;
 	else
 		shininess_strength_name = "shininess_strength";
+	location_shader = nullptr;
 }
 
 void Mesh::attach_texture(const std::string& name,
@@ -161,6 +194,7 @@ void Mesh::attach_texture(const std::string& name,
 			  unsigned int index) {
 
 	textures.push_back({name, texture, index});
+	location_shader = nullptr;
 }
 
 void Mesh::set_transform_feedback_mode(GLenum mode) {
@@ -176,6 +210,187 @@ void Mesh::attach_buffer(const Buffer *buffer,
 	attached_buffers_indices.push_back(index);
 }
 
+unsigned int Mesh::attach_vertex_range(Buffer_Range *range) {
+	vbo.push_back(nullptr);
+	vbo_ranges.push_back(range);
+	return vbo.size() - 1;
+}
+
+int Mesh::attach_index_range(Buffer_Range *range, GLenum type) {
+	if(!range)
+		return -1;
+
+	switch(type) {
+		case GL_UNSIGNED_BYTE:
+		case GL_UNSIGNED_SHORT:
+		case GL_UNSIGNED_INT:
+			break;
+		default:
+			return -1;
+	}
+
+	ibo.push_back(nullptr);
+	ibo_ranges.push_back(range);
+	ibo_types.push_back(type);
+	return ibo.size() - 1;
+}
+
+bool Mesh::upload(const Mesh_Data& data,
+		  Buffer_Heap *vertex_heap,
+		  Buffer_Heap *index_heap,
+		  GLenum usage) {
+
+	for(const Vertex_Stream& stream : data.streams) {
+		if(stream.buffer_index >= data.buffers.size()) {
+			App::error_string.push_back("Error: The mesh data "
+						    "references a vertex buffer "
+						    "that does not exist");
+			return false;
+		}
+	}
+
+	unsigned int first_buffer = vbo.size();
+	for(const auto& buffer : data.buffers) {
+		Buffer_Range *range = nullptr;
+		if(vertex_heap)
+			range = vertex_heap->upload(buffer.data(), buffer.size());
+		if(range)
+			attach_vertex_range(range);
+		else
+			attach_vertex_buffer(buffer.data(), buffer.size(), usage);
+	}
+
+	auto attach_indices = [&](const std::vector<unsigned int>& indices) {
+		//store the indices as 16-bit values if the mesh is small enough
+		GLenum index_type = get_index_type(indices);
+		Buffer_Range *range = nullptr;
+		if(index_heap) {
+			if(index_type == GL_UNSIGNED_SHORT) {
+				std::vector<unsigned short> narrow_indices(indices.begin(),
+									   indices.end());
+				range = index_heap->upload(narrow_indices);
+			} else {
+				range = index_heap->upload(indices);
+			}
+		}
+		if(range)
+			return attach_index_range(range, index_type);
+		return attach_index_buffer(indices, true);
+	};
+	if(!data.indices.empty())
+		attach_indices(data.indices);
+	for(const Mesh_Data::Lod& lod : data.lods) {
+		int index_buffer = attach_indices(lod.indices);
+		if(index_buffer >= 0)
+			attach_lod(index_buffer, lod.error);
+	}
+
+	copy_properties(data);
+
+	if(shader) {
+		std::vector<Vertex_Stream> streams = data.streams;
+		for(Vertex_Stream& stream : streams)
+			stream.buffer_index += first_buffer;
+		set_vertex_attributes(streams);
+	}
+	return true;
+}
+
+void Mesh::copy_properties(const Mesh_Data& data) {
+	num_vertices = data.num_vertices;
+	num_uv = data.num_uv;
+	num_col = data.num_col;
+	bounding_box = data.bounding_box;
+	bounding_sphere = data.bounding_sphere;
+	position_decode = data.position_decode;
+	if(data.bvh)
+		bvh = data.bvh;
+}
+
+unsigned int Mesh::set_vertex_attributes(const std::vector<Vertex_Stream>& streams) {
+	unsigned int num_found = 0;
+	for(const Vertex_Stream& stream : streams) {
+		int ret;
+		if(stream.normalized) {
+			ret = set_normalized_vertex_attribute(stream.name,
+				stream.buffer_index, stream.number_elements,
+				stream.type, stream.stride,
+				(void *)(uintptr_t)stream.offset);
+		} else {
+			ret = set_vertex_attribute(stream.name,
+				stream.buffer_index, stream.number_elements,
+				stream.type, stream.stride,
+				(void *)(uintptr_t)stream.offset);
+		}
+		if(ret == 0)
+			num_found++;
+	}
+	return num_found;
+}
+
+int Mesh::attach_index_buffer(const std::vector<unsigned int>& indices,
+			      bool narrow) {
+
+	if(narrow && get_index_type(indices) == GL_UNSIGNED_SHORT) {
+		std::vector<unsigned short> narrow_indices(indices.begin(),
+							   indices.end());
+		return attach_index_buffer(narrow_indices);
+	}
+	return attach_index_buffer<unsigned int>(indices);
+}
+
+GLenum Mesh::get_index_type(const std::vector<unsigned int>& indices) {
+	for(unsigned int index : indices) {
+		if(index > 0xFFFF)
+			return GL_UNSIGNED_INT;
+	}
+	return GL_UNSIGNED_SHORT;
+}
+
+GLenum Mesh::get_index_buffer_type(unsigned int index_buffer) {
+	if(index_buffer >= ibo_types.size())
+		return 0;
+
+	return ibo_types[index_buffer];
+}
+
+static unsigned int get_index_size(GLenum type) {
+	switch(type) {
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_UNSIGNED_SHORT:
+			return 2;
+		default:
+			return 4;
+	}
+}
+
+bool Mesh::bind_index_buffer(unsigned int index_buffer,
+			     unsigned int& number_elements,
+			     unsigned int& offset,
+			     GLenum& type) {
+
+	if(index_buffer >= ibo.size()) {
+		App::error_string.push_back("Error: Invalid index buffer");
+		return false;
+	}
+
+	type = ibo_types[index_buffer];
+	Buffer_Range *range = ibo_ranges[index_buffer];
+	if(range) {
+		unsigned int index_size = get_index_size(type);
+		State_Cache::get().bind_buffer(GL_ELEMENT_ARRAY_BUFFER,
+					       range->buffer->buffer);
+		number_elements = range->size / index_size;
+		offset = range->offset;
+	} else {
+		ibo[index_buffer]->bind();
+		number_elements = ibo[index_buffer]->num_elements;
+		offset = 0;
+	}
+	return true;
+}
+
 int Mesh::set_vertex_attribute(const std::string& attrib_name,
 				unsigned int buffer_index,
 				GLint number_elements,
@@ -205,6 +420,52 @@ int Mesh::set_vertex_attribute(int attrib_location,
 				const GLvoid *pointer,
 				unsigned int divisor) {
 
+	return set_attribute(attrib_location, buffer_index, number_elements,
+			     type, false, stride, pointer, divisor);
+}
+
+int Mesh::set_normalized_vertex_attribute(const std::string& attrib_name,
+					  unsigned int buffer_index,
+					  GLint number_elements,
+					  GLenum type,
+					  GLsizei stride,
+					  const GLvoid *pointer,
+					  unsigned int divisor) {
+
+	if(!shader) {
+		return -1;
+	}
+
+	int loc = shader->get_attribute_location(attrib_name);
+	if(loc < 0) {
+		return -2;
+	}
+
+	return set_attribute(loc, buffer_index, number_elements, type, true,
+			     stride, pointer, divisor);
+}
+
+int Mesh::set_normalized_vertex_attribute(int attrib_location,
+					  unsigned int buffer_index,
+					  GLint number_elements,
+					  GLenum type,
+					  GLsizei stride,
+					  const GLvoid *pointer,
+					  unsigned int divisor) {
+
+	return set_attribute(attrib_location, buffer_index, number_elements,
+			     type, true, stride, pointer, divisor);
+}
+
+int Mesh::set_attribute(int attrib_location,
+			unsigned int buffer_index,
+			GLint number_elements,
+			GLenum type,
+			bool normalized,
+			GLsizei stride,
+			const GLvoid *pointer,
+			unsigned int divisor) {
+
 	if(attrib_location < 0) {
 		return -2;
 	}
@@ -213,33 +474,27 @@ int Mesh::set_vertex_attribute(int attrib_location,
 		return -3;
 	}
 
-	glBindVertexArray(vao);
-	vbo[buffer_index]->bind();
-
-	glEnableVertexAttribArray(attrib_location);
-	switch(type) {
-		case GL_BYTE:
-		case GL_UNSIGNED_BYTE:
-		case GL_SHORT:
-		case GL_UNSIGNED_SHORT:
-		case GL_INT:
-		case GL_UNSIGNED_INT:
-			glVertexAttribIPointer(attrib_location, number_elements,
-						type, stride, (void *)pointer);
-			break;
-		case GL_DOUBLE:
-			glVertexAttribLPointer(attrib_location, number_elements,
-						type, stride, (void *)pointer);
-			break;
-		default:
-			glVertexAttribPointer(attrib_location, number_elements,
-						type, GL_FALSE, stride,
-						(void*)pointer);
-			break;
+	remove_range_attribute(attrib_location);
+	record_attribute({attrib_location, buffer_index, nullptr,
+			  number_elements, type, normalized, stride, pointer,
+			  divisor});
+
+	Buffer_Range *range = vbo_ranges[buffer_index];
+	if(range) {
+		vertex_attrib_pointer(attrib_location, range->buffer,
+				      number_elements, type, normalized, stride,
+				      (const char *)pointer + range->offset,
+				      divisor);
+		range_attributes.push_back({attrib_location, range,
+					    range->offset, number_elements,
+					    type, normalized, stride, pointer,
+					    divisor});
+		return 0;
 	}
 
-	glVertexAttribDivisor(attrib_location, divisor);
-	glBindVertexArray(0);
+	vertex_attrib_pointer(attrib_location, vbo[buffer_index].get(),
+			      number_elements, type, normalized, stride,
+			      pointer, divisor);
 	return 0;
 }
 
@@ -276,10 +531,70 @@ int Mesh::set_buffer_vertex_attribute(int attrib_location,
 		return -2;
 	}
 
-	glBindVertexArray(vao);
-	buffer->bind();
+	remove_range_attribute(attrib_location);
+	record_attribute({attrib_location, 0, buffer, number_elements, type,
+			  false, stride, pointer, divisor});
+	vertex_attrib_pointer(attrib_location, buffer, number_elements,
+			      type, false, stride, pointer, divisor);
+	return 0;
+}
+
+void Mesh::record_attribute(const Vertex_Attribute& attribute) {
+	for(Vertex_Attribute& attrib : vertex_attributes) {
+		if(attrib.location == attribute.location) {
+			attrib = attribute;
+			return;
+		}
+	}
+	vertex_attributes.push_back(attribute);
+}
+
+unsigned int Mesh::get_num_vertex_buffers() {
+	return vbo.size();
+}
+
+Buffer_Range Mesh::get_vertex_buffer_range(unsigned int buffer_index) {
+	if(buffer_index >= vbo.size())
+		return {nullptr, 0, 0};
+
+	if(vbo_ranges[buffer_index])
+		return *vbo_ranges[buffer_index];
+
+	return {vbo[buffer_index].get(), 0, vbo[buffer_index]->size};
+}
+
+const std::vector<Vertex_Attribute>& Mesh::get_vertex_attributes() {
+	return vertex_attributes;
+}
+
+void Mesh::vertex_attrib_pointer(int attrib_location,
+				 Buffer *buffer,
+				 GLint number_elements,
+				 GLenum type,
+				 bool normalized,
+				 GLsizei stride,
+				 const GLvoid *pointer,
+				 unsigned int divisor) {
+
+	//the attribute pointers of a shared vertex array are set by the
+	//mesh that owns it, the attributes are only recorded
+	if(shares_vertex_array)
+		return;
+
+	State_Cache& state = State_Cache::get();
+	state.bind_vertex_array(vao);
+	state.bind_buffer(GL_ARRAY_BUFFER, buffer->buffer);
 
 	glEnableVertexAttribArray(attrib_location);
+	//normalized integers are converted to floating point values
+	//in the range [0, 1] or [-1, 1]
+	if(normalized) {
+		glVertexAttribPointer(attrib_location, number_elements, type,
+				      GL_TRUE, stride, (void *)pointer);
+		glVertexAttribDivisor(attrib_location, divisor);
+		state.release_vertex_array();
+		return;
+	}
 	switch(type) {
 		case GL_BYTE:
 		case GL_UNSIGNED_BYTE:
@@ -302,85 +617,462 @@ int Mesh::set_buffer_vertex_attribute(int attrib_location,
 	}
 
 	glVertexAttribDivisor(attrib_location, divisor);
-	glBindVertexArray(0);
-	return 0;
+	state.release_vertex_array();
 }
 
-void Mesh::material_uniform() {
-	shader->set_uniform(ambient_color_name, color_ambient);
-	shader->set_uniform(diffuse_color_name, color_diffuse);
-	shader->set_uniform(specular_color_name, color_specular);
-	shader->set_uniform(shininess_name, shininess);
-	shader->set_uniform(shininess_strength_name, shininess_strength);
+void Mesh::remove_range_attribute(int attrib_location) {
+	range_attributes.erase(std::remove_if(range_attributes.begin(),
+					      range_attributes.end(),
+		[attrib_location](const Range_Attribute& attrib) {
+			return attrib.location == attrib_location;
+		}), range_attributes.end());
+}
 
-	int texture_loc;
-	int num_textures = 0;
-	for(const auto& tex : textures) {
-		texture_loc = shader->get_uniform_location(std::get<0>(tex));
-		if(texture_loc >= 0) {
-			shader->set_uniform(texture_loc + std::get<2>(tex), num_textures);
-			const_cast<Texture&>(std::get<1>(tex)).bind(num_textures++);
-		}
-	}
-	for(const auto& tex : auto_textures) {
-		texture_loc = shader->get_uniform_location(std::get<0>(tex));
-		if(texture_loc >= 0) {
-			shader->set_uniform(texture_loc + std::get<2>(tex), num_textures);
-			const_cast<Texture&>(std::get<1>(tex)).bind(num_textures++);
-		}
+void Mesh::update_range_attributes() {
+	for(Range_Attribute& attrib : range_attributes) {
+		if(attrib.offset == attrib.range->offset)
+			continue;
+
+		attrib.offset = attrib.range->offset;
+		vertex_attrib_pointer(attrib.location, attrib.range->buffer,
+				      attrib.number_elements, attrib.type,
+				      attrib.normalized, attrib.stride,
+				      (const char *)attrib.pointer + attrib.offset,
+				      attrib.divisor);
 	}
 }
 
-void Mesh::draw(GLenum mode) {
-	draw(mode, 0, nullptr);
-}
+void Mesh::update_uniform_locations() {
+	if(shader == location_shader &&
+	   shader->get_link_count() == location_link_count &&
+	   locations.textures.size() == textures.size() + auto_textures.size())
+		return;
 
-void Mesh::draw(GLenum mode, const glm::mat4 *model_matrix) {
-	draw(mode, 0, model_matrix);
+	location_shader = shader;
+	location_link_count = shader->get_link_count();
+	locations.model_matrix = shader->get_uniform_location(model_matrix_name);
+	locations.view_matrix = shader->get_uniform_location(view_matrix_name);
+	locations.projection_matrix = shader->get_uniform_location(projection_matrix_name);
+	locations.model_view_matrix = shader->get_uniform_location(model_view_matrix_name);
+	locations.view_proj_matrix = shader->get_uniform_location(view_proj_matrix_name);
+	locations.model_view_projection_matrix =
+		shader->get_uniform_location(model_view_projection_matrix_name);
+	locations.normal_matrix = shader->get_uniform_location(normal_matrix_name);
+	locations.ambient_color = shader->get_uniform_location(ambient_color_name);
+	locations.diffuse_color = shader->get_uniform_location(diffuse_color_name);
+	locations.specular_color = shader->get_uniform_location(specular_color_name);
+	locations.shininess = shader->get_uniform_location(shininess_name);
+	locations.shininess_strength = shader->get_uniform_location(shininess_strength_name);
+
+	locations.textures.clear();
+	for(const auto *texture_list : {&textures, &auto_textures}) {
+		for(const auto& tex : *texture_list) {
+			int texture_loc = shader->get_uniform_location(std::get<0>(tex));
+			if(texture_loc >= 0)
+				texture_loc += std::get<2>(tex);
+			locations.textures.push_back(texture_loc);
+		}
+	}
 }
 
-void Mesh::draw(GLenum mode,
-		unsigned int index_buffer,
-		const glm::mat4 *model_matrix = nullptr) {
+void Mesh::material_uniform() {
+	shader->set_uniform(locations.ambient_color, color_ambient);
+	shader->set_uniform(locations.diffuse_color, color_diffuse);
+	shader->set_uniform(locations.specular_color, color_specular);
+	shader->set_uniform(locations.shininess, shininess);
+	shader->set_uniform(locations.shininess_strength, shininess_strength);
 
-	if(!shader) {
-		App::error_string.push_back("Error: No shader specified");
-		return;
+	int num_textures = 0;
+	unsigned int i = 0;
+	for(const auto *texture_list : {&textures, &auto_textures}) {
+		for(const auto& tex : *texture_list) {
+			int texture_loc = locations.textures[i++];
+			if(texture_loc >= 0) {
+				shader->set_uniform(texture_loc, num_textures);
+				const_cast<Texture&>(std::get<1>(tex)).use(num_textures++);
+			}
+		}
 	}
+}
 
-	glm::mat4 M;
+void Mesh::set_matrix_uniforms(const glm::mat4& model_matrix) {
+	glm::mat4 M = model_matrix;
 	glm::mat4 MV;
 	glm::mat4 MVP;
 	glm::mat4 VP;
 	glm::mat3 NM;
-	if(model_matrix)
-		M = *model_matrix;
-	else
-		M = this->model_matrix;
-	shader->set_uniform(model_matrix_name, false, M);
 
+	//the normals are not affected by the position decoding
 	NM = glm::transpose(glm::inverse(glm::mat3(M)));
-	shader->set_uniform(normal_matrix_name, false, NM);
+	shader->set_uniform(locations.normal_matrix, false, NM);
+
+	M = M * position_decode;
+	shader->set_uniform(locations.model_matrix, false, M);
 
 	if(view_matrix) {
 		MV = (*view_matrix) * M;
-		shader->set_uniform(view_matrix_name, false, *view_matrix);
-		shader->set_uniform(model_view_matrix_name, false, MV);
+		shader->set_uniform(locations.view_matrix, false, *view_matrix);
+		shader->set_uniform(locations.model_view_matrix, false, MV);
 	}
 	if(projection_matrix) {
 		if(view_matrix) {
 			MVP = (*projection_matrix) * MV;
 			VP = (*projection_matrix) * (*view_matrix);
-			shader->set_uniform(view_proj_matrix_name, false, VP);
+			shader->set_uniform(locations.view_proj_matrix, false, VP);
 		} else {
 			MVP = (*projection_matrix) * M;
 		}
-		shader->set_uniform(projection_matrix_name, false,
+		shader->set_uniform(locations.projection_matrix, false,
 						*projection_matrix);
-		shader->set_uniform(model_view_projection_matrix_name,
+		shader->set_uniform(locations.model_view_projection_matrix,
 								false, MVP);
 	}
+}
+
+void Mesh::draw(GLenum mode) {
+	draw(mode, 0, nullptr);
+}
+
+template <typename T>
+static void unpack_indices(const std::vector<unsigned char>& raw,
+			   std::vector<unsigned int>& indices) {
+
+	const T *data = (const T *)raw.data();
+	for(unsigned int i = 0; i < indices.size(); i++)
+		indices[i] = data[i];
+}
+
+template <typename T>
+static void pack_indices(const std::vector<unsigned int>& indices,
+			 std::vector<unsigned char>& raw) {
+
+	T *data = (T *)raw.data();
+	for(unsigned int i = 0; i < indices.size(); i++)
+		data[i] = (T)indices[i];
+}
+
+bool Mesh::read_indices(unsigned int index_buffer,
+			std::vector<unsigned int>& indices) {
+
+	if(index_buffer >= ibo.size())
+		return false;
+
+	Buffer *buffer;
+	unsigned int offset;
+	unsigned int size;
+	if(ibo_ranges[index_buffer]) {
+		buffer = ibo_ranges[index_buffer]->buffer;
+		offset = ibo_ranges[index_buffer]->offset;
+		size = ibo_ranges[index_buffer]->size;
+	} else {
+		buffer = ibo[index_buffer].get();
+		offset = 0;
+		size = buffer->size;
+	}
+
+	unsigned int index_size = get_index_size(ibo_types[index_buffer]);
+	std::vector<unsigned char> raw(size);
+	indices.resize(size / index_size);
+	if(indices.empty() || !buffer->store(offset, size, raw.data()))
+		return false;
+
+	switch(index_size) {
+		case 1:
+			unpack_indices<GLubyte>(raw, indices);
+			break;
+		case 2:
+			unpack_indices<GLushort>(raw, indices);
+			break;
+		default:
+			unpack_indices<GLuint>(raw, indices);
+			break;
+	}
+	return true;
+}
+
+void Mesh::write_indices(unsigned int index_buffer,
+			 const std::vector<unsigned int>& indices) {
+
+	Buffer *buffer;
+	unsigned int offset;
+	if(ibo_ranges[index_buffer]) {
+		buffer = ibo_ranges[index_buffer]->buffer;
+		offset = ibo_ranges[index_buffer]->offset;
+	} else {
+		buffer = ibo[index_buffer].get();
+		offset = 0;
+	}
+
+	unsigned int index_size = get_index_size(ibo_types[index_buffer]);
+	std::vector<unsigned char> raw(indices.size() * index_size);
+	switch(index_size) {
+		case 1:
+			pack_indices<GLubyte>(indices, raw);
+			break;
+		case 2:
+			pack_indices<GLushort>(indices, raw);
+			break;
+		default:
+			pack_indices<GLuint>(indices, raw);
+			break;
+	}
+	buffer->replace_partial_data(offset, raw.data(), raw.size());
+}
+
+Vertex_Cache_Report Mesh::optimize(unsigned int cache_size,
+				   const glm::vec3 *positions,
+				   unsigned int stride) {
+
+	Vertex_Cache_Report report;
+	for(unsigned int i = 0; i < ibo.size(); i++) {
+		std::vector<unsigned int> indices;
+		if(!read_indices(i, indices))
+			continue;
+
+		unsigned int num_vertices = *std::max_element(indices.begin(),
+							      indices.end()) + 1;
+		report.before.add(Mesh_Optimizer::analyze(indices, num_vertices,
+							  cache_size));
+		std::vector<unsigned int> clusters =
+			Mesh_Optimizer::optimize_vertex_cache(indices,
+							      num_vertices,
+							      cache_size);
+		if(positions) {
+			Mesh_Optimizer::optimize_overdraw(indices, clusters,
+							  positions, stride);
+		}
+		report.after.add(Mesh_Optimizer::analyze(indices, num_vertices,
+							 cache_size));
+		write_indices(i, indices);
+	}
+	return report;
+}
+
+unsigned int Mesh::generate_lods(const glm::vec3 *positions,
+				 unsigned int stride,
+				 unsigned int num_levels,
+				 float ratio) {
+
+	std::vector<unsigned int> indices;
+	if(!positions || !read_indices(0, indices))
+		return 0;
+
+	unsigned int num_vertices = *std::max_element(indices.begin(),
+						      indices.end()) + 1;
+	unsigned int num_generated = 0;
+	unsigned int target = indices.size();
+	unsigned int previous = indices.size();
+	for(unsigned int i = 0; i < num_levels; i++) {
+		target = (unsigned int)(target * ratio);
+		float error;
+		std::vector<unsigned int> lod =
+			Mesh_Optimizer::simplify(indices, num_vertices,
+						 positions, stride,
+						 target, &error);
+		//stop once the simplification makes no more progress
+		if(lod.empty() || lod.size() >= previous)
+			break;
+
+		previous = lod.size();
+		attach_lod(attach_index_buffer(lod, true), error);
+		num_generated++;
+	}
+	return num_generated;
+}
+
+void Mesh::attach_lod(unsigned int index_buffer, float error) {
+	lods.push_back({index_buffer, error});
+	std::sort(lods.begin(), lods.end(), [](const Lod& a, const Lod& b) {
+		return a.error < b.error;
+	});
+}
+
+unsigned int Mesh::get_num_lods() {
+	return lods.size() + 1;
+}
+
+float Mesh::get_lod_error(unsigned int level) {
+	if(level == 0 || level > lods.size())
+		return 0;
+
+	return lods[level - 1].error;
+}
+
+unsigned int Mesh::select_lod(const glm::mat4& model_matrix,
+			      float threshold) {
+
+	if(lods.empty() || threshold <= 0 ||
+	   !view_matrix || !projection_matrix)
+		return 0;
+
+	const glm::vec3& center = bounding_sphere.center;
+	float radius = bounding_sphere.radius;
+	float scale = std::max(glm::length(glm::vec3(model_matrix[0])),
+			       std::max(glm::length(glm::vec3(model_matrix[1])),
+					glm::length(glm::vec3(model_matrix[2]))));
+	if(radius <= 0 || scale <= 0)
+		return 0;
+
+	//the diameter of the sphere on the screen as a fraction of the
+	//viewport height
+	const glm::mat4& P = *projection_matrix;
+	float size;
+	if(P[3][3] == 1) {
+		size = radius * scale * P[1][1];
+	} else {
+		glm::vec4 eye = *view_matrix * model_matrix * glm::vec4(center, 1);
+		float distance = -eye.z;
+		if(distance <= radius * scale)
+			return 0;
+		size = radius * scale * P[1][1] / distance;
+	}
+
+	//the coarsest level whose projected error is below the threshold
+	unsigned int index_buffer = 0;
+	for(const Lod& lod : lods) {
+		if(lod.error / (2 * radius) * size > threshold)
+			break;
+		index_buffer = lod.index_buffer;
+	}
+	return index_buffer;
+}
+
+unsigned int Mesh::build_clusters(const glm::vec3 *positions,
+				  unsigned int stride,
+				  unsigned int index_buffer,
+				  unsigned int max_vertices,
+				  unsigned int max_triangles) {
+
+	std::vector<unsigned int> indices;
+	if(!positions || !read_indices(index_buffer, indices))
+		return 0;
+
+	unsigned int num_vertices = *std::max_element(indices.begin(),
+						      indices.end()) + 1;
+	clusters = Mesh_Optimizer::build_clusters(indices, num_vertices,
+						  positions, stride,
+						  max_vertices,
+						  max_triangles);
+	write_indices(index_buffer, indices);
+	cluster_index_buffer = index_buffer;
+
+	if(!cluster_buffer)
+		cluster_buffer = std::make_unique<Buffer>(GL_SHADER_STORAGE_BUFFER);
+	cluster_buffer->load(clusters, GL_STATIC_DRAW);
+	return clusters.size();
+}
+
+Buffer *Mesh::get_cluster_buffer() {
+	return cluster_buffer.get();
+}
+
+bool Mesh::build_bvh(const glm::vec3 *positions,
+		     unsigned int stride,
+		     unsigned int index_buffer) {
+
+	std::vector<unsigned int> indices;
+	if(!positions || !read_indices(index_buffer, indices))
+		return false;
+
+	return build_bvh(indices, positions, stride);
+}
+
+bool Mesh::build_bvh(const std::vector<unsigned int>& indices,
+		     const glm::vec3 *positions,
+		     unsigned int stride) {
+
+	if(!positions || indices.empty())
+		return false;
+
+	unsigned int num_vertices = *std::max_element(indices.begin(),
+						      indices.end()) + 1;
+	if(!bvh)
+		bvh = std::make_shared<Triangle_BVH>();
+	return bvh->build(indices, positions, stride, num_vertices);
+}
+
+const Triangle_BVH *Mesh::get_bvh() const {
+	return bvh.get();
+}
+
+bool Mesh::raycast(const glm::vec3& origin,
+		   const glm::vec3& direction,
+		   Ray_Hit& hit,
+		   float max_distance,
+		   const glm::mat4 *model_matrix) {
+
+	if(!bvh)
+		return false;
+
+	//affine transformations keep the distances along the ray
+	glm::mat4 inverse = glm::inverse(model_matrix ? *model_matrix :
+					 this->model_matrix);
+	return bvh->raycast(glm::vec3(inverse * glm::vec4(origin, 1)),
+			    glm::vec3(inverse * glm::vec4(direction, 0)),
+			    max_distance, hit);
+}
+
+unsigned int Mesh::draw_clusters(const glm::mat4 *model_matrix) {
+	if(!shader) {
+		App::error_string.push_back("Error: No shader specified");
+		return 0;
+	}
+	shader->bind();
+	update_uniform_locations();
+
+	glm::mat4 M = model_matrix ? *model_matrix : this->model_matrix;
+	if(clusters.empty() || !view_matrix || !projection_matrix) {
+		draw(GL_TRIANGLES, cluster_index_buffer, &M);
+		return clusters.size();
+	}
 
+	//cull in the coordinate system of the mesh
+	glm::mat4 MV = (*view_matrix) * M;
+	glm::mat4 inverse_MV = glm::inverse(MV);
+	Frustum frustum((*projection_matrix) * MV);
+	bool perspective = (*projection_matrix)[3][3] != 1;
+	glm::vec3 camera_position = glm::vec3(inverse_MV[3]);
+	glm::vec3 view_direction = glm::normalize(glm::vec3(inverse_MV *
+							    glm::vec4(0, 0, -1, 0)));
+
+	unsigned int number_elements;
+	unsigned int offset;
+	GLenum index_type;
+	std::vector<GLsizei> counts;
+	std::vector<const GLvoid *> offsets;
+	unsigned int num_visible = 0;
+	unsigned int index_size = get_index_size(ibo_types[cluster_index_buffer]);
+	unsigned int next_index = 0;
+	for(const Mesh_Cluster& cluster : clusters) {
+		bool visible = frustum.intersects(Sphere{cluster.center,
+							 cluster.radius});
+		if(visible && !twosided && cluster.cone_cutoff < 1) {
+			glm::vec3 direction = view_direction;
+			if(perspective)
+				direction = glm::normalize(cluster.cone_apex -
+							   camera_position);
+			if(glm::dot(direction, cluster.cone_axis) >=
+			   cluster.cone_cutoff)
+				visible = false;
+		}
+		if(!visible)
+			continue;
+
+		num_visible++;
+		//merge clusters that are adjacent in the index buffer
+		if(!counts.empty() && next_index == cluster.first_index) {
+			counts.back() += cluster.num_indices;
+		} else {
+			counts.push_back(cluster.num_indices);
+			offsets.push_back((const GLvoid *)(uintptr_t)
+					  (cluster.first_index * index_size));
+		}
+		next_index = cluster.first_index + cluster.num_indices;
+	}
+	if(counts.empty())
+		return 0;
+
+	set_matrix_uniforms(M);
 	material_uniform();
 
 	for(unsigned int i = 0; i < attached_buffers.size(); i++) {
@@ -388,8 +1080,70 @@ void Mesh::draw(GLenum mode,
 					  attached_buffers_indices[i]);
 	}
 
-	glBindVertexArray(vao);
-	ibo[index_buffer]->bind();
+	update_range_attributes();
+
+	State_Cache& state = State_Cache::get();
+	state.bind_vertex_array(vao);
+	if(!bind_index_buffer(cluster_index_buffer, number_elements, offset,
+			      index_type)) {
+		state.release_vertex_array();
+		return 0;
+	}
+	for(const GLvoid *& pointer : offsets)
+		pointer = (const GLvoid *)((uintptr_t)pointer + offset);
+	if(base_vertex != 0) {
+		std::vector<GLint> base_vertices(counts.size(), base_vertex);
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(),
+					      index_type, offsets.data(),
+					      counts.size(),
+					      base_vertices.data());
+	} else {
+		glMultiDrawElements(GL_TRIANGLES, counts.data(), index_type,
+				    offsets.data(), counts.size());
+	}
+	state.release_buffer(GL_ELEMENT_ARRAY_BUFFER);
+	state.release_vertex_array();
+
+	if(state.unbind_after_use) {
+		for(unsigned int i = 0; i < attached_buffers.size(); i++) {
+			attached_buffers[i]->unbind();
+		}
+	}
+	return num_visible;
+}
+
+void Mesh::bind_vertex_state() {
+	for(unsigned int i = 0; i < attached_buffers.size(); i++) {
+		attached_buffers[i]->bind(attached_buffers_targets[i],
+					  attached_buffers_indices[i]);
+	}
+
+	update_range_attributes();
+
+	State_Cache::get().bind_vertex_array(vao);
+}
+
+void Mesh::release_vertex_state() {
+	State_Cache& state = State_Cache::get();
+	state.release_buffer(GL_ELEMENT_ARRAY_BUFFER);
+	state.release_vertex_array();
+
+	if(state.unbind_after_use) {
+		for(unsigned int i = 0; i < attached_buffers.size(); i++) {
+			attached_buffers[i]->unbind();
+		}
+	}
+}
+
+bool Mesh::draw_elements(GLenum mode, unsigned int index_buffer,
+			 unsigned int num_instances) {
+	unsigned int number_elements;
+	unsigned int offset;
+	GLenum index_type;
+	if(!bind_index_buffer(index_buffer, number_elements, offset,
+			      index_type))
+		return false;
+
 	if(shader->transform_feedback) {
 		GLenum primitive_type = tf_mode;
 		if(primitive_type == GL_NONE) {
@@ -417,92 +1171,138 @@ void Mesh::draw(GLenum mode,
 		}
 		glBeginTransformFeedback(primitive_type);
 	}
-	glDrawElements(mode, ibo[index_buffer]->num_elements,
-		       index_type, (void*)0);
+	void *indices = (void *)(uintptr_t)offset;
+	if(num_instances > 0) {
+		if(base_instance > 0)
+			glDrawElementsInstancedBaseVertexBaseInstance(mode,
+				number_elements, index_type, indices,
+				num_instances, base_vertex, base_instance);
+		else if(base_vertex != 0)
+			glDrawElementsInstancedBaseVertex(mode, number_elements,
+				index_type, indices, num_instances, base_vertex);
+		else
+			glDrawElementsInstanced(mode, number_elements,
+				index_type, indices, num_instances);
+	} else if(base_vertex != 0) {
+		glDrawElementsBaseVertex(mode, number_elements, index_type,
+					 indices, base_vertex);
+	} else {
+		glDrawElements(mode, number_elements, index_type, indices);
+	}
 	if(shader->transform_feedback) {
 		glEndTransformFeedback();
 	}
-	ibo[index_buffer]->unbind();
-	glBindVertexArray(0);
+	return true;
+}
 
-	for(unsigned int i = 0; i < attached_buffers.size(); i++) {
-		attached_buffers[i]->unbind();
+void Mesh::draw(GLenum mode, const glm::mat4 *model_matrix) {
+	draw(mode, 0, model_matrix);
+}
+
+bool Mesh::is_visible(const glm::mat4& model_matrix) {
+	if(!view_matrix || !projection_matrix)
+		return true;
+
+	//bounds that were never computed are degenerate and do not cull
+	//anything
+	bool sphere = bounding_sphere.radius > 0;
+	bool box = bounding_box.min != bounding_box.max;
+
+	//cameras keep their frustum up to date in world space, the planes
+	//only have to be extracted when the mesh was set up with raw matrices
+	if(camera_frustum) {
+		if(sphere && !camera_frustum->intersects(
+				Bounds::transform(bounding_sphere, model_matrix)))
+			return false;
+		if(box && !camera_frustum->intersects(
+				Bounds::transform(bounding_box, model_matrix)))
+			return false;
+		return true;
 	}
+
+	Frustum frustum((*projection_matrix) * (*view_matrix) * model_matrix);
+	if(sphere && !frustum.intersects(bounding_sphere))
+		return false;
+	if(box && !frustum.intersects(bounding_box))
+		return false;
+	return true;
 }
 
-void Mesh::draw_instanced(GLenum mode, unsigned int num_instances) {
-	draw_instanced(mode, 0, num_instances);
+void Mesh::draw(GLenum mode,
+		unsigned int index_buffer,
+		const glm::mat4 *model_matrix = nullptr) {
+
+	const glm::mat4& M = model_matrix ? *model_matrix : this->model_matrix;
+	if(frustum_culling && !is_visible(M))
+		return;
+
+	draw_unculled(mode, index_buffer, M);
 }
 
-void Mesh::draw_instanced(GLenum mode, unsigned int index_buffer,
-					unsigned int num_instances) {
+void Mesh::draw_unculled(GLenum mode, unsigned int index_buffer,
+			 const glm::mat4& model_matrix) {
 
+	if(!set_draw_uniforms(model_matrix))
+		return;
+
+	bind_vertex_state();
+	draw_elements(mode, index_buffer);
+	release_vertex_state();
+}
+
+bool Mesh::set_draw_uniforms(const glm::mat4& model_matrix) {
 	if(!shader) {
 		App::error_string.push_back("Error: No shader specified");
-		return;
+		return false;
+	}
+	shader->bind();
+	update_uniform_locations();
+
+	set_matrix_uniforms(model_matrix);
+
+	material_uniform();
+	return true;
+}
+
+bool Mesh::set_instanced_uniforms() {
+	if(!shader) {
+		App::error_string.push_back("Error: No shader specified");
+		return false;
 	}
+	shader->bind();
+	update_uniform_locations();
 
 	if(!view_matrix) {
 		App::error_string.push_back("Error: No view matrix specified");
-		return;
+		return false;
 	}
 
 	if(!projection_matrix) {
 		App::error_string.push_back("Error: No projection matrix specified");
-		return;
+		return false;
 	}
 
 	glm::mat4 VP = (*projection_matrix) * (*view_matrix);
 
-	shader->set_uniform(view_matrix_name, false, *view_matrix);
-	shader->set_uniform(projection_matrix_name, false, *projection_matrix);
-	shader->set_uniform(view_proj_matrix_name, false, VP);
+	shader->set_uniform(locations.view_matrix, false, *view_matrix);
+	shader->set_uniform(locations.projection_matrix, false, *projection_matrix);
+	shader->set_uniform(locations.view_proj_matrix, false, VP);
 
 	material_uniform();
+	return true;
+}
 
-	for(unsigned int i = 0; i < attached_buffers.size(); i++) {
-		attached_buffers[i]->bind(attached_buffers_targets[i],
-					  attached_buffers_indices[i]);
-	}
+void Mesh::draw_instanced(GLenum mode, unsigned int num_instances) {
+	draw_instanced(mode, 0, num_instances);
+}
 
-	glBindVertexArray(vao);
-	ibo[index_buffer]->bind();
-	if(shader->transform_feedback) {
-		GLenum primitive_type = tf_mode;
-		if(primitive_type == GL_NONE) {
-			switch(mode) {
-				case GL_POINTS:
-					primitive_type = GL_POINTS;
-					break;
-				case GL_LINES:
-				case GL_LINE_LOOP:
-				case GL_LINE_STRIP:
-				case GL_LINES_ADJACENCY:
-				case GL_LINE_STRIP_ADJACENCY:
-					primitive_type = GL_LINES;
-					break;
-				case GL_TRIANGLES:
-				case GL_TRIANGLE_STRIP:
-				case GL_TRIANGLE_FAN:
-				case GL_TRIANGLES_ADJACENCY:
-				case GL_TRIANGLE_STRIP_ADJACENCY:
-					primitive_type = GL_TRIANGLES;
-					break;
-				default:
-					break;
-			}
-		}
-		glBeginTransformFeedback(primitive_type);
-	}
-	glDrawElementsInstanced(mode, ibo[index_buffer]->num_elements,
-		       index_type, (void*)0, num_instances);
-	if(shader->transform_feedback) {
-		glEndTransformFeedback();
-	}
-	ibo[index_buffer]->unbind();
-	glBindVertexArray(0);
+void Mesh::draw_instanced(GLenum mode, unsigned int index_buffer,
+					unsigned int num_instances) {
 
-	for(unsigned int i = 0; i < attached_buffers.size(); i++) {
-		attached_buffers[i]->unbind();
-	}
+	if(!set_instanced_uniforms())
+		return;
+
+	bind_vertex_state();
+	draw_elements(mode, index_buffer, num_instances);
+	release_vertex_state();
 }
@@ -0,0 +1,284 @@
+#include <sgltk/mesh_data.h>
+
+using namespace sgltk;
+
+static const char mesh_data_magic[8] = {'s', 'g', 'l', 't', 'k', 'm', 's', 'h'};
+static const std::uint32_t mesh_data_version = 1;
+
+Mesh_Data::Mesh_Data() {
+	num_vertices = 0;
+	num_uv = 0;
+	num_col = 0;
+	bounding_box = {glm::vec3(0, 0, 0), glm::vec3(0, 0, 0)};
+	bounding_sphere = {glm::vec3(0, 0, 0), 0};
+	position_decode = glm::mat4(1.0);
+}
+
+unsigned int Mesh_Data::add_stream(const std::string& name,
+				   GLint number_elements,
+				   GLenum type,
+				   bool normalized,
+				   unsigned int size,
+				   const void *data) {
+
+	const unsigned char *bytes = (const unsigned char *)data;
+	buffers.emplace_back(bytes, bytes + (size_t)size * num_vertices);
+	streams.push_back({name, number_elements, type, normalized, size,
+			   (unsigned int)buffers.size() - 1, size, 0});
+	return streams.size() - 1;
+}
+
+bool Mesh_Data::remove_stream(const std::string& name) {
+	auto it = std::find_if(streams.begin(), streams.end(),
+			       [&name](const Vertex_Stream& stream) {
+		return stream.name == name;
+	});
+	if(it == streams.end())
+		return false;
+
+	unsigned int buffer_index = it->buffer_index;
+	streams.erase(it);
+	for(const Vertex_Stream& stream : streams) {
+		if(stream.buffer_index == buffer_index)
+			return true;
+	}
+
+	buffers.erase(buffers.begin() + buffer_index);
+	for(Vertex_Stream& stream : streams) {
+		if(stream.buffer_index > buffer_index)
+			stream.buffer_index--;
+	}
+	return true;
+}
+
+const Vertex_Stream *Mesh_Data::get_stream(const std::string& name) const {
+	for(const Vertex_Stream& stream : streams) {
+		if(stream.name == name)
+			return &stream;
+	}
+	return nullptr;
+}
+
+void Mesh_Data::interleave() {
+	//keep every attribute aligned to 4 bytes
+	unsigned int stride = 0;
+	std::vector<unsigned int> offsets(streams.size());
+	for(unsigned int i = 0; i < streams.size(); i++) {
+		offsets[i] = stride;
+		stride += (streams[i].size + 3) / 4 * 4;
+	}
+
+	std::vector<unsigned char> vertices((size_t)stride * num_vertices, 0);
+	for(unsigned int i = 0; i < streams.size(); i++) {
+		Vertex_Stream& stream = streams[i];
+		const unsigned char *source = buffers[stream.buffer_index].data() +
+			stream.offset;
+		for(unsigned int j = 0; j < num_vertices; j++) {
+			std::memcpy(&vertices[(size_t)j * stride + offsets[i]],
+				    source + (size_t)j * stream.stride,
+				    stream.size);
+		}
+	}
+
+	for(unsigned int i = 0; i < streams.size(); i++) {
+		streams[i].buffer_index = 0;
+		streams[i].stride = stride;
+		streams[i].offset = offsets[i];
+	}
+	buffers.clear();
+	buffers.push_back(std::move(vertices));
+}
+
+void Mesh_Data::compute_bounds(const glm::vec3 *positions,
+			       unsigned int stride) {
+
+	bounding_box = Bounds::compute_aabb(positions, num_vertices, stride);
+	bounding_sphere = Bounds::compute_sphere(positions, num_vertices,
+						 stride);
+}
+
+bool Mesh_Data::build_bvh(const glm::vec3 *positions,
+			  unsigned int stride,
+			  unsigned int num_threads) {
+
+	if(!positions || indices.empty())
+		return false;
+
+	std::shared_ptr<Triangle_BVH> tmp = std::make_shared<Triangle_BVH>();
+	if(!tmp->build(indices, positions, stride, num_vertices, num_threads))
+		return false;
+	bvh = tmp;
+	return true;
+}
+
+size_t Mesh_Data::get_size() const {
+	size_t size = indices.size() * sizeof(unsigned int);
+	for(const auto& buffer : buffers)
+		size += buffer.size();
+	for(const Lod& lod : lods)
+		size += lod.indices.size() * sizeof(unsigned int);
+	return size;
+}
+
+template <typename T>
+static void write_value(std::ostream& stream, const T& value) {
+	stream.write((const char *)&value, sizeof(T));
+}
+
+template <typename T>
+static void write_vector(std::ostream& stream, const std::vector<T>& values) {
+	write_value(stream, (std::uint64_t)values.size());
+	stream.write((const char *)values.data(), values.size() * sizeof(T));
+}
+
+static void write_string(std::ostream& stream, const std::string& value) {
+	write_value(stream, (std::uint64_t)value.size());
+	stream.write(value.data(), value.size());
+}
+
+template <typename T>
+static bool read_value(std::istream& stream, T& value) {
+	return (bool)stream.read((char *)&value, sizeof(T));
+}
+
+template <typename T>
+static bool read_vector(std::istream& stream, std::vector<T>& values) {
+	std::uint64_t size;
+	if(!read_value(stream, size))
+		return false;
+	//reject sizes larger than the rest of the stream before allocating
+	std::streampos position = stream.tellg();
+	if(position >= 0) {
+		stream.seekg(0, std::ios::end);
+		std::streamoff remaining = stream.tellg() - position;
+		stream.seekg(position);
+		if(size > (std::uint64_t)remaining / sizeof(T))
+			return false;
+	}
+	values.resize(size);
+	return (bool)stream.read((char *)values.data(), size * sizeof(T));
+}
+
+static bool read_string(std::istream& stream, std::string& value) {
+	std::vector<char> chars;
+	if(!read_vector(stream, chars))
+		return false;
+	value.assign(chars.begin(), chars.end());
+	return true;
+}
+
+bool Mesh_Data::save(std::ostream& stream) const {
+	stream.write(mesh_data_magic, sizeof(mesh_data_magic));
+	write_value(stream, mesh_data_version);
+	write_value(stream, num_vertices);
+	write_value(stream, num_uv);
+	write_value(stream, num_col);
+	write_value(stream, bounding_box);
+	write_value(stream, bounding_sphere);
+	write_value(stream, position_decode);
+
+	write_value(stream, (std::uint32_t)streams.size());
+	for(const Vertex_Stream& vertex_stream : streams) {
+		write_string(stream, vertex_stream.name);
+		write_value(stream, vertex_stream.number_elements);
+		write_value(stream, vertex_stream.type);
+		write_value(stream, (std::uint8_t)vertex_stream.normalized);
+		write_value(stream, vertex_stream.size);
+		write_value(stream, vertex_stream.buffer_index);
+		write_value(stream, vertex_stream.stride);
+		write_value(stream, vertex_stream.offset);
+	}
+
+	write_value(stream, (std::uint32_t)buffers.size());
+	for(const auto& buffer : buffers)
+		write_vector(stream, buffer);
+
+	write_vector(stream, indices);
+	write_value(stream, (std::uint32_t)lods.size());
+	for(const Lod& lod : lods) {
+		write_vector(stream, lod.indices);
+		write_value(stream, lod.error);
+	}
+	return (bool)stream;
+}
+
+bool Mesh_Data::load(std::istream& stream) {
+	char magic[sizeof(mesh_data_magic)];
+	std::uint32_t version;
+	if(!stream.read(magic, sizeof(magic)) ||
+	   std::memcmp(magic, mesh_data_magic, sizeof(magic)) != 0 ||
+	   !read_value(stream, version) || version != mesh_data_version) {
+		App::push_error("Error: The stream does not "
+				"contain mesh data");
+		return false;
+	}
+
+	Mesh_Data data;
+	bool ret = read_value(stream, data.num_vertices) &&
+		read_value(stream, data.num_uv) &&
+		read_value(stream, data.num_col) &&
+		read_value(stream, data.bounding_box) &&
+		read_value(stream, data.bounding_sphere) &&
+		read_value(stream, data.position_decode);
+
+	std::uint32_t num_streams = 0;
+	ret = ret && read_value(stream, num_streams);
+	for(std::uint32_t i = 0; ret && i < num_streams; i++) {
+		Vertex_Stream vertex_stream;
+		std::uint8_t normalized;
+		ret = read_string(stream, vertex_stream.name) &&
+			read_value(stream, vertex_stream.number_elements) &&
+			read_value(stream, vertex_stream.type) &&
+			read_value(stream, normalized) &&
+			read_value(stream, vertex_stream.size) &&
+			read_value(stream, vertex_stream.buffer_index) &&
+			read_value(stream, vertex_stream.stride) &&
+			read_value(stream, vertex_stream.offset);
+		vertex_stream.normalized = normalized != 0;
+		data.streams.push_back(vertex_stream);
+	}
+
+	std::uint32_t num_buffers = 0;
+	ret = ret && read_value(stream, num_buffers);
+	for(std::uint32_t i = 0; ret && i < num_buffers; i++) {
+		data.buffers.emplace_back();
+		ret = read_vector(stream, data.buffers.back());
+	}
+
+	ret = ret && read_vector(stream, data.indices);
+	std::uint32_t num_lods = 0;
+	ret = ret && read_value(stream, num_lods);
+	for(std::uint32_t i = 0; ret && i < num_lods; i++) {
+		Lod lod;
+		ret = read_vector(stream, lod.indices) &&
+			read_value(stream, lod.error);
+		data.lods.push_back(std::move(lod));
+	}
+
+	//every stream has to lie within its buffer and every index has to
+	//reference a vertex
+	for(const Vertex_Stream& vertex_stream : data.streams) {
+		if(!ret)
+			break;
+		ret = vertex_stream.buffer_index < data.buffers.size() &&
+			(data.num_vertices == 0 ||
+			 (std::uint64_t)vertex_stream.stride *
+			 (data.num_vertices - 1) + vertex_stream.offset +
+			 vertex_stream.size <=
+			 data.buffers[vertex_stream.buffer_index].size());
+	}
+	for(unsigned int index : data.indices)
+		ret = ret && index < data.num_vertices;
+	for(const Lod& lod : data.lods) {
+		for(unsigned int index : lod.indices)
+			ret = ret && index < data.num_vertices;
+	}
+
+	if(!ret) {
+		App::push_error("Error: The mesh data is "
+				"incomplete or corrupted");
+		return false;
+	}
+	*this = std::move(data);
+	return true;
+}
@@ -0,0 +1,743 @@
+#include <sgltk/mesh_optimizer.h>
+
+#include <limits>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+using namespace sgltk;
+
+//marks vertices without an entry in tables indexed by vertex
+static const unsigned int invalid = std::numeric_limits<unsigned int>::max();
+
+static bool check_indices(const std::vector<unsigned int>& indices,
+			  unsigned int num_vertices) {
+
+	for(unsigned int index : indices) {
+		if(index >= num_vertices) {
+			App::push_error("The indices reference "
+					"more vertices than the "
+					"mesh contains");
+			return false;
+		}
+	}
+	return true;
+}
+
+Vertex_Cache_Statistics Mesh_Optimizer::analyze(const std::vector<unsigned int>& indices,
+						unsigned int num_vertices,
+						unsigned int cache_size) {
+
+	Vertex_Cache_Statistics statistics;
+	if(!check_indices(indices, num_vertices))
+		return statistics;
+
+	//a vertex is in the cache if it was inserted during the
+	//last cache_size misses
+	std::vector<unsigned int> timestamps(num_vertices, 0);
+	std::vector<bool> referenced(num_vertices, false);
+	unsigned int time = cache_size + 1;
+
+	for(unsigned int index : indices) {
+		if(!referenced[index]) {
+			referenced[index] = true;
+			statistics.num_vertices++;
+		}
+		if(time - timestamps[index] > cache_size) {
+			timestamps[index] = time++;
+			statistics.num_transformed++;
+		}
+	}
+	statistics.num_triangles = indices.size() / 3;
+	return statistics;
+}
+
+std::vector<unsigned int> Mesh_Optimizer::optimize_vertex_cache(std::vector<unsigned int>& indices,
+								unsigned int num_vertices,
+								unsigned int cache_size) {
+
+	std::vector<unsigned int> clusters;
+	unsigned int num_triangles = indices.size() / 3;
+	if(num_triangles == 0 || !check_indices(indices, num_vertices))
+		return clusters;
+
+	//the number of triangles that reference a vertex and have not
+	//been emitted yet
+	std::vector<unsigned int> live(num_vertices, 0);
+	for(unsigned int i = 0; i < num_triangles * 3; i++)
+		live[indices[i]]++;
+
+	//the triangles adjacent to each vertex
+	std::vector<unsigned int> offsets(num_vertices + 1, 0);
+	for(unsigned int i = 0; i < num_vertices; i++)
+		offsets[i + 1] = offsets[i] + live[i];
+	std::vector<unsigned int> adjacency(num_triangles * 3);
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for(unsigned int i = 0; i < num_triangles * 3; i++)
+		adjacency[fill[indices[i]]++] = i / 3;
+
+	std::vector<unsigned int> cache_time(num_vertices, 0);
+	std::vector<bool> emitted(num_triangles, false);
+	std::vector<unsigned int> dead_end;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> output;
+	output.reserve(num_triangles * 3);
+	unsigned int time = cache_size + 1;
+	unsigned int cursor = 0;
+
+	//returns a recently used vertex with live triangles or the next
+	//vertex in input order if there is none
+	auto skip_dead_end = [&]() {
+		while(!dead_end.empty()) {
+			unsigned int vertex = dead_end.back();
+			dead_end.pop_back();
+			if(live[vertex] > 0)
+				return vertex;
+		}
+		while(cursor < num_vertices) {
+			if(live[cursor] > 0)
+				return cursor;
+			cursor++;
+		}
+		return invalid;
+	};
+
+	clusters.push_back(0);
+	unsigned int fanning = skip_dead_end();
+	while(fanning != invalid) {
+		candidates.clear();
+		for(unsigned int i = offsets[fanning]; i < offsets[fanning + 1]; i++) {
+			unsigned int triangle = adjacency[i];
+			if(emitted[triangle])
+				continue;
+
+			for(unsigned int j = 0; j < 3; j++) {
+				unsigned int vertex = indices[triangle * 3 + j];
+				output.push_back(vertex);
+				dead_end.push_back(vertex);
+				candidates.push_back(vertex);
+				live[vertex]--;
+				if(time - cache_time[vertex] > cache_size)
+					cache_time[vertex] = time++;
+			}
+			emitted[triangle] = true;
+		}
+
+		//prefer the oldest candidate that stays in the cache while
+		//its remaining triangles are emitted
+		unsigned int next = invalid;
+		int best_priority = -1;
+		for(unsigned int vertex : candidates) {
+			if(live[vertex] == 0)
+				continue;
+
+			int priority = 0;
+			if(time - cache_time[vertex] + 2 * live[vertex] <= cache_size)
+				priority = time - cache_time[vertex];
+			if(priority > best_priority) {
+				best_priority = priority;
+				next = vertex;
+			}
+		}
+
+		if(next == invalid) {
+			next = skip_dead_end();
+			unsigned int emitted_triangles = output.size() / 3;
+			if(next != invalid && emitted_triangles < num_triangles &&
+					clusters.back() != emitted_triangles)
+				clusters.push_back(emitted_triangles);
+		}
+		fanning = next;
+	}
+
+	//keep incomplete triangles at the end
+	output.insert(output.end(), indices.begin() + num_triangles * 3,
+		      indices.end());
+	indices.swap(output);
+	return clusters;
+}
+
+void Mesh_Optimizer::optimize_overdraw(std::vector<unsigned int>& indices,
+				       const std::vector<unsigned int>& clusters,
+				       const glm::vec3 *positions,
+				       unsigned int stride) {
+
+	unsigned int num_triangles = indices.size() / 3;
+	if(clusters.size() < 2 || !positions)
+		return;
+
+	auto position = [&](unsigned int vertex) -> const glm::vec3& {
+		return *(const glm::vec3 *)((const char *)positions +
+					    vertex * stride);
+	};
+
+	struct Cluster {
+		unsigned int start;
+		unsigned int end;
+		glm::vec3 centroid;
+		glm::vec3 normal;
+		float area;
+		float sort_key;
+	};
+	std::vector<Cluster> cluster_data(clusters.size());
+
+	//area weighted centroids and normals of the clusters
+	glm::vec3 mesh_centroid(0);
+	float mesh_area = 0;
+	for(unsigned int i = 0; i < clusters.size(); i++) {
+		Cluster& cluster = cluster_data[i];
+		cluster.start = clusters[i];
+		cluster.end = (i + 1 < clusters.size()) ? clusters[i + 1] : num_triangles;
+		cluster.centroid = glm::vec3(0);
+		cluster.normal = glm::vec3(0);
+		cluster.area = 0;
+		for(unsigned int j = cluster.start; j < cluster.end; j++) {
+			const glm::vec3& a = position(indices[j * 3]);
+			const glm::vec3& b = position(indices[j * 3 + 1]);
+			const glm::vec3& c = position(indices[j * 3 + 2]);
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float area = glm::length(normal) * 0.5f;
+			glm::vec3 centroid = (a + b + c) / 3.0f;
+			cluster.centroid += centroid * area;
+			cluster.normal += normal;
+			cluster.area += area;
+		}
+		mesh_centroid += cluster.centroid;
+		mesh_area += cluster.area;
+		if(cluster.area > 0)
+			cluster.centroid /= cluster.area;
+	}
+	if(mesh_area <= 0)
+		return;
+	mesh_centroid /= mesh_area;
+
+	for(Cluster& cluster : cluster_data) {
+		float length = glm::length(cluster.normal);
+		if(length > 0)
+			cluster.normal /= length;
+		cluster.sort_key = glm::dot(cluster.centroid - mesh_centroid,
+					    cluster.normal);
+	}
+
+	//clusters that point away from the center are likely to occlude
+	//the others
+	std::stable_sort(cluster_data.begin(), cluster_data.end(),
+		[](const Cluster& a, const Cluster& b) {
+			return a.sort_key > b.sort_key;
+		});
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	for(const Cluster& cluster : cluster_data) {
+		output.insert(output.end(), indices.begin() + cluster.start * 3,
+			      indices.begin() + cluster.end * 3);
+	}
+	output.insert(output.end(), indices.begin() + num_triangles * 3,
+		      indices.end());
+	indices.swap(output);
+}
+
+std::vector<unsigned int> Mesh_Optimizer::optimize_vertex_fetch(std::vector<unsigned int>& indices,
+								unsigned int num_vertices) {
+
+	std::vector<unsigned int> remap(num_vertices, invalid);
+	if(!check_indices(indices, num_vertices)) {
+		for(unsigned int i = 0; i < num_vertices; i++)
+			remap[i] = i;
+		return remap;
+	}
+
+	unsigned int next = 0;
+	for(unsigned int& index : indices) {
+		if(remap[index] == invalid)
+			remap[index] = next++;
+		index = remap[index];
+	}
+	for(unsigned int& vertex : remap) {
+		if(vertex == invalid)
+			vertex = next++;
+	}
+	return remap;
+}
+
+//the symmetric 4x4 matrix of a quadric and the accumulated area of the
+//planes it consists of
+struct Quadric {
+	double a00, a01, a02, a03;
+	double a11, a12, a13;
+	double a22, a23;
+	double a33;
+	double weight;
+};
+
+static void add_quadric(Quadric& q, const Quadric& other) {
+	q.a00 += other.a00;
+	q.a01 += other.a01;
+	q.a02 += other.a02;
+	q.a03 += other.a03;
+	q.a11 += other.a11;
+	q.a12 += other.a12;
+	q.a13 += other.a13;
+	q.a22 += other.a22;
+	q.a23 += other.a23;
+	q.a33 += other.a33;
+	q.weight += other.weight;
+}
+
+static void add_plane(Quadric& q, const glm::dvec3& normal, double distance,
+		      double weight) {
+
+	Quadric plane;
+	plane.a00 = weight * normal.x * normal.x;
+	plane.a01 = weight * normal.x * normal.y;
+	plane.a02 = weight * normal.x * normal.z;
+	plane.a03 = weight * normal.x * distance;
+	plane.a11 = weight * normal.y * normal.y;
+	plane.a12 = weight * normal.y * normal.z;
+	plane.a13 = weight * normal.y * distance;
+	plane.a22 = weight * normal.z * normal.z;
+	plane.a23 = weight * normal.z * distance;
+	plane.a33 = weight * distance * distance;
+	plane.weight = weight;
+	add_quadric(q, plane);
+}
+
+//returns the area weighted mean of the squared distances between the
+//point and the planes of the quadric
+static double evaluate_quadric(const Quadric& q, const glm::vec3& point) {
+	double x = point.x;
+	double y = point.y;
+	double z = point.z;
+	double error = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z +
+		2 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+		2 * (q.a03 * x + q.a13 * y + q.a23 * z) + q.a33;
+	if(q.weight <= 0)
+		return 0;
+	return std::fabs(error) / q.weight;
+}
+
+std::vector<unsigned int> Mesh_Optimizer::simplify(const std::vector<unsigned int>& indices,
+						   unsigned int num_vertices,
+						   const glm::vec3 *positions,
+						   unsigned int stride,
+						   unsigned int target_index_count,
+						   float *error) {
+
+	if(error)
+		*error = 0;
+
+	std::vector<unsigned int> result;
+	if(!positions || !check_indices(indices, num_vertices))
+		return indices;
+
+	auto position = [&](unsigned int vertex) -> const glm::vec3& {
+		return *(const glm::vec3 *)((const char *)positions +
+					    vertex * stride);
+	};
+
+	//drop incomplete and degenerate triangles
+	result.reserve(indices.size());
+	for(unsigned int i = 0; i + 2 < indices.size(); i += 3) {
+		unsigned int a = indices[i];
+		unsigned int b = indices[i + 1];
+		unsigned int c = indices[i + 2];
+		if(a == b || b == c || c == a)
+			continue;
+		result.push_back(a);
+		result.push_back(b);
+		result.push_back(c);
+	}
+
+	//vertices that share a position belong to the same corner of the
+	//surface
+	std::vector<unsigned int> corner(num_vertices);
+	std::vector<unsigned int> num_copies(num_vertices, 0);
+	std::map<std::tuple<float, float, float>, unsigned int> corner_map;
+	for(unsigned int i = 0; i < num_vertices; i++) {
+		const glm::vec3& p = position(i);
+		auto entry = corner_map.insert({std::make_tuple(p.x, p.y, p.z), i});
+		corner[i] = entry.first->second;
+		num_copies[corner[i]]++;
+	}
+
+	//edges that belong to a single triangle form the border and edges
+	//that belong to more than two are not manifold
+	std::unordered_map<unsigned long long, unsigned int> edge_count;
+	for(unsigned int i = 0; i < result.size(); i += 3) {
+		for(unsigned int j = 0; j < 3; j++) {
+			unsigned long long a = corner[result[i + j]];
+			unsigned long long b = corner[result[i + (j + 1) % 3]];
+			edge_count[(std::min(a, b) << 32) | std::max(a, b)]++;
+		}
+	}
+	std::vector<bool> locked(num_vertices, false);
+	for(const auto& edge : edge_count) {
+		if(edge.second == 2)
+			continue;
+		locked[edge.first >> 32] = true;
+		locked[edge.first & 0xFFFFFFFF] = true;
+	}
+	for(unsigned int i = 0; i < num_vertices; i++) {
+		if(num_copies[corner[i]] > 1 || locked[corner[i]])
+			locked[i] = true;
+	}
+
+	std::vector<Quadric> quadrics(num_vertices, Quadric());
+	for(unsigned int i = 0; i < result.size(); i += 3) {
+		const glm::vec3& a = position(result[i]);
+		const glm::vec3& b = position(result[i + 1]);
+		const glm::vec3& c = position(result[i + 2]);
+		glm::dvec3 normal = glm::cross(glm::dvec3(b - a),
+					       glm::dvec3(c - a));
+		double length = glm::length(normal);
+		if(length <= 0)
+			continue;
+		normal /= length;
+		double distance = -glm::dot(normal, glm::dvec3(a));
+		for(unsigned int j = 0; j < 3; j++) {
+			add_plane(quadrics[corner[result[i + j]]], normal,
+				  distance, length * 0.5);
+		}
+	}
+
+	double max_error = 0;
+	std::vector<unsigned int> offsets(num_vertices + 1);
+	std::vector<unsigned int> adjacency;
+	std::vector<unsigned int> remap(num_vertices);
+	std::vector<bool> touched(num_vertices);
+	std::vector<double> best_cost(num_vertices);
+	std::vector<unsigned int> best_target(num_vertices);
+	std::vector<unsigned int> candidates;
+
+	while(result.size() > target_index_count) {
+		unsigned int num_triangles = result.size() / 3;
+
+		//the triangles adjacent to each vertex
+		std::fill(offsets.begin(), offsets.end(), 0);
+		for(unsigned int index : result)
+			offsets[index + 1]++;
+		for(unsigned int i = 0; i < num_vertices; i++)
+			offsets[i + 1] += offsets[i];
+		adjacency.resize(result.size());
+		std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+		for(unsigned int i = 0; i < result.size(); i++)
+			adjacency[fill[result[i]]++] = i / 3;
+
+		//the cheapest collapse of every vertex
+		std::fill(best_cost.begin(), best_cost.end(),
+			  std::numeric_limits<double>::max());
+		for(unsigned int i = 0; i < result.size(); i += 3) {
+			for(unsigned int j = 0; j < 3; j++) {
+				for(unsigned int k = 1; k < 3; k++) {
+					unsigned int source = result[i + j];
+					unsigned int target = result[i + (j + k) % 3];
+					if(locked[source])
+						continue;
+
+					Quadric q = quadrics[corner[source]];
+					add_quadric(q, quadrics[corner[target]]);
+					double cost = evaluate_quadric(q, position(target));
+					if(cost < best_cost[source]) {
+						best_cost[source] = cost;
+						best_target[source] = target;
+					}
+				}
+			}
+		}
+		candidates.clear();
+		for(unsigned int i = 0; i < num_vertices; i++) {
+			if(best_cost[i] < std::numeric_limits<double>::max())
+				candidates.push_back(i);
+		}
+		std::sort(candidates.begin(), candidates.end(),
+			[&](unsigned int a, unsigned int b) {
+				return best_cost[a] < best_cost[b];
+			});
+
+		for(unsigned int i = 0; i < num_vertices; i++)
+			remap[i] = i;
+		std::fill(touched.begin(), touched.end(), false);
+		unsigned int removed = 0;
+		unsigned int target_triangles = target_index_count / 3;
+		for(unsigned int source : candidates) {
+			if(num_triangles - removed <= target_triangles)
+				break;
+
+			unsigned int target = best_target[source];
+			if(touched[source] || touched[target])
+				continue;
+
+			//reject collapses that flip triangles or turn
+			//them by more than about 75 degrees
+			bool flipped = false;
+			unsigned int collapsed = 0;
+			for(unsigned int j = offsets[source]; j < offsets[source + 1]; j++) {
+				const unsigned int *triangle = &result[adjacency[j] * 3];
+				if(triangle[0] == target || triangle[1] == target ||
+						triangle[2] == target) {
+					collapsed++;
+					continue;
+				}
+
+				glm::vec3 before[3], after[3];
+				for(unsigned int k = 0; k < 3; k++) {
+					before[k] = position(triangle[k]);
+					after[k] = position(triangle[k] == source ?
+							    target : triangle[k]);
+				}
+				glm::vec3 normal_before = glm::cross(before[1] - before[0],
+								     before[2] - before[0]);
+				glm::vec3 normal_after = glm::cross(after[1] - after[0],
+								    after[2] - after[0]);
+				if(glm::dot(normal_before, normal_after) <=
+						0.25f * glm::length(normal_before) *
+						glm::length(normal_after)) {
+					flipped = true;
+					break;
+				}
+			}
+			if(flipped)
+				continue;
+
+			//the neighborhood of the collapse is fixed for the
+			//rest of the pass
+			for(unsigned int j = offsets[source]; j < offsets[source + 1]; j++) {
+				for(unsigned int k = 0; k < 3; k++)
+					touched[result[adjacency[j] * 3 + k]] = true;
+			}
+			remap[source] = target;
+			add_quadric(quadrics[corner[target]], quadrics[corner[source]]);
+			max_error = std::max(max_error, best_cost[source]);
+			removed += collapsed;
+		}
+		if(removed == 0)
+			break;
+
+		unsigned int size = 0;
+		for(unsigned int i = 0; i < result.size(); i += 3) {
+			unsigned int a = remap[result[i]];
+			unsigned int b = remap[result[i + 1]];
+			unsigned int c = remap[result[i + 2]];
+			if(a == b || b == c || c == a)
+				continue;
+			result[size++] = a;
+			result[size++] = b;
+			result[size++] = c;
+		}
+		result.resize(size);
+	}
+
+	if(error)
+		*error = (float)std::sqrt(max_error);
+	return result;
+}
+
+static void compute_cluster_bounds(Mesh_Cluster& cluster,
+				   const std::vector<unsigned int>& indices,
+				   const glm::vec3 *positions,
+				   unsigned int stride) {
+
+	auto position = [&](unsigned int vertex) -> const glm::vec3& {
+		return *(const glm::vec3 *)((const char *)positions +
+					    vertex * stride);
+	};
+	unsigned int first = cluster.first_index;
+	unsigned int last = cluster.first_index + cluster.num_indices;
+
+	//Ritter's bounding sphere
+	const glm::vec3& start = position(indices[first]);
+	glm::vec3 a = start;
+	glm::vec3 b = start;
+	for(unsigned int i = first; i < last; i++) {
+		const glm::vec3& p = position(indices[i]);
+		if(glm::dot(p - start, p - start) > glm::dot(a - start, a - start))
+			a = p;
+	}
+	for(unsigned int i = first; i < last; i++) {
+		const glm::vec3& p = position(indices[i]);
+		if(glm::dot(p - a, p - a) > glm::dot(b - a, b - a))
+			b = p;
+	}
+	glm::vec3 center = 0.5f * (a + b);
+	float radius = 0.5f * glm::length(b - a);
+	for(unsigned int i = first; i < last; i++) {
+		const glm::vec3& p = position(indices[i]);
+		float distance = glm::length(p - center);
+		if(distance > radius) {
+			float new_radius = 0.5f * (radius + distance);
+			center += (p - center) * ((new_radius - radius) / distance);
+			radius = new_radius;
+		}
+	}
+	cluster.center = center;
+	cluster.radius = radius;
+
+	//the cone that contains the normals of all triangles
+	std::vector<glm::vec3> normals;
+	glm::vec3 axis(0);
+	for(unsigned int i = first; i + 2 < last; i += 3) {
+		const glm::vec3& p0 = position(indices[i]);
+		const glm::vec3& p1 = position(indices[i + 1]);
+		const glm::vec3& p2 = position(indices[i + 2]);
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		normals.push_back(length > 0 ? normal / length : glm::vec3(0));
+		axis += normals.back();
+	}
+	cluster.cone_axis = glm::vec3(0);
+	cluster.cone_cutoff = 1;
+	cluster.cone_apex = center;
+
+	float length = glm::length(axis);
+	if(length <= 0)
+		return;
+	axis /= length;
+
+	float min_dot = 1;
+	for(const glm::vec3& normal : normals)
+		min_dot = std::min(min_dot, glm::dot(normal, axis));
+	//the normals span more than a hemisphere
+	if(min_dot <= 0)
+		return;
+
+	//move the apex back until it lies behind every triangle plane
+	float max_t = 0;
+	for(unsigned int i = 0; i < normals.size(); i++) {
+		const glm::vec3& p0 = position(indices[first + i * 3]);
+		float dn = glm::dot(normals[i], axis);
+		if(dn <= 0)
+			continue;
+		float t = glm::dot(center - p0, normals[i]) / dn;
+		max_t = std::max(max_t, t);
+	}
+	cluster.cone_axis = axis;
+	cluster.cone_cutoff = std::sqrt(1 - min_dot * min_dot);
+	cluster.cone_apex = center - axis * max_t;
+}
+
+std::vector<Mesh_Cluster> Mesh_Optimizer::build_clusters(std::vector<unsigned int>& indices,
+							 unsigned int num_vertices,
+							 const glm::vec3 *positions,
+							 unsigned int stride,
+							 unsigned int max_vertices,
+							 unsigned int max_triangles) {
+
+	std::vector<Mesh_Cluster> clusters;
+	unsigned int num_triangles = indices.size() / 3;
+	if(num_triangles == 0 || !positions || max_vertices < 3 ||
+	   max_triangles == 0 || !check_indices(indices, num_vertices))
+		return clusters;
+
+	auto position = [&](unsigned int vertex) -> const glm::vec3& {
+		return *(const glm::vec3 *)((const char *)positions +
+					    vertex * stride);
+	};
+
+	//the triangles adjacent to each vertex
+	std::vector<unsigned int> offsets(num_vertices + 1, 0);
+	for(unsigned int i = 0; i < num_triangles * 3; i++)
+		offsets[indices[i] + 1]++;
+	for(unsigned int i = 0; i < num_vertices; i++)
+		offsets[i + 1] += offsets[i];
+	std::vector<unsigned int> adjacency(num_triangles * 3);
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for(unsigned int i = 0; i < num_triangles * 3; i++)
+		adjacency[fill[indices[i]]++] = i / 3;
+
+	//the cluster a vertex or candidate triangle was last added to
+	std::vector<unsigned int> vertex_cluster(num_vertices, invalid);
+	std::vector<unsigned int> candidate_cluster(num_triangles, invalid);
+	std::vector<bool> assigned(num_triangles, false);
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	unsigned int cursor = 0;
+
+	while(true) {
+		while(cursor < num_triangles && assigned[cursor])
+			cursor++;
+		if(cursor == num_triangles)
+			break;
+
+		unsigned int id = clusters.size();
+		Mesh_Cluster cluster = Mesh_Cluster();
+		cluster.first_index = output.size();
+		unsigned int cluster_vertices = 0;
+		unsigned int cluster_triangles = 0;
+		glm::vec3 centroid_sum(0);
+		candidates.clear();
+
+		unsigned int next = cursor;
+		while(next != invalid) {
+			assigned[next] = true;
+			cluster_triangles++;
+			for(unsigned int j = 0; j < 3; j++) {
+				unsigned int vertex = indices[next * 3 + j];
+				output.push_back(vertex);
+				centroid_sum += position(vertex);
+				if(vertex_cluster[vertex] == id)
+					continue;
+
+				vertex_cluster[vertex] = id;
+				cluster_vertices++;
+				for(unsigned int k = offsets[vertex]; k < offsets[vertex + 1]; k++) {
+					unsigned int triangle = adjacency[k];
+					if(assigned[triangle] ||
+					   candidate_cluster[triangle] == id)
+						continue;
+					candidate_cluster[triangle] = id;
+					candidates.push_back(triangle);
+				}
+			}
+			if(cluster_triangles == max_triangles)
+				break;
+
+			//prefer triangles that add few vertices and stay close
+			//to the center of the cluster
+			glm::vec3 centroid = centroid_sum / (3.0f * cluster_triangles);
+			unsigned int best_new_vertices = 4;
+			float best_distance = std::numeric_limits<float>::max();
+			next = invalid;
+			for(unsigned int i = 0; i < candidates.size();) {
+				unsigned int triangle = candidates[i];
+				if(assigned[triangle]) {
+					candidates[i] = candidates.back();
+					candidates.pop_back();
+					continue;
+				}
+				i++;
+
+				unsigned int new_vertices = 0;
+				glm::vec3 triangle_centroid(0);
+				for(unsigned int j = 0; j < 3; j++) {
+					unsigned int vertex = indices[triangle * 3 + j];
+					if(vertex_cluster[vertex] != id)
+						new_vertices++;
+					triangle_centroid += position(vertex);
+				}
+				if(cluster_vertices + new_vertices > max_vertices)
+					continue;
+
+				glm::vec3 d = triangle_centroid / 3.0f - centroid;
+				float distance = glm::dot(d, d);
+				if(new_vertices < best_new_vertices ||
+				   (new_vertices == best_new_vertices &&
+				    distance < best_distance)) {
+					best_new_vertices = new_vertices;
+					best_distance = distance;
+					next = triangle;
+				}
+			}
+		}
+
+		cluster.num_indices = output.size() - cluster.first_index;
+		compute_cluster_bounds(cluster, output, positions, stride);
+		clusters.push_back(cluster);
+	}
+
+	//keep incomplete triangles at the end
+	output.insert(output.end(), indices.begin() + num_triangles * 3,
+		      indices.end());
+	indices.swap(output);
+	return clusters;
+}
@@ -1,5 +1,7 @@
 #include <sgltk/model.h>
 
+#include <limits>
+
 #ifdef assimp_FOUND
 
 using namespace sgltk;
@@ -12,6 +14,11 @@ Model::Model() {
 
 	view_matrix = nullptr;
 	projection_matrix = nullptr;
+	camera_frustum = nullptr;
+	frustum_culling = true;
+	num_culled = 0;
+	num_visible = 0;
+	generate_bvh = false;
 
 	position_name = "pos_in";
 	normal_name = "norm_in";
@@ -22,14 +29,25 @@ Model::Model() {
 	bone_weights_name = "bone_weights_in";
 	bone_array_name = "bone_array";
 
-	model_matrix_buf = -1;
-	normal_matrix_buf = -1;
+	vertex_heap = nullptr;
+	index_heap = nullptr;
+	packed = false;
+	interleaved = false;
+	compression = Vertex_Compression(false);
+	optimize_meshes = false;
+	vertex_cache_size = 16;
+	num_lods = 0;
+	lod_ratio = 0.5f;
+	lod_threshold = 0;
 
 	bounding_box = {glm::vec3(0, 0, 0), glm::vec3(0, 0, 0)};
+	bounding_sphere = {glm::vec3(0, 0, 0), 0};
 }
 
 Model::~Model() {
-	bounding_box.clear();
+	for(auto& range : heap_ranges) {
+		range.first->free(range.second);
+	}
 	bone_offsets.clear();
 	bones.clear();
 	bone_map.clear();
@@ -72,30 +90,285 @@ bool Model::load(const std::string& filename) {
 
 	glob_inv_transf = glm::inverse(ai_to_glm_mat4(scene->mRootNode->mTransformation));
 
+	//attribute the buffers and textures of the model to its file
+	Memory_Owner owner(filename);
 	traverse_scene_nodes(scene->mRootNode, nullptr);
+	if(packed)
+		pack_meshes();
 	compute_bounding_box();
+	build_bvh();
 	set_animation_speed(1.0);
 	animate(0.0f);
 	return true;
 }
 
+void Model::set_buffer_heap(Buffer_Heap *vertex_heap, Buffer_Heap *index_heap) {
+	this->vertex_heap = vertex_heap;
+	this->index_heap = index_heap;
+}
+
+void Model::set_mesh_packing(bool enable) {
+	packed = enable;
+}
+
+void Model::set_interleaved(bool interleaved) {
+	this->interleaved = interleaved;
+}
+
+void Model::set_vertex_compression(const Vertex_Compression& compression) {
+	this->compression = compression;
+}
+
+void Model::set_mesh_optimization(bool optimize, unsigned int cache_size) {
+	optimize_meshes = optimize;
+	vertex_cache_size = cache_size;
+}
+
+const Vertex_Cache_Report& Model::get_optimization_report() {
+	return optimization_report;
+}
+
+void Model::set_lod_generation(unsigned int num_levels, float ratio) {
+	num_lods = num_levels;
+	lod_ratio = ratio;
+}
+
+void Model::set_lod_threshold(float threshold) {
+	lod_threshold = threshold;
+}
+
+void Model::set_frustum_culling(bool enable) {
+	frustum_culling = enable;
+}
+
+unsigned int Model::get_num_culled_meshes() {
+	return num_culled;
+}
+
+unsigned int Model::get_num_visible_meshes() {
+	return num_visible;
+}
+
+void Model::set_bvh_generation(bool enable) {
+	generate_bvh = enable;
+}
+
+void Model::cull_meshes() {
+	cull_visible.assign(cull_spheres.size(), 1);
+	num_culled = 0;
+	num_visible = cull_spheres.size();
+	if(!frustum_culling || !view_matrix || !projection_matrix)
+		return;
+
+	//cameras keep their frustum up to date, the planes only have to be
+	//extracted when the model was set up with raw matrices
+	Frustum frustum;
+	if(camera_frustum)
+		frustum = *camera_frustum;
+	else
+		frustum.update((*projection_matrix) * (*view_matrix));
+
+	num_visible = frustum.intersects(cull_spheres.data(),
+					 cull_spheres.size(),
+					 cull_visible.data());
+	num_culled = cull_spheres.size() - num_visible;
+}
+
 void Model::compute_bounding_box() {
 	for(unsigned int i = 0; i < meshes.size(); i++) {
-		glm::vec3 min = meshes[i]->bounding_box[0];
-		glm::vec3 max = meshes[i]->bounding_box[1];
-		if(min.x < bounding_box[0].x)
-			bounding_box[0].x = min.x;
-		if(min.y < bounding_box[0].y)
-			bounding_box[0].y = min.y;
-		if(min.z < bounding_box[0].z)
-			bounding_box[0].z = min.z;
-		if(max.x > bounding_box[1].x)
-			bounding_box[1].x = max.x;
-		if(max.y > bounding_box[1].y)
-			bounding_box[1].y = max.y;
-		if(max.z > bounding_box[1].z)
-			bounding_box[1].z = max.z;
+		const glm::mat4& matrix = meshes[i]->model_matrix;
+		AABB box = Bounds::transform(meshes[i]->bounding_box, matrix);
+		Sphere sphere = Bounds::transform(meshes[i]->bounding_sphere,
+						  matrix);
+		if(i == 0) {
+			bounding_box = box;
+			bounding_sphere = sphere;
+		} else {
+			bounding_box = Bounds::merge(bounding_box, box);
+			bounding_sphere = Bounds::merge(bounding_sphere, sphere);
+		}
+	}
+}
+
+void Model::build_bvh() {
+	mesh_bounds.resize(meshes.size());
+	for(unsigned int i = 0; i < meshes.size(); i++) {
+		mesh_bounds[i] = Bounds::transform(meshes[i]->bounding_box,
+						   meshes[i]->model_matrix);
+	}
+	//models rarely have enough meshes to make threads worthwhile
+	mesh_bvh.build(mesh_bounds, 1, 1);
+}
+
+void Model::refit_bvh() {
+	if(mesh_bvh.empty())
+		return;
+
+	for(unsigned int i = 0; i < meshes.size(); i++) {
+		mesh_bounds[i] = Bounds::transform(meshes[i]->bounding_box,
+						   meshes[i]->model_matrix);
+	}
+	mesh_bvh.refit(mesh_bounds);
+}
+
+//returns the vertices of a triangle transformed by a model matrix
+static void get_triangle(const Triangle_BVH& bvh, unsigned int triangle,
+			 const glm::mat4& matrix, glm::vec3 *vertices) {
+	for(unsigned int i = 0; i < 3; i++) {
+		glm::vec3 v = bvh.positions[bvh.indices[3 * triangle + i]];
+		vertices[i] = glm::vec3(matrix * glm::vec4(v, 1));
+	}
+}
+
+bool Model::raycast(const glm::vec3& origin,
+		    const glm::vec3& direction,
+		    Ray_Hit& hit,
+		    float max_distance,
+		    const glm::mat4 *model_matrix) {
+
+	glm::vec3 ray_origin = origin;
+	glm::vec3 ray_direction = direction;
+	if(model_matrix) {
+		glm::mat4 inverse = glm::inverse(*model_matrix);
+		ray_origin = glm::vec3(inverse * glm::vec4(origin, 1));
+		ray_direction = glm::vec3(inverse * glm::vec4(direction, 0));
 	}
+
+	glm::vec3 inverse_direction = 1.0f / ray_direction;
+	float closest = max_distance;
+	bool found = false;
+	Ray_Hit mesh_hit;
+	mesh_bvh.traverse([&](const AABB& box) {
+		float distance;
+		return BVH::intersect_ray(box, ray_origin, inverse_direction,
+					  closest, distance);
+	}, [&](unsigned int i) {
+		if(meshes[i]->raycast(ray_origin, ray_direction, mesh_hit,
+				      closest)) {
+			closest = mesh_hit.distance;
+			hit = mesh_hit;
+			hit.mesh = i;
+			found = true;
+		}
+		return true;
+	});
+	return found;
+}
+
+bool Model::intersects_segment(const glm::vec3& start,
+			       const glm::vec3& end) {
+
+	glm::vec3 inverse_direction = 1.0f / (end - start);
+	bool found = false;
+	mesh_bvh.traverse([&](const AABB& box) {
+		float distance;
+		return BVH::intersect_ray(box, start, inverse_direction, 1,
+					  distance);
+	}, [&](unsigned int i) {
+		const Triangle_BVH *bvh = meshes[i]->get_bvh();
+		if(!bvh)
+			return true;
+		glm::mat4 inverse = glm::inverse(meshes[i]->model_matrix);
+		found = bvh->intersects_segment(glm::vec3(inverse * glm::vec4(start, 1)),
+						glm::vec3(inverse * glm::vec4(end, 1)));
+		return !found;
+	});
+	return found;
+}
+
+void Model::overlap_sphere(const Sphere& sphere,
+			   std::vector<Mesh_Triangle>& triangles) {
+
+	float radius2 = sphere.radius * sphere.radius;
+	std::vector<unsigned int> candidates;
+	mesh_bvh.traverse([&](const AABB& box) {
+		glm::vec3 d = glm::max(glm::max(box.min - sphere.center,
+						sphere.center - box.max),
+				       glm::vec3(0));
+		return glm::dot(d, d) <= radius2;
+	}, [&](unsigned int i) {
+		const Triangle_BVH *bvh = meshes[i]->get_bvh();
+		if(!bvh)
+			return true;
+
+		//the sphere becomes an ellipsoid in the coordinate system of
+		//the mesh, query its bounding sphere and test the candidates
+		//in the coordinate system of the model
+		const glm::mat4& matrix = meshes[i]->model_matrix;
+		candidates.clear();
+		bvh->overlap_sphere(Bounds::transform(sphere, glm::inverse(matrix)),
+				    candidates);
+		for(unsigned int triangle : candidates) {
+			glm::vec3 v[3];
+			get_triangle(*bvh, triangle, matrix, v);
+			glm::vec3 d = Triangle_BVH::closest_point_on_triangle(
+				sphere.center, v[0], v[1], v[2]) - sphere.center;
+			if(glm::dot(d, d) <= radius2)
+				triangles.push_back({i, triangle});
+		}
+		return true;
+	});
+}
+
+void Model::overlap_frustum(const glm::mat4& matrix,
+			    std::vector<Mesh_Triangle>& triangles) {
+
+	Frustum frustum(matrix);
+	std::vector<unsigned int> candidates;
+	mesh_bvh.traverse([&](const AABB& box) {
+		return frustum.intersects(box);
+	}, [&](unsigned int i) {
+		const Triangle_BVH *bvh = meshes[i]->get_bvh();
+		if(!bvh)
+			return true;
+
+		candidates.clear();
+		bvh->overlap_frustum(Frustum(matrix * meshes[i]->model_matrix),
+				     candidates);
+		for(unsigned int triangle : candidates)
+			triangles.push_back({i, triangle});
+		return true;
+	});
+}
+
+bool Model::nearest_point(const glm::vec3& point,
+			  float max_distance,
+			  glm::vec3& closest,
+			  Mesh_Triangle& triangle) {
+
+	float best = max_distance;
+	bool found = false;
+	std::vector<unsigned int> candidates;
+	mesh_bvh.traverse([&](const AABB& box) {
+		glm::vec3 d = glm::max(glm::max(box.min - point, point - box.max),
+				       glm::vec3(0));
+		return glm::dot(d, d) <= best * best;
+	}, [&](unsigned int i) {
+		const Triangle_BVH *bvh = meshes[i]->get_bvh();
+		if(!bvh)
+			return true;
+
+		const glm::mat4& matrix = meshes[i]->model_matrix;
+		candidates.clear();
+		bvh->overlap_sphere(Bounds::transform(Sphere{point, best},
+						      glm::inverse(matrix)),
+				    candidates);
+		for(unsigned int j : candidates) {
+			glm::vec3 v[3];
+			get_triangle(*bvh, j, matrix, v);
+			glm::vec3 p = Triangle_BVH::closest_point_on_triangle(
+				point, v[0], v[1], v[2]);
+			float distance = glm::length(p - point);
+			if(distance <= best) {
+				best = distance;
+				closest = p;
+				triangle = {i, j};
+				found = true;
+			}
+		}
+		return true;
+	});
+	return found;
 }
 
 bool Model::setup_camera(glm::mat4 *view_matrix,
@@ -108,6 +381,7 @@ bool Model::setup_camera(glm::mat4 *view_matrix,
 	}
 	this->view_matrix = view_matrix;
 	this->projection_matrix = projection_matrix;
+	camera_frustum = nullptr;
 	return true;
 }
 
@@ -120,6 +394,7 @@ bool Model::setup_camera(Camera *camera) {
 	}
 	view_matrix = &camera->view_matrix;
 	projection_matrix = &camera->projection_matrix;
+	camera_frustum = &camera->frustum;
 	return true;
 }
 
@@ -181,6 +456,12 @@ void sgltk::Model::set_bone_array_name(const std::string& name) {
 
 void Model::setup_shader(Shader *shader) {
 	this->shader = shader;
+	//the meshes owning the shared vertex arrays set the attribute
+	//pointers of the packed meshes
+	for(Packed_Group& group : packed_groups) {
+		group.mesh->setup_shader(shader);
+		set_vertex_attribute(group.mesh);
+	}
 	for(std::unique_ptr<Mesh>& mesh : meshes) {
 		mesh->setup_shader(shader);
 		set_vertex_attribute(mesh);
@@ -188,28 +469,11 @@ void Model::setup_shader(Shader *shader) {
 }
 
 void Model::set_vertex_attribute(std::unique_ptr<Mesh>& mesh) {
-	unsigned int buf = 0;
-	mesh->set_vertex_attribute(position_name, buf++, 4, GL_FLOAT, 0, 0);
-	mesh->set_vertex_attribute(normal_name, buf++, 3, GL_FLOAT, 0, 0);
-	mesh->set_vertex_attribute(tangent_name, buf++, 4, GL_FLOAT, 0, 0);
-	mesh->set_vertex_attribute(bone_ids_name, buf++, BONES_PER_VERTEX, GL_INT, 0, 0);
-	mesh->set_vertex_attribute(bone_weights_name, buf++, BONES_PER_VERTEX, GL_FLOAT, 0, 0);
+	auto layout = vertex_layouts.find(mesh.get());
+	if(layout == vertex_layouts.end())
+		return;
 
-	if(mesh->num_uv) {
-		for(unsigned int i = 0; i < mesh->num_uv; i++) {
-			mesh->set_vertex_attribute(
-				texture_coordinates_name + std::to_string(i),
-				buf++, 3, GL_FLOAT, 0,
-				(void *)(long)(i * mesh->num_vertices));
-		}
-	}
-	if(mesh->num_col) {
-		for(unsigned int i = 0; i < mesh->num_col; i++) {
-			mesh->set_vertex_attribute(
-				color_name + std::to_string(i), buf++, 4, GL_FLOAT, 0,
-				(void *)(long)(i * mesh->num_vertices));
-		}
-	}
+	mesh->set_vertex_attributes(layout->second);
 }
 
 void Model::traverse_scene_nodes(aiNode *start_node, aiMatrix4x4 *parent_trafo) {
@@ -235,7 +499,7 @@ void Model::traverse_scene_nodes(aiNode *start_node, aiMatrix4x4 *parent_trafo)
 	}
 }
 
-std::unique_ptr<Mesh> Model::create_mesh(unsigned int index) {
+void Model::create_mesh_data(unsigned int index, Mesh_Data& data) {
 	aiMesh *mesh = scene->mMeshes[index];
 	unsigned int num_uv = mesh->GetNumUVChannels();
 	unsigned int num_col = mesh->GetNumColorChannels();
@@ -281,7 +545,13 @@ std::unique_ptr<Mesh> Model::create_mesh(unsigned int index) {
 			tangent[i][0] = mesh->mTangents[i].x;
 			tangent[i][1] = mesh->mTangents[i].y;
 			tangent[i][2] = mesh->mTangents[i].z;
-			tangent[i][3] = 1;
+			//the sign of the bitangent, which can be derived from
+			//the normal and the tangent
+			glm::vec3 bitangent(mesh->mBitangents[i].x,
+					    mesh->mBitangents[i].y,
+					    mesh->mBitangents[i].z);
+			glm::vec3 derived = glm::cross(normal[i], glm::vec3(tangent[i]));
+			tangent[i][3] = (glm::dot(derived, bitangent) < 0) ? -1.0f : 1.0f;
 		}
 
 		//color
@@ -334,30 +604,232 @@ std::unique_ptr<Mesh> Model::create_mesh(unsigned int index) {
 		}
 	}
 
+	if(optimize_meshes) {
+		unsigned int num_vertices = mesh->mNumVertices;
+		Vertex_Cache_Statistics before = Mesh_Optimizer::analyze(indices,
+			num_vertices, vertex_cache_size);
+		std::vector<unsigned int> clusters =
+			Mesh_Optimizer::optimize_vertex_cache(indices,
+				num_vertices, vertex_cache_size);
+		Mesh_Optimizer::optimize_overdraw(indices, clusters,
+			(const glm::vec3 *)position.data(), sizeof(glm::vec4));
+		optimization_report.before.add(before);
+		optimization_report.after.add(Mesh_Optimizer::analyze(indices,
+			num_vertices, vertex_cache_size));
+
+		//store the vertices in the order they are first used
+		std::vector<unsigned int> remap =
+			Mesh_Optimizer::optimize_vertex_fetch(indices,
+							      num_vertices);
+		Mesh_Optimizer::remap(position, remap);
+		Mesh_Optimizer::remap(normal, remap);
+		Mesh_Optimizer::remap(tangent, remap);
+		Mesh_Optimizer::remap(bone_ids, remap, BONES_PER_VERTEX);
+		Mesh_Optimizer::remap(bone_weights, remap, BONES_PER_VERTEX);
+		for(auto& channel : tex_coord)
+			Mesh_Optimizer::remap(channel, remap);
+		for(auto& channel : col)
+			Mesh_Optimizer::remap(channel, remap);
+	}
+
+	data.num_vertices = mesh->mNumVertices;
+	data.num_uv = num_uv;
+	data.num_col = num_col;
+
+	//simplify the mesh while the positions are still uncompressed
+	unsigned int lod_target = indices.size();
+	for(unsigned int i = 0; i < num_lods; i++) {
+		lod_target = (unsigned int)(lod_target * lod_ratio);
+		float error;
+		std::vector<unsigned int> lod =
+			Mesh_Optimizer::simplify(indices, mesh->mNumVertices,
+				(const glm::vec3 *)position.data(),
+				sizeof(glm::vec4), lod_target, &error);
+		unsigned int previous = data.lods.empty() ? indices.size() :
+			data.lods.back().indices.size();
+		if(lod.empty() || lod.size() >= previous)
+			break;
+
+		if(optimize_meshes) {
+			Mesh_Optimizer::optimize_vertex_cache(lod,
+				mesh->mNumVertices, vertex_cache_size);
+		}
+		data.lods.push_back({std::move(lod), error});
+	}
+
+	data.indices = std::move(indices);
+	data.compute_bounds((const glm::vec3 *)position.data(),
+			    sizeof(glm::vec4));
+	if(generate_bvh) {
+		data.build_bvh((const glm::vec3 *)position.data(),
+			       sizeof(glm::vec4));
+	}
+
+	if(compression.position) {
+		//quantize relative to the bounding box and let the mesh
+		//undo it with the position decode matrix
+		glm::vec3 min = data.bounding_box[0];
+		glm::vec3 extent = data.bounding_box[1] - min;
+		for(unsigned int i = 0; i < 3; i++) {
+			if(extent[i] <= 0)
+				extent[i] = 1;
+		}
+		std::vector<uint64_t> packed_position(mesh->mNumVertices);
+		for(unsigned int i = 0; i < mesh->mNumVertices; i++) {
+			glm::vec3 pos = (glm::vec3(position[i]) - min) / extent;
+			packed_position[i] = glm::packUnorm4x16(glm::vec4(pos, 1));
+		}
+		glm::mat4 decode(1);
+		decode[0][0] = extent.x;
+		decode[1][1] = extent.y;
+		decode[2][2] = extent.z;
+		decode[3] = glm::vec4(min, 1);
+		data.position_decode = decode;
+		data.add_stream(position_name, 4, GL_UNSIGNED_SHORT, true,
+				sizeof(uint64_t), packed_position.data());
+	} else {
+		data.add_stream(position_name, 4, GL_FLOAT, false,
+				sizeof(glm::vec4), position.data());
+	}
+
+	if(compression.normal) {
+		std::vector<uint32_t> packed_normal(mesh->mNumVertices);
+		std::vector<uint32_t> packed_tangent(mesh->mNumVertices);
+		for(unsigned int i = 0; i < mesh->mNumVertices; i++) {
+			packed_normal[i] = glm::packSnorm3x10_1x2(glm::vec4(normal[i], 0));
+			packed_tangent[i] = glm::packSnorm3x10_1x2(tangent[i]);
+		}
+		data.add_stream(normal_name, 4, GL_INT_2_10_10_10_REV, true,
+				sizeof(uint32_t), packed_normal.data());
+		data.add_stream(tangent_name, 4, GL_INT_2_10_10_10_REV, true,
+				sizeof(uint32_t), packed_tangent.data());
+	} else {
+		data.add_stream(normal_name, 3, GL_FLOAT, false,
+				sizeof(glm::vec3), normal.data());
+		data.add_stream(tangent_name, 4, GL_FLOAT, false,
+				sizeof(glm::vec4), tangent.data());
+	}
+
+	if(compression.bones && bones.size() <= 65536) {
+		std::vector<GLushort> packed_bone_ids(bone_ids.begin(),
+						      bone_ids.end());
+		std::vector<GLubyte> packed_bone_weights(bone_weights.size());
+		for(unsigned int i = 0; i < mesh->mNumVertices; i++) {
+			//round the weights and make them add up to one again
+			unsigned int sum = 0;
+			unsigned int largest = 0;
+			for(unsigned int j = 0; j < BONES_PER_VERTEX; j++) {
+				unsigned int k = i * BONES_PER_VERTEX + j;
+				float weight = glm::clamp(bone_weights[k], 0.0f, 1.0f);
+				packed_bone_weights[k] = (GLubyte)(weight * 255.0f + 0.5f);
+				sum += packed_bone_weights[k];
+				if(bone_weights[k] > bone_weights[i * BONES_PER_VERTEX + largest])
+					largest = j;
+			}
+			if(sum > 0) {
+				unsigned int k = i * BONES_PER_VERTEX + largest;
+				packed_bone_weights[k] += 255 - (int)sum;
+			}
+		}
+		data.add_stream(bone_ids_name, BONES_PER_VERTEX, GL_UNSIGNED_SHORT,
+				false, BONES_PER_VERTEX * sizeof(GLushort),
+				packed_bone_ids.data());
+		data.add_stream(bone_weights_name, BONES_PER_VERTEX, GL_UNSIGNED_BYTE,
+				true, BONES_PER_VERTEX * sizeof(GLubyte),
+				packed_bone_weights.data());
+	} else {
+		data.add_stream(bone_ids_name, BONES_PER_VERTEX, GL_INT, false,
+				BONES_PER_VERTEX * sizeof(int), bone_ids.data());
+		data.add_stream(bone_weights_name, BONES_PER_VERTEX, GL_FLOAT, false,
+				BONES_PER_VERTEX * sizeof(float),
+				bone_weights.data());
+	}
+
+	for(unsigned int i = 0; i < num_uv; i++) {
+		std::string name = texture_coordinates_name + std::to_string(i);
+		if(!compression.texture_coordinates) {
+			data.add_stream(name, 3, GL_FLOAT, false, sizeof(glm::vec3),
+					tex_coord[i].data());
+			continue;
+		}
+
+		//two component coordinates fit into a single 32 bit word
+		unsigned int components = (mesh->mNumUVComponents[i] > 2) ? 4 : 2;
+		unsigned int size = components * 2;
+		std::vector<unsigned char> packed_tex_coord(mesh->mNumVertices * size);
+		for(unsigned int j = 0; j < mesh->mNumVertices; j++) {
+			const glm::vec3& uv = tex_coord[i][j];
+			if(components == 2) {
+				uint32_t packed = glm::packHalf2x16(glm::vec2(uv.x, uv.y));
+				std::memcpy(&packed_tex_coord[j * size], &packed, size);
+			} else {
+				uint64_t packed = glm::packHalf4x16(glm::vec4(uv, 0));
+				std::memcpy(&packed_tex_coord[j * size], &packed, size);
+			}
+		}
+		data.add_stream(name, components, GL_HALF_FLOAT, false, size,
+				packed_tex_coord.data());
+	}
+
+	for(unsigned int i = 0; i < num_col; i++) {
+		std::string name = color_name + std::to_string(i);
+		if(!compression.color) {
+			data.add_stream(name, 4, GL_FLOAT, false, sizeof(glm::vec4),
+					col[i].data());
+			continue;
+		}
+
+		std::vector<uint32_t> packed_col(mesh->mNumVertices);
+		for(unsigned int j = 0; j < mesh->mNumVertices; j++) {
+			packed_col[j] = glm::packUnorm4x8(col[i][j]);
+		}
+		data.add_stream(name, 4, GL_UNSIGNED_BYTE, true, sizeof(uint32_t),
+				packed_col.data());
+	}
+}
+
+std::unique_ptr<Mesh> Model::create_mesh(unsigned int index) {
+	aiMesh *mesh = scene->mMeshes[index];
+	Mesh_Data data;
+	create_mesh_data(index, data);
+
+	if(interleaved) {
+		//interleaved buffers only store the attributes the shader
+		//actually uses
+		std::vector<std::string> names;
+		for(const Vertex_Stream& stream : data.streams) {
+			if(stream.name != position_name &&
+			   shader->get_attribute_location(stream.name) < 0)
+				names.push_back(stream.name);
+		}
+		for(const std::string& name : names)
+			data.remove_stream(name);
+		data.interleave();
+	}
+
 	// Mesh
 	std::unique_ptr<Mesh> mesh_tmp = std::make_unique<Mesh>();
-	mesh_tmp->num_uv = num_uv;
-	mesh_tmp->num_col = num_col;
-	mesh_tmp->attach_vertex_buffer(position);
-	mesh_tmp->attach_vertex_buffer(normal);
-	mesh_tmp->attach_vertex_buffer(tangent);
-
-	mesh_tmp->attach_vertex_buffer(bone_ids.data(),
-					bone_ids.size());
-	mesh_tmp->attach_vertex_buffer(bone_weights.data(),
-					bone_weights.size());
-
-	if(num_uv) {
-		mesh_tmp->attach_vertex_buffer(tex_coord[0].data(), mesh->mNumVertices * num_uv);
-	}
-	if(num_col) {
-		mesh_tmp->attach_vertex_buffer(col[0].data(), mesh->mNumVertices * num_col);
-	}
-	mesh_tmp->compute_bounding_box(position, 0);
-	mesh_tmp->attach_index_buffer(indices);
-	if(shader) {
+	if(shader)
 		mesh_tmp->setup_shader(shader);
-		set_vertex_attribute(mesh_tmp);
+	//skinned vertices leave the bind pose bounds
+	if(mesh->mNumBones > 0)
+		mesh_tmp->frustum_culling = false;
+	if(packed) {
+		//the buffers are created by pack_meshes once all meshes
+		//are known
+		mesh_tmp->copy_properties(data);
+		packed_data.push_back(std::move(data));
+	} else {
+		mesh_tmp->upload(data, vertex_heap, index_heap);
+		for(Buffer_Range *range : mesh_tmp->vbo_ranges) {
+			if(range)
+				heap_ranges.push_back({vertex_heap, range});
+		}
+		for(Buffer_Range *range : mesh_tmp->ibo_ranges) {
+			if(range)
+				heap_ranges.push_back({index_heap, range});
+		}
+		vertex_layouts[mesh_tmp.get()] = data.streams;
 	}
 	if(view_matrix && projection_matrix)
 		mesh_tmp->setup_camera(view_matrix, projection_matrix);
@@ -404,6 +876,12 @@ std::unique_ptr<Mesh> Model::create_mesh(unsigned int index) {
 	mat->Get(AI_MATKEY_SHININESS_STRENGTH,
 		mesh_tmp->shininess_strength);
 
+	//does the mesh need to be blended?
+	float opacity = 1.0;
+	mat->Get(AI_MATKEY_OPACITY, opacity);
+	mesh_tmp->transparent = opacity < 1.0 ||
+		mat->GetTextureCount(aiTextureType_OPACITY) > 0;
+
 	//ambient textures
 	num_textures = mat->GetTextureCount(aiTextureType_AMBIENT);
 	for(unsigned int i = 0; i < num_textures; i++) {
@@ -515,6 +993,127 @@ std::unique_ptr<Mesh> Model::create_mesh(unsigned int index) {
 	return mesh_tmp;
 }
 
+static bool same_layout(const Mesh_Data& a, const Mesh_Data& b) {
+	if(a.streams.size() != b.streams.size() ||
+	   a.buffers.size() != b.buffers.size())
+		return false;
+
+	for(unsigned int i = 0; i < a.streams.size(); i++) {
+		const Vertex_Stream& x = a.streams[i];
+		const Vertex_Stream& y = b.streams[i];
+		if(x.name != y.name ||
+		   x.number_elements != y.number_elements ||
+		   x.type != y.type ||
+		   x.normalized != y.normalized ||
+		   x.size != y.size ||
+		   x.buffer_index != y.buffer_index ||
+		   x.stride != y.stride ||
+		   x.offset != y.offset)
+			return false;
+	}
+	return true;
+}
+
+void Model::pack_meshes() {
+	//meshes with the same vertex layout are stored behind each other,
+	//base_vertices[i] is the first vertex and first_indices[i] the first
+	//index of mesh i in the buffers of its group
+	std::vector<Mesh_Data> groups;
+	std::vector<GLint> base_vertices(packed_data.size());
+	std::vector<unsigned int> first_indices(packed_data.size());
+	for(unsigned int i = 0; i < packed_data.size(); i++) {
+		const Mesh_Data& data = packed_data[i];
+		unsigned int group_index = 0;
+		while(group_index < groups.size() &&
+		      !same_layout(groups[group_index], data))
+			group_index++;
+		if(group_index == groups.size()) {
+			groups.emplace_back();
+			groups.back().streams = data.streams;
+			groups.back().buffers.resize(data.buffers.size());
+			packed_groups.emplace_back();
+		}
+
+		Mesh_Data& group = groups[group_index];
+		packed_groups[group_index].meshes.push_back(i);
+		base_vertices[i] = group.num_vertices;
+		first_indices[i] = group.indices.size();
+		group.num_vertices += data.num_vertices;
+		for(unsigned int j = 0; j < data.buffers.size(); j++) {
+			group.buffers[j].insert(group.buffers[j].end(),
+						data.buffers[j].begin(),
+						data.buffers[j].end());
+		}
+		//the indices stay relative to the first vertex of the mesh
+		group.indices.insert(group.indices.end(), data.indices.begin(),
+				     data.indices.end());
+		for(const Mesh_Data::Lod& lod : data.lods) {
+			group.indices.insert(group.indices.end(),
+					     lod.indices.begin(),
+					     lod.indices.end());
+		}
+	}
+
+	for(unsigned int i = 0; i < groups.size(); i++) {
+		Packed_Group& packed_group = packed_groups[i];
+		packed_group.mesh = std::make_unique<Mesh>();
+		Mesh& owner = *packed_group.mesh;
+		if(shader)
+			owner.setup_shader(shader);
+		owner.upload(groups[i]);
+		vertex_layouts[&owner] = groups[i].streams;
+
+		std::vector<unsigned int> strides(groups[i].buffers.size(), 0);
+		for(const Vertex_Stream& stream : groups[i].streams)
+			strides[stream.buffer_index] = stream.stride;
+
+		Buffer *index_buffer = owner.ibo.empty() ? nullptr : owner.ibo[0].get();
+		GLenum index_type = owner.get_index_buffer_type(0);
+		unsigned int index_size = (index_type == GL_UNSIGNED_SHORT) ?
+			sizeof(unsigned short) : sizeof(unsigned int);
+
+		for(unsigned int index : packed_group.meshes) {
+			Mesh& mesh = *meshes[index];
+			const Mesh_Data& data = packed_data[index];
+			mesh.share_vertex_array(owner, base_vertices[index]);
+			for(unsigned int j = 0; j < strides.size(); j++) {
+				packed_ranges.push_back(std::make_unique<Buffer_Range>());
+				Buffer_Range& range = *packed_ranges.back();
+				range.buffer = owner.vbo[j].get();
+				range.offset = base_vertices[index] * strides[j];
+				range.size = data.num_vertices * strides[j];
+				mesh.attach_vertex_range(&range);
+			}
+
+			unsigned int first_index = first_indices[index];
+			auto attach_indices = [&](const std::vector<unsigned int>& indices) {
+				packed_ranges.push_back(std::make_unique<Buffer_Range>());
+				Buffer_Range& range = *packed_ranges.back();
+				range.buffer = index_buffer;
+				range.offset = first_index * index_size;
+				range.size = indices.size() * index_size;
+				first_index += indices.size();
+				return mesh.attach_index_range(&range, index_type);
+			};
+			if(index_buffer && !data.indices.empty())
+				attach_indices(data.indices);
+			for(const Mesh_Data::Lod& lod : data.lods) {
+				if(!index_buffer)
+					break;
+				int lod_buffer = attach_indices(lod.indices);
+				if(lod_buffer >= 0)
+					mesh.attach_lod(lod_buffer, lod.error);
+			}
+
+			//only records the attributes, the pointers are set
+			//through the owner of the vertex array
+			vertex_layouts[&mesh] = data.streams;
+			mesh.set_vertex_attributes(data.streams);
+		}
+	}
+	packed_data.clear();
+}
+
 void Model::traverse_animation_nodes(float time,
 			      aiNode *node,
 			      glm::mat4 parent_transformation) {
@@ -683,32 +1282,77 @@ void Model::setup_instanced_matrix(const std::vector<glm::mat4>& model_matrix,
 		App::error_string.push_back(error);
 		throw std::runtime_error(error);
 	}
+	instance_spheres.clear();
 	for(const auto& mesh : meshes) {
-		std::vector<glm::mat3> normal_matrix(model_matrix.size());
-		for(unsigned int i = 0; i < normal_matrix.size(); i++) {
-			normal_matrix[i] = glm::mat3(glm::transpose(glm::inverse(model_matrix[i])));
-		}
-		model_matrix_buf = mesh->attach_vertex_buffer(model_matrix, usage);
-		normal_matrix_buf = mesh->attach_vertex_buffer(normal_matrix, usage);
-		int model_loc = mesh->shader->get_attribute_location(mesh->model_matrix_name);
-		int normal_loc = mesh->shader->get_attribute_location(mesh->normal_matrix_name);
-		if(model_loc >= 0) {
-			for(int i = 0; i < 4; i++) {
-				mesh->set_vertex_attribute(model_loc + i,
-								model_matrix_buf,
-								4, GL_FLOAT,
-								sizeof(glm::mat4),
-								(GLvoid *)(i * sizeof(glm::vec4)), 1);
-			}
+		//the bounding sphere of all instances of the mesh
+		Sphere bounds = {glm::vec3(0), 0};
+		for(unsigned int i = 0; i < model_matrix.size(); i++) {
+			Sphere sphere = Bounds::transform(mesh->bounding_sphere,
+							  model_matrix[i]);
+			bounds = i ? Bounds::merge(bounds, sphere) : sphere;
 		}
-		if(normal_loc >= 0) {
-			for(int i = 0; i < 3; i++) {
-				mesh->set_vertex_attribute(normal_loc + i,
-								normal_matrix_buf,
-								3, GL_FLOAT,
-								sizeof(glm::mat3),
-								(GLvoid *)(i * sizeof(glm::vec3)), 1);
-			}
+		if(!mesh->frustum_culling)
+			bounds.radius = std::numeric_limits<float>::max();
+		instance_spheres.push_back(bounds);
+	}
+
+	std::vector<glm::mat3> normal_matrix(model_matrix.size());
+	for(unsigned int i = 0; i < normal_matrix.size(); i++)
+		normal_matrix[i] = glm::mat3(glm::transpose(glm::inverse(model_matrix[i])));
+
+	//packed meshes share the instance buffers of their group and find
+	//their matrices through the base instance
+	for(Packed_Group& group : packed_groups) {
+		std::vector<glm::mat4> decoded_matrices;
+		std::vector<glm::mat3> normal_matrices;
+		for(unsigned int i = 0; i < group.meshes.size(); i++) {
+			Mesh& mesh = *meshes[group.meshes[i]];
+			mesh.base_instance = i * model_matrix.size();
+			for(const glm::mat4& matrix : model_matrix)
+				decoded_matrices.push_back(matrix * mesh.position_decode);
+			normal_matrices.insert(normal_matrices.end(),
+					       normal_matrix.begin(),
+					       normal_matrix.end());
+		}
+		group.model_matrix_buf = group.mesh->attach_vertex_buffer(decoded_matrices, usage);
+		group.normal_matrix_buf = group.mesh->attach_vertex_buffer(normal_matrices, usage);
+		set_instance_attributes(*group.mesh, group.model_matrix_buf,
+					group.normal_matrix_buf);
+	}
+	if(!packed_groups.empty())
+		return;
+
+	for(const auto& mesh : meshes) {
+		std::vector<glm::mat4> decoded_matrix(model_matrix.size());
+		for(unsigned int i = 0; i < decoded_matrix.size(); i++)
+			decoded_matrix[i] = model_matrix[i] * mesh->position_decode;
+		std::pair<int, int>& buffers = instance_buffers[mesh.get()];
+		buffers.first = mesh->attach_vertex_buffer(decoded_matrix, usage);
+		buffers.second = mesh->attach_vertex_buffer(normal_matrix, usage);
+		set_instance_attributes(*mesh, buffers.first, buffers.second);
+	}
+}
+
+void Model::set_instance_attributes(Mesh& mesh, int model_matrix_buf,
+				    int normal_matrix_buf) {
+	int model_loc = mesh.shader->get_attribute_location(mesh.model_matrix_name);
+	int normal_loc = mesh.shader->get_attribute_location(mesh.normal_matrix_name);
+	if(model_loc >= 0) {
+		for(int i = 0; i < 4; i++) {
+			mesh.set_vertex_attribute(model_loc + i,
+							model_matrix_buf,
+							4, GL_FLOAT,
+							sizeof(glm::mat4),
+							(GLvoid *)(i * sizeof(glm::vec4)), 1);
+		}
+	}
+	if(normal_loc >= 0) {
+		for(int i = 0; i < 3; i++) {
+			mesh.set_vertex_attribute(normal_loc + i,
+							normal_matrix_buf,
+							3, GL_FLOAT,
+							sizeof(glm::mat3),
+							(GLvoid *)(i * sizeof(glm::vec3)), 1);
 		}
 	}
 }
@@ -720,38 +1364,50 @@ void Model::set_instanced_matrix_attributes() {
 		App::error_string.push_back(error);
 		throw std::runtime_error(error);
 	}
+	for(Packed_Group& group : packed_groups) {
+		if(group.model_matrix_buf < 0)
+			continue;
+		set_instance_attributes(*group.mesh, group.model_matrix_buf,
+					group.normal_matrix_buf);
+	}
+	if(!packed_groups.empty())
+		return;
+
 	for(const auto& mesh : meshes) {
-		int model_loc = mesh->shader->get_attribute_location(mesh->model_matrix_name);
-		int normal_loc = mesh->shader->get_attribute_location(mesh->normal_matrix_name);
-		if(model_loc >= 0) {
-			for(int i = 0; i < 4; i++) {
-				mesh->set_vertex_attribute(model_loc + i,
-								model_matrix_buf,
-								4, GL_FLOAT,
-								sizeof(glm::mat4),
-								(GLvoid *)(i * sizeof(glm::vec4)), 1);
-			}
-		}
-		if(normal_loc >= 0) {
-			for(int i = 0; i < 3; i++) {
-				mesh->set_vertex_attribute(normal_loc + i,
-								normal_matrix_buf,
-								3, GL_FLOAT,
-								sizeof(glm::mat3),
-								(GLvoid *)(i * sizeof(glm::vec3)), 1);
-			}
-		}
+		auto buffers = instance_buffers.find(mesh.get());
+		if(buffers == instance_buffers.end())
+			continue;
+		set_instance_attributes(*mesh, buffers->second.first,
+					buffers->second.second);
 	}
 }
 
 void Model::draw(const glm::mat4 *model_matrix) {
-	for(const auto& mesh : meshes) {
-		if(model_matrix) {
-			glm::mat4 matrix_tmp = *model_matrix * mesh->model_matrix;
-			mesh->draw(GL_TRIANGLES, &matrix_tmp);
-		}
-		else
-			mesh->draw(GL_TRIANGLES);
+	cull_matrices.resize(meshes.size());
+	cull_spheres.resize(meshes.size());
+	for(unsigned int i = 0; i < meshes.size(); i++) {
+		cull_matrices[i] = meshes[i]->model_matrix;
+		if(model_matrix)
+			cull_matrices[i] = *model_matrix * meshes[i]->model_matrix;
+		cull_spheres[i] = Bounds::transform(meshes[i]->bounding_sphere,
+						    cull_matrices[i]);
+		if(!meshes[i]->frustum_culling)
+			cull_spheres[i].radius = std::numeric_limits<float>::max();
+	}
+	cull_meshes();
+
+	if(!packed_groups.empty()) {
+		draw_packed(0);
+		return;
+	}
+
+	for(unsigned int i = 0; i < meshes.size(); i++) {
+		if(!cull_visible[i])
+			continue;
+		unsigned int index_buffer = meshes[i]->select_lod(cull_matrices[i],
+								  lod_threshold);
+		meshes[i]->draw_unculled(GL_TRIANGLES, index_buffer,
+					 cull_matrices[i]);
 	}
 }
 
@@ -759,8 +1415,86 @@ void Model::draw_instanced(unsigned int num_instances) {
 	if(num_instances == 0)
 		return;
 
+	if(instance_spheres.size() == meshes.size()) {
+		cull_spheres = instance_spheres;
+	} else {
+		//the instance matrices are unknown, nothing can be culled
+		cull_spheres.assign(meshes.size(),
+				    {glm::vec3(0), std::numeric_limits<float>::max()});
+	}
+	cull_meshes();
+
+	if(!packed_groups.empty()) {
+		draw_packed(num_instances);
+		return;
+	}
+
+	for(unsigned int i = 0; i < meshes.size(); i++) {
+		if(cull_visible[i])
+			meshes[i]->draw_instanced(GL_TRIANGLES, 0, num_instances);
+	}
+}
+
+void Model::draw_packed(unsigned int num_instances) {
+	//the meshes of a group share their vertex array, so it is only
+	//bound when the draws move on to the next group
+	Mesh *previous = nullptr;
+	for(const Packed_Group& group : packed_groups) {
+		for(unsigned int i : group.meshes) {
+			if(!cull_visible[i])
+				continue;
+
+			Mesh *mesh = meshes[i].get();
+			unsigned int index_buffer = 0;
+			if(num_instances > 0) {
+				if(!mesh->set_instanced_uniforms())
+					continue;
+			} else {
+				index_buffer = mesh->select_lod(cull_matrices[i],
+								lod_threshold);
+				if(!mesh->set_draw_uniforms(cull_matrices[i]))
+					continue;
+			}
+
+			if(previous && State_Cache::get().unbind_after_use) {
+				for(Buffer *buffer : previous->attached_buffers)
+					buffer->unbind();
+			}
+			mesh->bind_vertex_state();
+			mesh->draw_elements(GL_TRIANGLES, index_buffer,
+					    num_instances);
+			previous = mesh;
+		}
+	}
+	if(previous)
+		previous->release_vertex_state();
+}
+
+unsigned int Model::add_to_batch(Draw_Batch& batch,
+				 const glm::mat4 *model_matrix) {
+
+	unsigned int num_added = 0;
+	for(const auto& mesh : meshes) {
+		glm::mat4 matrix_tmp = mesh->model_matrix;
+		if(model_matrix)
+			matrix_tmp = *model_matrix * mesh->model_matrix;
+		if(batch.add(*mesh, 0, &matrix_tmp) >= 0)
+			num_added++;
+	}
+	return num_added;
+}
+
+void Model::add_to_queue(Render_Queue& queue,
+			 const glm::mat4 *model_matrix,
+			 unsigned int pass) {
+
 	for(const auto& mesh : meshes) {
-		mesh->draw_instanced(GL_TRIANGLES, 0, num_instances);
+		glm::mat4 matrix_tmp = mesh->model_matrix;
+		if(model_matrix)
+			matrix_tmp = *model_matrix * mesh->model_matrix;
+		unsigned int index_buffer = mesh->select_lod(matrix_tmp,
+							     lod_threshold);
+		queue.add(*mesh, matrix_tmp, pass, index_buffer);
 	}
 }
 
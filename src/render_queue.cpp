@@ -0,0 +1,210 @@
+#include <sgltk/render_queue.h>
+
+using namespace sgltk;
+
+static const unsigned int shader_bits = 11;
+static const unsigned int field_bits = 16;
+static const std::uint64_t field_mask = (1 << field_bits) - 1;
+
+Render_Queue::Render_Queue() {
+	sorted = true;
+	num_state_changes = 0;
+}
+
+Render_Queue::~Render_Queue() {
+}
+
+unsigned int Render_Queue::get_shader_id(const Shader *shader) {
+	//the masked id only orders the draws, draw compares the shaders
+	//themselves so colliding ids cannot skip a program change
+	auto it = shader_ids.emplace(shader, shader_ids.size()).first;
+	return it->second & ((1 << shader_bits) - 1);
+}
+
+unsigned int Render_Queue::get_material_id(const Mesh& mesh) {
+	auto it = mesh_materials.find(&mesh);
+	if(it != mesh_materials.end())
+		return it->second;
+
+	//meshes that set the same uniforms to the same values and bind the
+	//same textures share a material
+	std::string material;
+	auto append = [&material](const void *data, size_t size) {
+		material.append((const char *)data, size);
+	};
+	append(glm::value_ptr(mesh.color_ambient), sizeof(glm::vec4));
+	append(glm::value_ptr(mesh.color_diffuse), sizeof(glm::vec4));
+	append(glm::value_ptr(mesh.color_specular), sizeof(glm::vec4));
+	append(&mesh.shininess, sizeof(float));
+	append(&mesh.shininess_strength, sizeof(float));
+	material += mesh.ambient_color_name + '\0';
+	material += mesh.diffuse_color_name + '\0';
+	material += mesh.specular_color_name + '\0';
+	material += mesh.shininess_name + '\0';
+	material += mesh.shininess_strength_name + '\0';
+	for(const auto& textures : {&mesh.textures, &mesh.auto_textures}) {
+		for(const auto& tex : *textures) {
+			material += std::get<0>(tex) + '\0';
+			append(&std::get<1>(tex).texture, sizeof(GLuint));
+			append(&std::get<2>(tex), sizeof(unsigned int));
+		}
+		material += '\0';
+	}
+
+	//the id is unique, only its lower bits end up in the sort key
+	unsigned int id = material_ids.emplace(material,
+					       material_ids.size()).first->second;
+	mesh_materials[&mesh] = id;
+	return id;
+}
+
+unsigned int Render_Queue::get_depth(const Mesh& mesh,
+				     const glm::mat4& model_matrix) {
+	if(!mesh.view_matrix)
+		return 0;
+
+	glm::vec4 position = (*mesh.view_matrix) * model_matrix *
+		glm::vec4(mesh.bounding_sphere.center, 1);
+	float distance = std::max(glm::length(glm::vec3(position)), 0.0f);
+
+	//the bits of positive floats are ordered like the floats, the upper
+	//half keeps the exponent and 7 bits of the mantissa
+	std::uint32_t bits;
+	std::memcpy(&bits, &distance, sizeof(float));
+	return bits >> (32 - field_bits);
+}
+
+void Render_Queue::add(Mesh& mesh, const glm::mat4& model_matrix,
+		       unsigned int pass, unsigned int index_buffer,
+		       GLenum mode) {
+
+	if(!mesh.shader) {
+		App::error_string.push_back("Error: No shader specified");
+		return;
+	}
+
+	Queue_Item item;
+	item.mesh = &mesh;
+	item.index_buffer = index_buffer;
+	item.mode = mode;
+	item.model_matrix = model_matrix;
+	item.material = get_material_id(mesh);
+
+	std::uint64_t shader = get_shader_id(mesh.shader);
+	std::uint64_t material = item.material & field_mask;
+	std::uint64_t vao = mesh.vao & field_mask;
+	std::uint64_t depth = get_depth(mesh, model_matrix);
+
+	Sort_Entry entry;
+	entry.item = items.size();
+	entry.key = (std::uint64_t)(pass & 0xF) << 60;
+	if(mesh.transparent) {
+		entry.key |= (std::uint64_t)1 << 59;
+		entry.key |= (field_mask - depth) << 43;
+		entry.key |= shader << 32;
+		entry.key |= material << 16;
+		entry.key |= vao;
+	} else {
+		entry.key |= shader << 48;
+		entry.key |= material << 32;
+		entry.key |= vao << 16;
+		entry.key |= depth;
+	}
+
+	items.push_back(item);
+	entries.push_back(entry);
+	sorted = false;
+}
+
+void Render_Queue::clear() {
+	items.clear();
+	entries.clear();
+	mesh_materials.clear();
+	material_ids.clear();
+	shader_ids.clear();
+	sorted = true;
+}
+
+unsigned int Render_Queue::get_num_draws() {
+	return items.size();
+}
+
+unsigned int Render_Queue::get_num_state_changes() {
+	return num_state_changes;
+}
+
+void Render_Queue::radix_sort() {
+	//least significant digit first radix sort with 8 bit digits
+	sort_buffer.resize(entries.size());
+	std::uint64_t differing = 0;
+	for(const Sort_Entry& entry : entries)
+		differing |= entry.key ^ entries[0].key;
+
+	for(unsigned int shift = 0; shift < 64; shift += 8) {
+		//all keys share this digit
+		if(((differing >> shift) & 0xFF) == 0)
+			continue;
+
+		unsigned int offsets[256] = {0};
+		for(const Sort_Entry& entry : entries)
+			offsets[(entry.key >> shift) & 0xFF]++;
+
+		unsigned int sum = 0;
+		for(unsigned int& offset : offsets) {
+			unsigned int count = offset;
+			offset = sum;
+			sum += count;
+		}
+
+		for(const Sort_Entry& entry : entries)
+			sort_buffer[offsets[(entry.key >> shift) & 0xFF]++] = entry;
+		entries.swap(sort_buffer);
+	}
+}
+
+void Render_Queue::draw() {
+	num_state_changes = 0;
+	if(items.empty())
+		return;
+
+	if(!sorted) {
+		radix_sort();
+		sorted = true;
+	}
+
+	Shader *shader = nullptr;
+	Mesh *mesh = nullptr;
+	unsigned int material = 0;
+	for(const Sort_Entry& entry : entries) {
+		const Queue_Item& item = items[entry.item];
+		Mesh *current = item.mesh;
+
+		bool shader_changed = current->shader != shader;
+		if(shader_changed) {
+			shader = current->shader;
+			shader->bind();
+			num_state_changes++;
+		}
+		current->update_uniform_locations();
+
+		if(shader_changed || item.material != material) {
+			material = item.material;
+			current->material_uniform();
+			num_state_changes++;
+		}
+
+		if(current != mesh) {
+			if(mesh && State_Cache::get().unbind_after_use) {
+				for(Buffer *buffer : mesh->attached_buffers)
+					buffer->unbind();
+			}
+			mesh = current;
+			mesh->bind_vertex_state();
+			num_state_changes++;
+		}
+
+		mesh->set_matrix_uniforms(item.model_matrix);
+		mesh->draw_elements(item.mode, item.index_buffer);
+	}
+	mesh->release_vertex_state();
+}
@@ -6,10 +6,11 @@ Renderbuffer::Renderbuffer() {
 	this->format = GL_FLOAT;
 	this->width = 100;
 	this->height = 100;
-	glGenRenderbuffers(1, &buffer);
-	bind();
-	glRenderbufferStorage(GL_RENDERBUFFER, format, width, height);
-	unbind();
+	if(App::direct_state_access)
+		glCreateRenderbuffers(1, &buffer);
+	else
+		glGenRenderbuffers(1, &buffer);
+	allocate_storage();
 }
 
 Renderbuffer::Renderbuffer(unsigned int width,
@@ -18,35 +19,46 @@ Renderbuffer::Renderbuffer(unsigned int width,
 	this->format = format;
 	this->width = width;
 	this->height = height;
-	glGenRenderbuffers(1, &buffer);
-	bind();
-	glRenderbufferStorage(GL_RENDERBUFFER, format, width, height);
-	unbind();
+	if(App::direct_state_access)
+		glCreateRenderbuffers(1, &buffer);
+	else
+		glGenRenderbuffers(1, &buffer);
+	allocate_storage();
 }
 
 Renderbuffer::~Renderbuffer() {
-	glDeleteRenderbuffers(1, &buffer);
+	Memory_Registry::untrack(this);
+	State_Cache::get().delete_renderbuffer(buffer);
 }
 
 void Renderbuffer::bind() {
-	glBindRenderbuffer(GL_RENDERBUFFER, buffer);
+	State_Cache::get().bind_renderbuffer(buffer);
 }
 
 void Renderbuffer::unbind() {
-	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	State_Cache::get().bind_renderbuffer(0);
 }
 
-void Renderbuffer::set_format(GLenum format) {
-	this->format = format;
+void Renderbuffer::allocate_storage() {
+	Memory_Registry::track(this, RESOURCE_KIND::RENDERBUFFER, format,
+			       (size_t)width * height *
+			       Memory_Registry::get_format_size(format));
+	if(App::direct_state_access) {
+		glNamedRenderbufferStorage(buffer, format, width, height);
+		return;
+	}
 	bind();
 	glRenderbufferStorage(GL_RENDERBUFFER, format, width, height);
-	unbind();
+	State_Cache::get().release_renderbuffer();
+}
+
+void Renderbuffer::set_format(GLenum format) {
+	this->format = format;
+	allocate_storage();
 }
 
 void Renderbuffer::set_size(unsigned int width, unsigned int height) {
 	this->width = width;
 	this->height = height;
-	bind();
-	glRenderbufferStorage(GL_RENDERBUFFER, format, width, height);
-	unbind();
+	allocate_storage();
 }
@@ -3,7 +3,6 @@
 using namespace sgltk;
 
 int Shader::counter = 0;
-int Shader::bound = -1;
 std::vector<std::string> Shader::paths = {"./"};
 
 void Shader::add_path(std::string path) {
@@ -25,6 +24,7 @@ Shader::Shader() {
 	transform_feedback = false;
 	modify = true;
 	linked = false;
+	link_count = 0;
 	program = glCreateProgram();
 	if(!program) {
 		std::string error("Error creating new shader program");
@@ -34,7 +34,7 @@ Shader::Shader() {
 }
 
 Shader::~Shader() {
-	glDeleteProgram(program);
+	State_Cache::get().delete_program(program);
 }
 
 bool Shader::attach_file(const std::string& filename, GLenum type) {
@@ -145,7 +145,7 @@ void Shader::set_transform_feedback_variables(std::vector<std::string>& variable
 void Shader::recompile() {
 	modify = false;
 	unbind();
-	glDeleteProgram(program);
+	State_Cache::get().delete_program(program);
 	program = glCreateProgram();
 	for(const std::pair<std::string, GLenum>& it : shader_path_map) {
 		attach_file(it.first, it.second);
@@ -174,22 +174,99 @@ bool Shader::link() {
 		glDetachShader(program, shader);
 	}
 	linked = true;
+	link_count++;
+	cache_uniform_locations();
+	//linking resets all uniforms to their initial values
+	invalidate_uniform_values();
 	return true;
 }
 
-void Shader::bind() {
-	if(bound == id) {
-		return;
+void Shader::cache_uniform_locations() {
+	uniform_locations.clear();
+
+	GLint num_uniforms = 0;
+	GLint max_length = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &num_uniforms);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+	std::vector<char> buffer(max_length + 1);
+	for(GLint i = 0; i < num_uniforms; i++) {
+		GLint size;
+		GLenum type;
+		GLsizei length = 0;
+		glGetActiveUniform(program, i, buffer.size(), &length, &size,
+				   &type, buffer.data());
+		std::string name(buffer.data(), length);
+		GLint location = glGetUniformLocation(program, name.c_str());
+		if(location < 0)
+			continue;
+
+		uniform_locations[name] = location;
+		//arrays are listed by their first element
+		if(name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+			std::string base = name.substr(0, name.size() - 3);
+			uniform_locations[base] = location;
+			for(GLint j = 1; j < size; j++) {
+				std::string element = base + "[" + std::to_string(j) + "]";
+				uniform_locations[element] = glGetUniformLocation(program,
+										  element.c_str());
+			}
+		}
 	}
-	bound = id;
-	glUseProgram(program);
+}
+
+unsigned int Shader::get_link_count() {
+	return link_count;
+}
+
+void Shader::invalidate_uniform_values() {
+	uniform_values.clear();
+}
+
+bool Shader::update_uniform_value(int location, const void *value,
+				  unsigned int size, unsigned int count,
+				  bool transpose) {
+
+	if(location < 0 || count == 0)
+		return false;
+
+	//array elements have consecutive locations and are shadowed
+	//individually so that they can also be set one at a time
+	unsigned int element_size = size / count;
+	const unsigned char *data = (const unsigned char *)value;
+	if(uniform_values.size() < location + count)
+		uniform_values.resize(location + count);
+
+	bool changed = false;
+	for(unsigned int i = 0; i < count && !changed; i++) {
+		const std::vector<unsigned char>& shadow = uniform_values[location + i];
+		changed = shadow.size() != element_size + 1 ||
+			  shadow[0] != transpose ||
+			  std::memcmp(&shadow[1], data + i * element_size,
+				      element_size) != 0;
+	}
+	if(!changed) {
+		State_Cache::get().count_skipped_upload();
+		return false;
+	}
+
+	for(unsigned int i = 0; i < count; i++) {
+		std::vector<unsigned char>& shadow = uniform_values[location + i];
+		shadow.resize(element_size + 1);
+		shadow[0] = transpose;
+		std::memcpy(&shadow[1], data + i * element_size, element_size);
+	}
+	return true;
+}
+
+void Shader::bind() {
+	State_Cache::get().use_program(program);
 }
 
 void Shader::unbind() {
-	if(bound == id) {
-		glUseProgram(0);
+	State_Cache& state = State_Cache::get();
+	if(state.get_program() == program) {
+		state.use_program(0);
 	}
-	bound = -1;
 }
 
 int Shader::get_attribute_location(const std::string& name) {
@@ -197,7 +274,18 @@ int Shader::get_attribute_location(const std::string& name) {
 }
 
 int Shader::get_uniform_location(const std::string& name) {
-	return glGetUniformLocation(program, name.c_str());
+	if(!linked)
+		return glGetUniformLocation(program, name.c_str());
+
+	auto it = uniform_locations.find(name);
+	if(it != uniform_locations.end())
+		return it->second;
+
+	//names that are not listed, e.g. members of arrays of structures,
+	//are cached once they have been queried
+	int location = glGetUniformLocation(program, name.c_str());
+	uniform_locations[name] = location;
+	return location;
 }
 
 void Shader::set_uniform(int location, const glm::vec2& value) {
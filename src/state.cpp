@@ -0,0 +1,286 @@
+#include <sgltk/state.h>
+
+using namespace sgltk;
+
+//marks bindings whose state is not known to the cache
+static const GLuint unknown = 0xFFFFFFFF;
+
+State_Cache State_Cache::default_cache;
+State_Cache *State_Cache::current = &State_Cache::default_cache;
+
+State_Cache::State_Cache() {
+	unbind_after_use = true;
+	issued_calls = 0;
+	skipped_calls = 0;
+	skipped_uploads = 0;
+	frame_skipped_uploads = 0;
+	invalidate();
+}
+
+State_Cache::~State_Cache() {
+	if(current == this)
+		current = &default_cache;
+}
+
+State_Cache& State_Cache::get() {
+	return *current;
+}
+
+void State_Cache::make_current() {
+	current = this;
+}
+
+void State_Cache::invalidate() {
+	buffers.clear();
+	element_buffers.clear();
+	indexed_buffers.clear();
+	textures.clear();
+	active_unit = unknown;
+	vertex_array = unknown;
+	read_framebuffer = unknown;
+	draw_framebuffer = unknown;
+	renderbuffer = unknown;
+	program = unknown;
+}
+
+bool State_Cache::update(GLuint& cached, GLuint value) {
+	if(cached == value) {
+		skipped_calls++;
+		return false;
+	}
+	cached = value;
+	issued_calls++;
+	return true;
+}
+
+void State_Cache::bind_buffer(GLenum target, GLuint buffer) {
+	if(target == GL_ELEMENT_ARRAY_BUFFER) {
+		//the index buffer binding is part of the vertex array state
+		if(vertex_array == unknown) {
+			issued_calls++;
+			glBindBuffer(target, buffer);
+			return;
+		}
+		auto it = element_buffers.emplace(vertex_array, unknown).first;
+		if(update(it->second, buffer))
+			glBindBuffer(target, buffer);
+		return;
+	}
+
+	auto it = buffers.emplace(target, unknown).first;
+	if(update(it->second, buffer))
+		glBindBuffer(target, buffer);
+}
+
+void State_Cache::bind_buffer_base(GLenum target, GLuint index, GLuint buffer) {
+	Indexed_Binding binding = {buffer, 0, 0};
+	auto it = indexed_buffers.find(std::make_pair(target, index));
+	if(it != indexed_buffers.end() &&
+			it->second.buffer == buffer &&
+			it->second.size == 0) {
+		skipped_calls++;
+		return;
+	}
+	indexed_buffers[std::make_pair(target, index)] = binding;
+	//indexed binding also changes the generic binding point
+	buffers[target] = buffer;
+	issued_calls++;
+	glBindBufferBase(target, index, buffer);
+}
+
+void State_Cache::bind_buffer_range(GLenum target, GLuint index, GLuint buffer,
+				    GLintptr offset, GLsizeiptr size) {
+
+	Indexed_Binding binding = {buffer, offset, size};
+	auto it = indexed_buffers.find(std::make_pair(target, index));
+	if(it != indexed_buffers.end() &&
+			it->second.buffer == buffer &&
+			it->second.offset == offset &&
+			it->second.size == size) {
+		skipped_calls++;
+		return;
+	}
+	indexed_buffers[std::make_pair(target, index)] = binding;
+	buffers[target] = buffer;
+	issued_calls++;
+	glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void State_Cache::release_buffer(GLenum target) {
+	if(unbind_after_use)
+		bind_buffer(target, 0);
+}
+
+void State_Cache::delete_buffer(GLuint buffer) {
+	glDeleteBuffers(1, &buffer);
+
+	//deleting a buffer resets all bindings to it in the current context
+	for(auto& binding : buffers) {
+		if(binding.second == buffer)
+			binding.second = 0;
+	}
+	for(auto it = element_buffers.begin(); it != element_buffers.end();) {
+		if(it->second == buffer)
+			it = element_buffers.erase(it);
+		else
+			it++;
+	}
+	for(auto it = indexed_buffers.begin(); it != indexed_buffers.end();) {
+		if(it->second.buffer == buffer)
+			it = indexed_buffers.erase(it);
+		else
+			it++;
+	}
+}
+
+void State_Cache::set_active_texture(GLuint unit) {
+	if(update(active_unit, unit))
+		glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void State_Cache::bind_texture(GLuint unit, GLenum target, GLuint texture) {
+	//the active texture unit is always set because subsequent texture
+	//operations act on the texture bound to the active unit
+	set_active_texture(unit);
+	auto it = textures.emplace(std::make_pair(unit, target), unknown).first;
+	if(update(it->second, texture))
+		glBindTexture(target, texture);
+}
+
+void State_Cache::use_texture(GLuint unit, GLenum target, GLuint texture) {
+	auto it = textures.find(std::make_pair(unit, target));
+	if(it != textures.end() && it->second == texture) {
+		skipped_uploads++;
+		return;
+	}
+	bind_texture(unit, target, texture);
+}
+
+void State_Cache::release_texture(GLuint unit, GLenum target) {
+	if(unbind_after_use)
+		bind_texture(unit, target, 0);
+}
+
+void State_Cache::delete_texture(GLuint texture) {
+	glDeleteTextures(1, &texture);
+	for(auto& binding : textures) {
+		if(binding.second == texture)
+			binding.second = 0;
+	}
+}
+
+void State_Cache::bind_vertex_array(GLuint vertex_array) {
+	if(update(this->vertex_array, vertex_array))
+		glBindVertexArray(vertex_array);
+}
+
+void State_Cache::release_vertex_array() {
+	if(unbind_after_use)
+		bind_vertex_array(0);
+}
+
+void State_Cache::delete_vertex_array(GLuint vertex_array) {
+	glDeleteVertexArrays(1, &vertex_array);
+	element_buffers.erase(vertex_array);
+	if(this->vertex_array == vertex_array)
+		this->vertex_array = 0;
+}
+
+void State_Cache::bind_framebuffer(GLenum target, GLuint framebuffer) {
+	switch(target) {
+		case GL_READ_FRAMEBUFFER:
+			if(update(read_framebuffer, framebuffer))
+				glBindFramebuffer(target, framebuffer);
+			break;
+		case GL_DRAW_FRAMEBUFFER:
+			if(update(draw_framebuffer, framebuffer))
+				glBindFramebuffer(target, framebuffer);
+			break;
+		default:
+			if(read_framebuffer == framebuffer &&
+					draw_framebuffer == framebuffer) {
+				skipped_calls++;
+				break;
+			}
+			read_framebuffer = framebuffer;
+			draw_framebuffer = framebuffer;
+			issued_calls++;
+			glBindFramebuffer(target, framebuffer);
+			break;
+	}
+}
+
+void State_Cache::delete_framebuffer(GLuint framebuffer) {
+	glDeleteFramebuffers(1, &framebuffer);
+	if(read_framebuffer == framebuffer)
+		read_framebuffer = 0;
+	if(draw_framebuffer == framebuffer)
+		draw_framebuffer = 0;
+}
+
+void State_Cache::bind_renderbuffer(GLuint renderbuffer) {
+	if(update(this->renderbuffer, renderbuffer))
+		glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+}
+
+void State_Cache::release_renderbuffer() {
+	if(unbind_after_use)
+		bind_renderbuffer(0);
+}
+
+void State_Cache::delete_renderbuffer(GLuint renderbuffer) {
+	glDeleteRenderbuffers(1, &renderbuffer);
+	if(this->renderbuffer == renderbuffer)
+		this->renderbuffer = 0;
+}
+
+void State_Cache::use_program(GLuint program) {
+	if(update(this->program, program))
+		glUseProgram(program);
+}
+
+GLuint State_Cache::get_program() {
+	if(program == unknown)
+		return 0;
+	return program;
+}
+
+void State_Cache::delete_program(GLuint program) {
+	glDeleteProgram(program);
+	//a program that is in use is only deleted once it is no longer
+	//in use, so the binding is left as unknown
+	if(this->program == program)
+		this->program = unknown;
+}
+
+unsigned long long State_Cache::get_issued_calls() {
+	return issued_calls;
+}
+
+unsigned long long State_Cache::get_skipped_calls() {
+	return skipped_calls;
+}
+
+void State_Cache::count_skipped_upload() {
+	skipped_uploads++;
+}
+
+unsigned long long State_Cache::get_skipped_uploads() {
+	return skipped_uploads;
+}
+
+unsigned long long State_Cache::get_frame_skipped_uploads() {
+	return frame_skipped_uploads;
+}
+
+void State_Cache::end_frame() {
+	frame_skipped_uploads = skipped_uploads;
+	skipped_uploads = 0;
+}
+
+void State_Cache::reset_counters() {
+	issued_calls = 0;
+	skipped_calls = 0;
+	skipped_uploads = 0;
+	frame_skipped_uploads = 0;
+}
@@ -0,0 +1,170 @@
+#include <sgltk/buffer.h>
+
+using namespace sgltk;
+
+Stream_Buffer::Stream_Buffer(unsigned int region_size,
+			     GLenum target,
+			     unsigned int num_regions) : Buffer(target) {
+
+	if(!is_supported()) {
+		std::string error("Persistently mapped buffers are not "
+				  "supported by the current context");
+		App::error_string.push_back(error);
+		throw std::runtime_error(error);
+	}
+
+	if(num_regions == 0)
+		num_regions = 1;
+
+	alignment = 1;
+	GLint offset_alignment = 1;
+	switch(target) {
+		case GL_UNIFORM_BUFFER:
+			glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT,
+				      &offset_alignment);
+			break;
+		case GL_SHADER_STORAGE_BUFFER:
+			glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT,
+				      &offset_alignment);
+			break;
+		default:
+			break;
+	}
+	if(offset_alignment > 1)
+		alignment = offset_alignment;
+
+	//round the region size up so that every region starts aligned
+	region_size = ((region_size + alignment - 1) / alignment) * alignment;
+
+	this->region_size = region_size;
+	this->num_regions = num_regions;
+	region = 0;
+	region_offset = 0;
+	fences.resize(num_regions, nullptr);
+
+	usage = GL_STREAM_DRAW;
+	size = region_size * num_regions;
+	num_elements = 0;
+	track_memory();
+
+	GLbitfield flags = GL_MAP_WRITE_BIT |
+			   GL_MAP_PERSISTENT_BIT |
+			   GL_MAP_COHERENT_BIT;
+	if(App::direct_state_access) {
+		glNamedBufferStorage(buffer, size, nullptr, flags);
+		mapped_data = static_cast<char *>(glMapNamedBufferRange(buffer,
+							0, size, flags));
+	} else {
+		bind_data();
+		glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+		mapped_data = static_cast<char *>(glMapBufferRange(GL_COPY_WRITE_BUFFER,
+							0, size, flags));
+		release_data();
+	}
+
+	if(!mapped_data) {
+		std::string error("Error mapping the stream buffer");
+		App::error_string.push_back(error);
+		throw std::runtime_error(error);
+	}
+}
+
+Stream_Buffer::~Stream_Buffer() {
+	for(GLsync fence : fences) {
+		if(fence)
+			glDeleteSync(fence);
+	}
+	if(App::direct_state_access) {
+		glUnmapNamedBuffer(buffer);
+		return;
+	}
+	bind_data();
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	release_data();
+}
+
+bool Stream_Buffer::is_supported() {
+	return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+}
+
+unsigned int Stream_Buffer::get_region_size() {
+	return region_size;
+}
+
+unsigned int Stream_Buffer::get_region() {
+	return region;
+}
+
+void Stream_Buffer::wait_for_region(unsigned int index) {
+	GLsync fence = fences[index];
+	if(!fence)
+		return;
+
+	GLbitfield flags = 0;
+	GLuint64 timeout = 0;
+	while(true) {
+		GLenum ret = glClientWaitSync(fence, flags, timeout);
+		if(ret == GL_ALREADY_SIGNALED ||
+				ret == GL_CONDITION_SATISFIED ||
+				ret == GL_WAIT_FAILED) {
+			break;
+		}
+		//make sure the fence will be signaled eventually
+		flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		timeout = 1000000;
+	}
+	glDeleteSync(fence);
+	fences[index] = nullptr;
+}
+
+Stream_Range Stream_Buffer::allocate(unsigned int size,
+				     unsigned int alignment) {
+
+	Stream_Range range = {nullptr, 0, 0};
+
+	if(size > region_size) {
+		App::error_string.push_back("The size of the requested range "
+					    "exceeds the size of a stream "
+					    "buffer region");
+		return range;
+	}
+
+	if(alignment < this->alignment)
+		alignment = this->alignment;
+	if(alignment == 0)
+		alignment = 1;
+
+	//align the offset from the start of the buffer, the regions are
+	//only aligned to the offset alignment of the target
+	unsigned int start = region * region_size;
+	unsigned int offset = ((start + region_offset + alignment - 1) /
+				alignment) * alignment - start;
+	if(offset + size > region_size) {
+		next_region();
+		start = region * region_size;
+		offset = ((start + alignment - 1) / alignment) * alignment - start;
+		if(offset + size > region_size) {
+			App::error_string.push_back("The aligned range does not "
+						    "fit into a stream buffer "
+						    "region");
+			return range;
+		}
+	}
+
+	region_offset = offset + size;
+
+	range.offset = start + offset;
+	range.size = size;
+	range.pointer = mapped_data + range.offset;
+	return range;
+}
+
+void Stream_Buffer::next_region() {
+	if(fences[region])
+		glDeleteSync(fences[region]);
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	region = (region + 1) % num_regions;
+	region_offset = 0;
+	wait_for_region(region);
+}
@@ -4,33 +4,70 @@ using namespace sgltk;
 
 std::map<std::string, std::shared_ptr<Texture> > Texture::textures;
 
-Texture::Texture() {
+Texture::Texture(GLenum target) {
+	this->target = target;
 	width = 0;
 	height = 0;
 	num_layers = 1;
-	glGenTextures(1, &texture);
+	if(App::direct_state_access)
+		glCreateTextures(target, 1, &texture);
+	else
+		glGenTextures(1, &texture);
 }
 
 Texture::~Texture() {
-	glDeleteTextures(1, &texture);
+	Memory_Registry::untrack(this);
+	State_Cache::get().delete_texture(texture);
+}
+
+void Texture::release() {
+	State_Cache::get().release_texture(0, target);
+}
+
+void Texture::use(unsigned int texture_unit) {
+	State_Cache::get().use_texture(texture_unit, target, texture);
 }
 
 void Texture::set_parameter(GLenum name, int parameter) {
+	if(App::direct_state_access) {
+		glTextureParameteri(texture, name, parameter);
+		return;
+	}
 	bind();
 	glTexParameteri(target, name, parameter);
-	unbind();
+	release();
 }
 
 void Texture::set_parameter(GLenum name, float parameter) {
+	if(App::direct_state_access) {
+		glTextureParameterf(texture, name, parameter);
+		return;
+	}
 	bind();
 	glTexParameterf(target, name, parameter);
-	unbind();
+	release();
 }
 
 void Texture::set_parameter(GLenum name, float *parameter) {
+	if(App::direct_state_access) {
+		glTextureParameterfv(texture, name, parameter);
+		return;
+	}
 	bind();
 	glTexParameterfv(target, name, parameter);
-	unbind();
+	release();
+}
+
+void Texture::track_memory(GLenum internal_format, bool mipmaps) {
+	size_t size = (size_t)width * height * num_layers *
+		Memory_Registry::get_format_size(internal_format);
+	if(target == GL_TEXTURE_CUBE_MAP)
+		size *= 6;
+	//a full mipmap chain adds about a third of the base level
+	if(mipmaps)
+		size += size / 3;
+	Memory_Registry::track(this, RESOURCE_KIND::TEXTURE,
+			       internal_format, size);
 }
 
 bool Texture::store_texture(std::string name, std::shared_ptr<Texture> texture) {
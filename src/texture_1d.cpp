@@ -2,22 +2,18 @@
 
 using namespace sgltk;
 
-Texture_1d::Texture_1d() : Texture() {
-	target = GL_TEXTURE_1D;
+Texture_1d::Texture_1d() : Texture(GL_TEXTURE_1D) {
 }
 
-Texture_1d::Texture_1d(unsigned int res, GLenum internal_format, GLenum type, GLenum format) : Texture() {
-	target = GL_TEXTURE_1D;
+Texture_1d::Texture_1d(unsigned int res, GLenum internal_format, GLenum type, GLenum format) : Texture(GL_TEXTURE_1D) {
 	create_empty(res, internal_format, type, format);
 }
 
-Texture_1d::Texture_1d(const Image& image) : Texture() {
-	target = GL_TEXTURE_1D;
+Texture_1d::Texture_1d(const Image& image) : Texture(GL_TEXTURE_1D) {
 	load(image);
 }
 
-Texture_1d::Texture_1d(const std::string& path) : Texture() {
-	target = GL_TEXTURE_1D;
+Texture_1d::Texture_1d(const std::string& path) : Texture(GL_TEXTURE_1D) {
 	load(path);
 }
 
@@ -30,13 +26,15 @@ void Texture_1d::create_empty(unsigned int res,
 	width = res;
 	height = 1;
 
+	track_memory(internal_format, false);
+
 	bind();
 	glTexImage1D(GL_TEXTURE_1D, 0,
 		     internal_format, res, 0, format, type, nullptr);
 	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	unbind();
+	release();
 }
 
 bool Texture_1d::load(const std::string& path) {
@@ -59,6 +57,10 @@ bool Texture_1d::load(const Image& image) {
 		return false;
 	}
 
+	width = image.width;
+	height = 1;
+	track_memory(GL_RGBA, true);
+
 	bind();
 	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -66,17 +68,15 @@ bool Texture_1d::load(const Image& image) {
 	glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA, image.width, 0,
 		     GL_RGBA, GL_UNSIGNED_INT_8_8_8_8, tmp->pixels);
 	glGenerateMipmap(GL_TEXTURE_1D);
-	unbind();
+	release();
 	SDL_FreeSurface(tmp);
 	return true;
 }
 
 void Texture_1d::bind(unsigned int texture_unit) {
-	glActiveTexture(GL_TEXTURE0 + texture_unit);
-	glBindTexture(GL_TEXTURE_1D, texture);
+	State_Cache::get().bind_texture(texture_unit, GL_TEXTURE_1D, texture);
 }
 
 void Texture_1d::unbind(unsigned int texture_unit) {
-	glActiveTexture(GL_TEXTURE0 + texture_unit);
-	glBindTexture(GL_TEXTURE_1D, 0);
+	State_Cache::get().bind_texture(texture_unit, GL_TEXTURE_1D, 0);
 }
@@ -2,27 +2,22 @@
 
 using namespace sgltk;
 
-Texture_1d_Array::Texture_1d_Array() : Texture() {
-	target = GL_TEXTURE_1D_ARRAY;
+Texture_1d_Array::Texture_1d_Array() : Texture(GL_TEXTURE_1D_ARRAY) {
 }
 
 Texture_1d_Array::Texture_1d_Array(unsigned int res,
 				   unsigned int num_layers,
 				   GLenum internal_format,
 				   GLenum type,
-				   GLenum format) : Texture() {
-
-	target = GL_TEXTURE_1D_ARRAY;
+				   GLenum format) : Texture(GL_TEXTURE_1D_ARRAY) {
 	create_empty(res, num_layers, internal_format, type, format);
 }
 
-Texture_1d_Array::Texture_1d_Array(const std::vector<Image>& images) : Texture() {
-	target = GL_TEXTURE_1D_ARRAY;
+Texture_1d_Array::Texture_1d_Array(const std::vector<Image>& images) : Texture(GL_TEXTURE_1D_ARRAY) {
 	load(images);
 }
 
-Texture_1d_Array::Texture_1d_Array(const std::vector<std::string>& paths) : Texture() {
-	target = GL_TEXTURE_1D_ARRAY;
+Texture_1d_Array::Texture_1d_Array(const std::vector<std::string>& paths) : Texture(GL_TEXTURE_1D_ARRAY) {
 	load(paths);
 }
 
@@ -38,13 +33,15 @@ void Texture_1d_Array::create_empty(unsigned int res,
 	height = 1;
 	this->num_layers = num_layers;
 
+	track_memory(internal_format, false);
+
 	bind();
 	glTexImage2D(GL_TEXTURE_1D_ARRAY, 0, internal_format,
 		     res, num_layers, 0, format, type, nullptr);
 	glTexParameteri(GL_TEXTURE_1D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_1D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_1D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	unbind();
+	release();
 }
 
 bool Texture_1d_Array::load(const std::vector<std::string>& paths) {
@@ -80,6 +77,8 @@ bool Texture_1d_Array::load(const std::vector<Image>& images) {
 		}
 	}
 
+	track_memory(GL_RGBA, true);
+
 	bind();
 	glTexParameteri(GL_TEXTURE_1D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_1D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -87,12 +86,23 @@ bool Texture_1d_Array::load(const std::vector<Image>& images) {
 	glTexParameteri(GL_TEXTURE_1D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexImage2D(GL_TEXTURE_1D_ARRAY, 0, GL_RGBA,
 		     width, images.size(), 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8, nullptr);
-	for(unsigned int i = 0; num_layers; i++) {
-		glTexSubImage2D(GL_TEXTURE_1D_ARRAY, 0, 0, i, width, 1,
-				GL_RGBA, GL_UNSIGNED_INT_8_8_8_8, images_tmp[i]->pixels);
+	if(App::direct_state_access) {
+		release();
+		for(unsigned int i = 0; i < num_layers; i++) {
+			glTextureSubImage2D(texture, 0, 0, i, width, 1,
+					    GL_RGBA, GL_UNSIGNED_INT_8_8_8_8,
+					    images_tmp[i]->pixels);
+		}
+		glGenerateTextureMipmap(texture);
+	} else {
+		for(unsigned int i = 0; i < num_layers; i++) {
+			glTexSubImage2D(GL_TEXTURE_1D_ARRAY, 0, 0, i, width, 1,
+					GL_RGBA, GL_UNSIGNED_INT_8_8_8_8,
+					images_tmp[i]->pixels);
+		}
+		glGenerateMipmap(GL_TEXTURE_1D_ARRAY);
+		release();
 	}
-	glGenerateMipmap(GL_TEXTURE_1D_ARRAY);
-	unbind();
 
 	for(SDL_Surface *image : images_tmp) {
 		SDL_FreeSurface(image);
@@ -102,11 +112,9 @@ bool Texture_1d_Array::load(const std::vector<Image>& images) {
 }
 
 void Texture_1d_Array::bind(unsigned int texture_unit) {
-	glActiveTexture(GL_TEXTURE0 + texture_unit);
-	glBindTexture(GL_TEXTURE_1D_ARRAY, texture);
+	State_Cache::get().bind_texture(texture_unit, GL_TEXTURE_1D_ARRAY, texture);
 }
 
 void Texture_1d_Array::unbind(unsigned int texture_unit) {
-	glActiveTexture(GL_TEXTURE0 + texture_unit);
-	glBindTexture(GL_TEXTURE_1D_ARRAY, 0);
+	State_Cache::get().bind_texture(texture_unit, GL_TEXTURE_1D_ARRAY, 0);
 }
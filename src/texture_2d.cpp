@@ -2,22 +2,18 @@
 
 using namespace sgltk;
 
-Texture_2d::Texture_2d() : Texture() {
-	target = GL_TEXTURE_2D;
+Texture_2d::Texture_2d() : Texture(GL_TEXTURE_2D) {
 }
 
-Texture_2d::Texture_2d(unsigned int res_x, unsigned int res_y, GLenum internal_format, GLenum type, GLenum format) : Texture() {
-	target = GL_TEXTURE_2D;
+Texture_2d::Texture_2d(unsigned int res_x, unsigned int res_y, GLenum internal_format, GLenum type, GLenum format) : Texture(GL_TEXTURE_2D) {
 	create_empty(res_x, res_y, internal_format, type, format);
 }
 
-Texture_2d::Texture_2d(const Image& image) : Texture() {
-	target = GL_TEXTURE_2D;
+Texture_2d::Texture_2d(const Image& image) : Texture(GL_TEXTURE_2D) {
 	load(image);
 }
 
-Texture_2d::Texture_2d(const std::string& path) : Texture() {
-	target = GL_TEXTURE_2D;
+Texture_2d::Texture_2d(const std::string& path) : Texture(GL_TEXTURE_2D) {
 	load(path);
 }
 
@@ -28,6 +24,8 @@ void Texture_2d::create_empty(unsigned int res_x, unsigned int res_y, GLenum int
 	width = res_x;
 	height = res_y;
 
+	track_memory(internal_format, false);
+
 	bind();
 	glTexImage2D(GL_TEXTURE_2D, 0, internal_format, res_x, res_y, 0,
 		format, type, nullptr);
@@ -35,7 +33,7 @@ void Texture_2d::create_empty(unsigned int res_x, unsigned int res_y, GLenum int
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	unbind();
+	release();
 }
 
 bool Texture_2d::load(const std::string& path) {
@@ -58,6 +56,10 @@ bool Texture_2d::load(const Image& image) {
 		return false;
 	}
 
+	width = image.width;
+	height = image.height;
+	track_memory(GL_RGBA, true);
+
 	bind();
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -66,17 +68,15 @@ bool Texture_2d::load(const Image& image) {
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0,
 		GL_RGBA, GL_UNSIGNED_INT_8_8_8_8, tmp->pixels);
 	glGenerateMipmap(GL_TEXTURE_2D);
-	unbind();
+	release();
 	SDL_FreeSurface(tmp);
 	return true;
 }
 
 void Texture_2d::bind(unsigned int texture_unit) {
-	glActiveTexture(GL_TEXTURE0 + texture_unit);
-	glBindTexture(GL_TEXTURE_2D, texture);
+	State_Cache::get().bind_texture(texture_unit, GL_TEXTURE_2D, texture);
 }
 
 void Texture_2d::unbind(unsigned int texture_unit) {
-	glActiveTexture(GL_TEXTURE0 + texture_unit);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	State_Cache::get().bind_texture(texture_unit, GL_TEXTURE_2D, 0);
 }
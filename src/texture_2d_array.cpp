@@ -2,8 +2,7 @@
 
 using namespace sgltk;
 
-Texture_2d_Array::Texture_2d_Array() : Texture() {
-	target = GL_TEXTURE_2D_ARRAY;
+Texture_2d_Array::Texture_2d_Array() : Texture(GL_TEXTURE_2D_ARRAY) {
 }
 
 Texture_2d_Array::Texture_2d_Array(unsigned int res_x,
@@ -11,19 +10,15 @@ Texture_2d_Array::Texture_2d_Array(unsigned int res_x,
 				   unsigned int num_layers,
 				   GLenum internal_format,
 				   GLenum type,
-				   GLenum format) : Texture() {
-
-	target = GL_TEXTURE_2D_ARRAY;
+				   GLenum format) : Texture(GL_TEXTURE_2D_ARRAY) {
 	create_empty(res_x, res_y, num_layers, internal_format, type, format);
 }
 
-Texture_2d_Array::Texture_2d_Array(const std::vector<Image>& images) : Texture() {
-	target = GL_TEXTURE_2D_ARRAY;
+Texture_2d_Array::Texture_2d_Array(const std::vector<Image>& images) : Texture(GL_TEXTURE_2D_ARRAY) {
 	load(images);
 }
 
-Texture_2d_Array::Texture_2d_Array(const std::vector<std::string>& paths) : Texture() {
-	target = GL_TEXTURE_2D_ARRAY;
+Texture_2d_Array::Texture_2d_Array(const std::vector<std::string>& paths) : Texture(GL_TEXTURE_2D_ARRAY) {
 	load(paths);
 }
 
@@ -40,6 +35,8 @@ void Texture_2d_Array::create_empty(unsigned int res_x,
 	height = res_y;
 	this->num_layers = num_layers;
 
+	track_memory(internal_format, false);
+
 	bind();
 	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internal_format,
 		     res_x, res_y, num_layers, 0, format, type, nullptr);
@@ -47,7 +44,7 @@ void Texture_2d_Array::create_empty(unsigned int res_x,
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	unbind();
+	release();
 }
 
 bool Texture_2d_Array::load(const std::vector<std::string>& paths) {
@@ -84,6 +81,8 @@ bool Texture_2d_Array::load(const std::vector<Image>& images) {
 		}
 	}
 
+	track_memory(GL_RGBA, true);
+
 	bind();
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -92,13 +91,24 @@ bool Texture_2d_Array::load(const std::vector<Image>& images) {
 	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA,
 		     width, height, images.size(), 0,
 		     GL_RGBA, GL_UNSIGNED_INT_8_8_8_8, nullptr);
-	for(unsigned int i = 0; i < images_tmp.size(); i++) {
-		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0,
-				0, i, width, height, 1, GL_RGBA,
-				GL_UNSIGNED_INT_8_8_8_8, images_tmp[i]->pixels);
+	if(App::direct_state_access) {
+		release();
+		for(unsigned int i = 0; i < images_tmp.size(); i++) {
+			glTextureSubImage3D(texture, 0, 0, 0, i,
+					    width, height, 1, GL_RGBA,
+					    GL_UNSIGNED_INT_8_8_8_8,
+					    images_tmp[i]->pixels);
+		}
+		glGenerateTextureMipmap(texture);
+	} else {
+		for(unsigned int i = 0; i < images_tmp.size(); i++) {
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0,
+					0, i, width, height, 1, GL_RGBA,
+					GL_UNSIGNED_INT_8_8_8_8, images_tmp[i]->pixels);
+		}
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		release();
 	}
-	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
-	unbind();
 
 	for(SDL_Surface *image : images_tmp) {
 		SDL_FreeSurface(image);
@@ -108,11 +118,9 @@ bool Texture_2d_Array::load(const std::vector<Image>& images) {
 }
 
 void Texture_2d_Array::bind(unsigned int texture_unit) {
-	glActiveTexture(GL_TEXTURE0 + texture_unit);
-	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	State_Cache::get().bind_texture(texture_unit, GL_TEXTURE_2D_ARRAY, texture);
 }
 
 void Texture_2d_Array::unbind(unsigned int texture_unit) {
-	glActiveTexture(GL_TEXTURE0 + texture_unit);
-	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	State_Cache::get().bind_texture(texture_unit, GL_TEXTURE_2D_ARRAY, 0);
 }
@@ -2,8 +2,7 @@
 
 using namespace sgltk;
 
-Texture_3d::Texture_3d() : Texture() {
-	target = GL_TEXTURE_3D;
+Texture_3d::Texture_3d() : Texture(GL_TEXTURE_3D) {
 }
 
 Texture_3d::Texture_3d(unsigned int res_x,
@@ -11,19 +10,15 @@ Texture_3d::Texture_3d(unsigned int res_x,
 		       unsigned int res_z,
 		       GLenum internal_format,
 		       GLenum type,
-		       GLenum format) : Texture() {
-
-	target = GL_TEXTURE_3D;
+		       GLenum format) : Texture(GL_TEXTURE_3D) {
 	create_empty(res_x, res_y, res_z, internal_format, type, format);
 }
 
-Texture_3d::Texture_3d(const std::vector<Image>& images) : Texture() {
-	target = GL_TEXTURE_3D;
+Texture_3d::Texture_3d(const std::vector<Image>& images) : Texture(GL_TEXTURE_3D) {
 	load(images);
 }
 
-Texture_3d::Texture_3d(const std::vector<std::string>& paths) : Texture() {
-	target = GL_TEXTURE_3D;
+Texture_3d::Texture_3d(const std::vector<std::string>& paths) : Texture(GL_TEXTURE_3D) {
 	load(paths);
 }
 
@@ -41,6 +36,8 @@ void Texture_3d::create_empty(unsigned int res_x,
 	height = res_y;
 	num_layers = res_z;
 
+	track_memory(internal_format, false);
+
 	bind();
 	glTexImage3D(GL_TEXTURE_3D, 0, internal_format,
 		     res_x, res_y, res_z, 0, format, type, nullptr);
@@ -49,7 +46,7 @@ void Texture_3d::create_empty(unsigned int res_x,
 	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	unbind();
+	release();
 }
 
 bool Texture_3d::load(const std::vector<std::string>& paths) {
@@ -86,6 +83,8 @@ bool Texture_3d::load(const std::vector<Image>& images) {
 		}
 	}
 
+	track_memory(GL_RGBA, true);
+
 	bind();
 	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -95,13 +94,24 @@ bool Texture_3d::load(const std::vector<Image>& images) {
 	glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA,
 		     width, height, images.size(), 0,
 		     GL_RGBA, GL_UNSIGNED_INT_8_8_8_8, nullptr);
-	for(unsigned int i = 0; i < num_layers; i++) {
-		glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, i,
-				width, height, 1, GL_RGBA,
-				GL_UNSIGNED_INT_8_8_8_8, images_tmp[i]->pixels);
+	if(App::direct_state_access) {
+		release();
+		for(unsigned int i = 0; i < num_layers; i++) {
+			glTextureSubImage3D(texture, 0, 0, 0, i,
+					    width, height, 1, GL_RGBA,
+					    GL_UNSIGNED_INT_8_8_8_8,
+					    images_tmp[i]->pixels);
+		}
+		glGenerateTextureMipmap(texture);
+	} else {
+		for(unsigned int i = 0; i < num_layers; i++) {
+			glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, i,
+					width, height, 1, GL_RGBA,
+					GL_UNSIGNED_INT_8_8_8_8, images_tmp[i]->pixels);
+		}
+		glGenerateMipmap(GL_TEXTURE_3D);
+		release();
 	}
-	glGenerateMipmap(GL_TEXTURE_3D);
-	unbind();
 
 	for(SDL_Surface *image : images_tmp) {
 		SDL_FreeSurface(image);
@@ -111,11 +121,9 @@ bool Texture_3d::load(const std::vector<Image>& images) {
 }
 
 void Texture_3d::bind(unsigned int texture_unit) {
-	glActiveTexture(GL_TEXTURE0 + texture_unit);
-	glBindTexture(GL_TEXTURE_3D, texture);
+	State_Cache::get().bind_texture(texture_unit, GL_TEXTURE_3D, texture);
 }
 
 void Texture_3d::unbind(unsigned int texture_unit) {
-	glActiveTexture(GL_TEXTURE0 + texture_unit);
-	glBindTexture(GL_TEXTURE_3D, 0);
+	State_Cache::get().bind_texture(texture_unit, GL_TEXTURE_3D, 0);
 }
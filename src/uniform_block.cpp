@@ -0,0 +1,214 @@
+#include <sgltk/uniform_block.h>
+
+using namespace sgltk;
+
+Block_Buffer::Block_Buffer(GLenum target, GLenum usage, unsigned int size) :
+	buffer(target) {
+
+	this->target = target;
+	staging.assign(size, 0);
+	uploaded.assign(size, 0);
+	buffer.load(size, staging.data(), usage);
+	//the contents of the block are unknown until the first upload
+	force_upload = true;
+}
+
+Block_Buffer::~Block_Buffer() {
+}
+
+void Block_Buffer::bind(unsigned int index) {
+	buffer.bind(target, index);
+}
+
+void Block_Buffer::set_dirty() {
+	force_upload = true;
+}
+
+unsigned int Block_Buffer::upload() {
+	unsigned int size = staging.size();
+	unsigned int first = 0;
+	unsigned int last = size;
+
+	if(!force_upload) {
+		while(first < size && staging[first] == uploaded[first])
+			first++;
+		if(first == size)
+			return 0;
+		while(last > first && staging[last - 1] == uploaded[last - 1])
+			last--;
+	}
+	force_upload = false;
+
+	buffer.replace_partial_data(first, &staging[first], last - first);
+	std::copy(staging.begin() + first, staging.begin() + last,
+		  uploaded.begin() + first);
+	return last - first;
+}
+
+bool Block_Buffer::compare_field(const std::string& block_name,
+				 const Block_Field& field,
+				 GLint offset, GLint array_stride,
+				 GLint matrix_stride) {
+
+	bool ret = true;
+	std::string name = block_name + "." + field.name;
+
+	if(offset != (GLint)field.offset) {
+		App::error_string.push_back("The offset of " + name + " is " +
+					    std::to_string(field.offset) +
+					    " but the shader expects " +
+					    std::to_string(offset));
+		ret = false;
+	}
+	if(field.array_stride > 0 && array_stride != (GLint)field.array_stride) {
+		App::error_string.push_back("The array stride of " + name +
+					    " is " +
+					    std::to_string(field.array_stride) +
+					    " but the shader expects " +
+					    std::to_string(array_stride));
+		ret = false;
+	}
+	if(field.matrix_stride > 0 && matrix_stride != (GLint)field.matrix_stride) {
+		App::error_string.push_back("The matrix stride of " + name +
+					    " is " +
+					    std::to_string(field.matrix_stride) +
+					    " but the shader expects " +
+					    std::to_string(matrix_stride));
+		ret = false;
+	}
+	return ret;
+}
+
+bool Block_Buffer::verify_uniform_block(GLuint program,
+					const std::string& block_name) {
+
+	GLuint block_index = glGetUniformBlockIndex(program, block_name.c_str());
+	if(block_index == GL_INVALID_INDEX) {
+		App::error_string.push_back("The shader has no uniform block "
+					    "named " + block_name);
+		return false;
+	}
+
+	bool ret = true;
+	GLint data_size = 0;
+	glGetActiveUniformBlockiv(program, block_index,
+				  GL_UNIFORM_BLOCK_DATA_SIZE, &data_size);
+	if(data_size > (GLint)staging.size()) {
+		App::error_string.push_back("The uniform block " + block_name +
+					    " requires " +
+					    std::to_string(data_size) +
+					    " bytes but the buffer holds " +
+					    std::to_string(staging.size()));
+		ret = false;
+	}
+
+	for(const Block_Field& field : fields) {
+		std::string name = field.name;
+		if(field.array_stride > 0)
+			name += "[0]";
+
+		//members of blocks with an instance name are prefixed
+		//with the block name
+		GLuint index = GL_INVALID_INDEX;
+		for(const std::string& candidate : {name, block_name + "." + name}) {
+			const char *c_name = candidate.c_str();
+			glGetUniformIndices(program, 1, &c_name, &index);
+			if(index != GL_INVALID_INDEX)
+				break;
+		}
+		if(index == GL_INVALID_INDEX) {
+			App::error_string.push_back("The uniform block " +
+						    block_name +
+						    " has no member named " +
+						    field.name);
+			ret = false;
+			continue;
+		}
+
+		GLint offset, array_stride, matrix_stride;
+		glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_OFFSET,
+				      &offset);
+		glGetActiveUniformsiv(program, 1, &index,
+				      GL_UNIFORM_ARRAY_STRIDE, &array_stride);
+		glGetActiveUniformsiv(program, 1, &index,
+				      GL_UNIFORM_MATRIX_STRIDE, &matrix_stride);
+		if(!compare_field(block_name, field, offset, array_stride,
+				  matrix_stride))
+			ret = false;
+	}
+	return ret;
+}
+
+bool Block_Buffer::verify_storage_block(GLuint program,
+					const std::string& block_name) {
+
+	GLuint block_index = glGetProgramResourceIndex(program,
+						       GL_SHADER_STORAGE_BLOCK,
+						       block_name.c_str());
+	if(block_index == GL_INVALID_INDEX) {
+		App::error_string.push_back("The shader has no shader storage "
+					    "block named " + block_name);
+		return false;
+	}
+
+	bool ret = true;
+	GLenum size_property = GL_BUFFER_DATA_SIZE;
+	GLint data_size = 0;
+	glGetProgramResourceiv(program, GL_SHADER_STORAGE_BLOCK, block_index,
+			       1, &size_property, 1, nullptr, &data_size);
+	if(data_size > (GLint)staging.size()) {
+		App::error_string.push_back("The shader storage block " +
+					    block_name + " requires " +
+					    std::to_string(data_size) +
+					    " bytes but the buffer holds " +
+					    std::to_string(staging.size()));
+		ret = false;
+	}
+
+	const GLenum properties[] = {GL_OFFSET, GL_ARRAY_STRIDE,
+				     GL_MATRIX_STRIDE};
+	for(const Block_Field& field : fields) {
+		std::string name = field.name;
+		if(field.array_stride > 0)
+			name += "[0]";
+
+		GLuint index = GL_INVALID_INDEX;
+		for(const std::string& candidate : {name, block_name + "." + name}) {
+			index = glGetProgramResourceIndex(program,
+							  GL_BUFFER_VARIABLE,
+							  candidate.c_str());
+			if(index != GL_INVALID_INDEX)
+				break;
+		}
+		if(index == GL_INVALID_INDEX) {
+			App::error_string.push_back("The shader storage block " +
+						    block_name +
+						    " has no member named " +
+						    field.name);
+			ret = false;
+			continue;
+		}
+
+		GLint values[3];
+		glGetProgramResourceiv(program, GL_BUFFER_VARIABLE, index,
+				       3, properties, 3, nullptr, values);
+		if(!compare_field(block_name, field, values[0], values[1],
+				  values[2]))
+			ret = false;
+	}
+	return ret;
+}
+
+bool Block_Buffer::verify(Shader& shader, const std::string& block_name) {
+	switch(target) {
+		case GL_UNIFORM_BUFFER:
+			return verify_uniform_block(shader.program, block_name);
+		case GL_SHADER_STORAGE_BUFFER:
+			return verify_storage_block(shader.program, block_name);
+		default:
+			App::error_string.push_back("Only uniform and shader "
+						    "storage blocks can be "
+						    "verified");
+			return false;
+	}
+}
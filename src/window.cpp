@@ -56,6 +56,8 @@ endloop:
 		throw std::runtime_error(error);
 	}
 
+	state_cache.make_current();
+
 	glGetIntegerv(GL_MAX_PATCH_VERTICES, &App::sys_info.max_patch_vertices);
 	glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &App::sys_info.max_tess_level);
 
@@ -455,6 +457,7 @@ void Window::run(unsigned int fps) {
 		}
 		delta_time = frame_timer.get_time_s();
 		SDL_GL_SwapWindow(window);
+		State_Cache::get().end_frame();
 	}
 }
 